@@ -0,0 +1,513 @@
+
+/*********************************************************************************************
+
+    This is public domain software that was developed by or for the U.S. Naval Oceanographic
+    Office and/or the U.S. Army Corps of Engineers.
+
+    This is a work of the U.S. Government. In accordance with 17 USC 105, copyright protection
+    is not available for any work of the U.S. Government.
+
+    Neither the United States Government, nor any employees of the United States Government,
+    nor the author, makes any warranty, express or implied, without even the implied warranty
+    of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE, or assumes any liability or
+    responsibility for the accuracy, completeness, or usefulness of any information,
+    apparatus, product, or process disclosed, or represents that its use would not infringe
+    privately-owned rights. Reference herein to any specific commercial products, process,
+    or service by trade name, trademark, manufacturer, or otherwise, does not necessarily
+    constitute or imply its endorsement, recommendation, or favoring by the United States
+    Government. The views and opinions of authors expressed herein do not necessarily state
+    or reflect those of the United States Government, and shall not be used for advertising
+    or product endorsement purposes.
+*********************************************************************************************/
+
+
+/****************************************  IMPORTANT NOTE  **********************************
+
+    Comments in this file that start with / * ! or / / ! are being used by Doxygen to
+    document the software.  Dashes in these comment blocks are used to create bullet lists.
+    The lack of blank lines after a block of dash preceeded comments means that the next
+    block of dash preceeded comments is a new, indented bullet list.  I've tried to keep the
+    Doxygen formatting to a minimum but there are some other items (like <br> and <pre>)
+    that need to be left alone.  If you see a comment that starts with / * ! or / / ! and
+    there is something that looks a bit weird it is probably due to some arcane Doxygen
+    syntax.  Be very careful modifying blocks of Doxygen comments.
+
+*****************************************  IMPORTANT NOTE  **********************************/
+
+
+
+#include "batch_misp.hpp"
+#include "misp_surface.hpp"
+#include "set_defaults.hpp"
+#include "version.hpp"
+#include "reduce_bin.hpp"
+#include "surface_engine.hpp"
+
+#include <getopt.h>
+#include <signal.h>
+#include <cerrno>
+#include <cstdint>
+
+
+/*  Batch mode progress goes to stdout, one record per line, so it can be parsed by whatever is scheduling the runs.
+    The records are:
+
+        PHASE <range> <title>          start of a processing phase (range of 0 means no row count is available)
+        PROGRESS <value> <range>       progress within the current phase (only written when the percentage changes)
+        MESSAGE <text>                 status message
+        DONE <status>                  end of the run (0 is success)
+
+    Errors still go to stderr.  */
+
+
+static int32_t batch_range = 0, batch_percent = -1;
+
+
+static void batch_phase_callback (QString title, int32_t range)
+{
+  batch_range = range;
+  batch_percent = -1;
+
+  fprintf (stdout, "PHASE %d %s\n", range, title.toLatin1 ().data ());
+  fflush (stdout);
+}
+
+
+
+static void batch_value_callback (int32_t value)
+{
+  if (batch_range <= 0) return;
+
+  int32_t percent = NINT (((double) value / (double) batch_range) * 100.0);
+
+  if (percent != batch_percent)
+    {
+      batch_percent = percent;
+
+      fprintf (stdout, "PROGRESS %d %d\n", value, batch_range);
+      fflush (stdout);
+    }
+}
+
+
+
+static void batch_message_callback (QString info)
+{
+  fprintf (stdout, "MESSAGE %s\n", info.simplified ().toLatin1 ().data ());
+  fflush (stdout);
+}
+
+
+
+//  Batch runs are stopped by killing the job.  SIGTERM or SIGINT cancels the run the same way the GUI's cancel button
+//  does so that misp_surface cleans up (forked solves, scratch files, export grids) before we exit.
+
+static volatile sig_atomic_t batch_cancel = 0;
+
+
+static void batch_signal_handler (int32_t sig __attribute__ ((unused)))
+{
+  batch_cancel = 1;
+}
+
+
+
+static uint8_t batch_cancelled_callback ()
+{
+  return (batch_cancel ? NVTrue : NVFalse);
+}
+
+
+
+//  Reads a tolerance from the command line, returns NVFalse unless the whole argument is a number that is 0 or greater.
+
+static uint8_t read_tolerance (char *arg, double *value)
+{
+  char                *end;
+
+
+  *value = strtod (arg, &end);
+
+  return (end != arg && *end == 0 && *value >= 0.0);
+}
+
+
+
+//  Reads a whole number from the command line, returns NVFalse unless the whole argument is a number from min to max.
+
+static uint8_t read_integer (char *arg, int32_t min, int32_t max, int32_t *value)
+{
+  char                *end;
+  long                number;
+
+
+  errno = 0;
+  number = strtol (arg, &end, 10);
+
+  if (end == arg || *end != 0 || errno == ERANGE || number < min || number > max) return (NVFalse);
+
+  *value = (int32_t) number;
+
+  return (NVTrue);
+}
+
+
+
+static void usage ()
+{
+  fprintf (stderr, "\nUsage: pfmMisp --batch PFM_FILE [--surface min|max|all] [--weight 1-3] [--nibble BINS]\n");
+  fprintf (stderr, "               [--replace-all | --holes] [--clear-land] [--tile BINS [--halo BINS] [--check-tiles TOL]]\n");
+  fprintf (stderr, "               [--no-cache] [--export min,max,all]\n");
+  fprintf (stderr, "               [--reduce mean|median|trimmed|stratified [--reduce-cap N]] [--memory-budget MB]\n");
+  fprintf (stderr, "               [--engine misp|idw|tin|multigrid [--warm-start RESIDUAL]]\n\n");
+  fprintf (stderr, "Where:\n\n");
+  fprintf (stderr, "\t--batch PFM_FILE\t=\tgenerate the surface without the GUI\n");
+  fprintf (stderr, "\t--surface\t\t=\tsurface to grid (default all)\n");
+  fprintf (stderr, "\t--weight\t\t=\tMISP weight factor (default 2)\n");
+  fprintf (stderr, "\t--nibble\t\t=\tclear interpolated bins more than BINS from real data,\n");
+  fprintf (stderr, "\t\t\t\t\t0 means don't interpolate empty bins at all\n");
+  fprintf (stderr, "\t--replace-all\t\t=\treplace all bins, not just empty bins\n");
+  fprintf (stderr, "\t--holes\t\t\t=\tsolve each group of empty bins on its own small grid\n");
+  fprintf (stderr, "\t\t\t\t\tinstead of solving the whole PFM\n");
+  fprintf (stderr, "\t--clear-land\t\t=\tclear interpolated bins in SRTM masked land\n");
+  fprintf (stderr, "\t--tile\t\t\t=\tgrid in tiles of BINS by BINS bins (default 0, single grid),\n");
+  fprintf (stderr, "\t\t\t\t\tin parallel processes on Linux only, one at a time\n");
+  fprintf (stderr, "\t\t\t\t\teverywhere else\n");
+  fprintf (stderr, "\t--halo\t\t\t=\ttile overlap in bins (default 32)\n");
+  fprintf (stderr, "\t--check-tiles\t\t=\talso compute the single grid and report the difference, exit with\n");
+  fprintf (stderr, "\t\t\t\t\tstatus %d if the maximum difference is more than TOL\n", RUN_CHECK_FAILED);
+  fprintf (stderr, "\t--no-cache\t\t=\tdon't use or save the point cache (PFM_FILE.misp_cache)\n");
+  fprintf (stderr, "\t--export\t\t=\tcomma separated list of surfaces to also write to\n");
+  fprintf (stderr, "\t\t\t\t\tPFM_FILE.misp_SURFACE.bil (read in the same pass)\n");
+  fprintf (stderr, "\t--reduce\t\t=\treduce all depths bins with more than the cap valid\n");
+  fprintf (stderr, "\t\t\t\t\tsoundings to one point (mean, median, trimmed mean) or\n");
+  fprintf (stderr, "\t\t\t\t\tto at most cap points (stratified)\n");
+  fprintf (stderr, "\t--reduce-cap\t\t=\treduction cap, 1 to %d (default 16)\n", REDUCE_MAX_CAP);
+  fprintf (stderr, "\t--memory-budget\t\t=\tkeep the grids and MISP within MB megabytes, grids that\n");
+  fprintf (stderr, "\t\t\t\t\twon't fit go to PFM_FILE.misp_scratch files and the\n");
+  fprintf (stderr, "\t\t\t\t\tsolve is tiled to fit (default 0, no limit)\n");
+  fprintf (stderr, "\t--engine\t\t=\tinterpolator, MISP (default), inverse distance\n");
+  fprintf (stderr, "\t\t\t\t\tweighting, linear in a Delaunay TIN, or coarse to fine\n");
+  fprintf (stderr, "\t\t\t\t\tminimum curvature\n");
+  fprintf (stderr, "\t--warm-start\t\t=\tstart multigrid from the surface already in the PFM and\n");
+  fprintf (stderr, "\t\t\t\t\tstop when the residual is under RESIDUAL (e.g. 0.01)\n\n");
+  fprintf (stderr, "Progress is written to stdout as PHASE, PROGRESS, MESSAGE, and DONE records.  SIGTERM or SIGINT\n");
+  fprintf (stderr, "cancels the run.  The exit status is 0 on success, %d if the run was cancelled, %d if the\n",
+           RUN_CANCELLED, RUN_CHECK_FAILED);
+  fprintf (stderr, "tiles failed --check-tiles, and -1 on any other error.\n\n");
+  fflush (stderr);
+}
+
+
+
+//  Returns NVTrue if --batch was specified on the command line.
+
+uint8_t is_batch_run (int32_t argc, char **argv)
+{
+  for (int32_t i = 1 ; i < argc ; i++)
+    {
+      if (!strcmp (argv[i], "--batch") || !strncmp (argv[i], "--batch=", 8)) return (NVTrue);
+    }
+
+  return (NVFalse);
+}
+
+
+
+/***************************************************************************\
+*                                                                           *
+*   Module Name:        batch_misp                                          *
+*                                                                           *
+*   Purpose:            Runs misp_surface from the command line without     *
+*                       creating any widgets (no X display needed).         *
+*                       SIGTERM or SIGINT cancels the run.                  *
+*                                                                           *
+*   Returns:            0 on success (or --help), -1 on error,              *
+*                       RUN_CANCELLED (1) if the run was stopped by a       *
+*                       signal, RUN_CHECK_FAILED (2) if the tiled surface   *
+*                       failed --check-tiles                                *
+*                                                                           *
+\***************************************************************************/
+
+int32_t batch_misp (int32_t argc, char **argv)
+{
+  OPTIONS             options;
+  RUN_CALLBACKS       callbacks;
+  QString             pfm_file_name;
+  PFM_OPEN_ARGS       open_args;
+  int32_t             option_index = 0, pfm_handle, status;
+
+
+  static struct option long_options[] = {{"batch", required_argument, 0, 0},
+                                         {"surface", required_argument, 0, 0},
+                                         {"weight", required_argument, 0, 0},
+                                         {"nibble", required_argument, 0, 0},
+                                         {"replace-all", no_argument, 0, 0},
+                                         {"clear-land", no_argument, 0, 0},
+                                         {"tile", required_argument, 0, 0},
+                                         {"halo", required_argument, 0, 0},
+                                         {"check-tiles", required_argument, 0, 0},
+                                         {"no-cache", no_argument, 0, 0},
+                                         {"export", required_argument, 0, 0},
+                                         {"reduce", required_argument, 0, 0},
+                                         {"reduce-cap", required_argument, 0, 0},
+                                         {"memory-budget", required_argument, 0, 0},
+                                         {"holes", no_argument, 0, 0},
+                                         {"engine", required_argument, 0, 0},
+                                         {"warm-start", required_argument, 0, 0},
+                                         {"help", no_argument, 0, 0},
+                                         {0, no_argument, 0, 0}};
+
+
+  set_defaults (&options);
+
+
+  while (NVTrue) 
+    {
+      int32_t c = getopt_long (argc, argv, "", long_options, &option_index);
+      if (c == -1) break;
+
+      if (c != 0)
+        {
+          usage ();
+          return (-1);
+        }
+
+      switch (option_index)
+        {
+        case 0:
+          pfm_file_name = QString (optarg);
+          break;
+
+        case 1:
+          if (!strcmp (optarg, "min"))
+            {
+              options.surface = 0;
+            }
+          else if (!strcmp (optarg, "max"))
+            {
+              options.surface = 1;
+            }
+          else if (!strcmp (optarg, "all"))
+            {
+              options.surface = 2;
+            }
+          else
+            {
+              fprintf (stderr, "\nUnknown surface type %s\n", optarg);
+              usage ();
+              return (-1);
+            }
+          break;
+
+        case 2:
+          if (!read_integer (optarg, 1, 3, &options.weight))
+            {
+              fprintf (stderr, "\nWeight factor must be 1, 2, or 3\n");
+              usage ();
+              return (-1);
+            }
+          break;
+
+        case 3:
+          options.clear_int = NVTrue;
+          if (!read_integer (optarg, 0, INT32_MAX, &options.nibble))
+            {
+              fprintf (stderr, "\nNibble value must be a whole number, 0 or greater\n");
+              usage ();
+              return (-1);
+            }
+          break;
+
+        case 4:
+          options.replace_all = NVTrue;
+          break;
+
+        case 5:
+          options.clear_land = NVTrue;
+          break;
+
+        case 6:
+          if (!read_integer (optarg, 0, INT32_MAX, &options.tile_size))
+            {
+              fprintf (stderr, "\nTile size must be a whole number, 0 or greater\n");
+              usage ();
+              return (-1);
+            }
+          break;
+
+        case 7:
+          if (!read_integer (optarg, 0, INT32_MAX, &options.tile_halo))
+            {
+              fprintf (stderr, "\nTile halo must be a whole number, 0 or greater\n");
+              usage ();
+              return (-1);
+            }
+          break;
+
+        case 8:
+          if (!read_tolerance (optarg, &options.tile_check))
+            {
+              fprintf (stderr, "\nTile check tolerance must be a number, 0 or greater\n");
+              usage ();
+              return (-1);
+            }
+          break;
+
+        case 9:
+          options.point_cache = NVFalse;
+          break;
+
+        case 10:
+          {
+            char *surface = strtok (optarg, ",");
+
+            while (surface != NULL)
+              {
+                if (!strcmp (surface, "min"))
+                  {
+                    options.export_mask |= 1;
+                  }
+                else if (!strcmp (surface, "max"))
+                  {
+                    options.export_mask |= 2;
+                  }
+                else if (!strcmp (surface, "all"))
+                  {
+                    options.export_mask |= 4;
+                  }
+                else
+                  {
+                    fprintf (stderr, "\nUnknown export surface type %s\n", surface);
+                    usage ();
+                    return (-1);
+                  }
+
+                surface = strtok (NULL, ",");
+              }
+          }
+          break;
+
+        case 11:
+          if (!strcmp (optarg, "mean"))
+            {
+              options.reduce = REDUCE_MEAN;
+            }
+          else if (!strcmp (optarg, "median"))
+            {
+              options.reduce = REDUCE_MEDIAN;
+            }
+          else if (!strcmp (optarg, "trimmed"))
+            {
+              options.reduce = REDUCE_TRIMMED;
+            }
+          else if (!strcmp (optarg, "stratified"))
+            {
+              options.reduce = REDUCE_STRATIFIED;
+            }
+          else
+            {
+              fprintf (stderr, "\nUnknown bin reduction method %s\n", optarg);
+              usage ();
+              return (-1);
+            }
+          break;
+
+        case 12:
+          if (!read_integer (optarg, 1, REDUCE_MAX_CAP, &options.reduce_cap))
+            {
+              fprintf (stderr, "\nReduction cap must be 1 to %d\n", REDUCE_MAX_CAP);
+              usage ();
+              return (-1);
+            }
+          break;
+
+        case 13:
+          if (!read_integer (optarg, 0, INT32_MAX, &options.memory_budget))
+            {
+              fprintf (stderr, "\nMemory budget must be a whole number of megabytes, 0 or greater\n");
+              usage ();
+              return (-1);
+            }
+          break;
+
+        case 14:
+          options.hole_fill = NVTrue;
+          break;
+
+        case 15:
+          options.engine = find_surface_engine (optarg);
+          if (options.engine < 0)
+            {
+              fprintf (stderr, "\nUnknown engine %s\n", optarg);
+              usage ();
+              return (-1);
+            }
+          break;
+
+        case 16:
+          if (!read_tolerance (optarg, &options.warm_residual))
+            {
+              fprintf (stderr, "\nWarm start residual must be a number, 0 or greater\n");
+              usage ();
+              return (-1);
+            }
+          break;
+
+        case 17:
+          usage ();
+          return (0);
+
+        default:
+          usage ();
+          return (-1);
+        }
+    }
+
+
+  if (pfm_file_name.isEmpty () || optind < argc)
+    {
+      usage ();
+      return (-1);
+    }
+
+
+  //  Same check that startPage makes, we only handle geographic PFMs.
+
+  strcpy (open_args.list_path, pfm_file_name.toLatin1 ());
+
+  open_args.checkpoint = 0;
+  pfm_handle = open_existing_pfm_file (&open_args);
+
+  if (pfm_handle < 0) pfm_error_exit (pfm_error);
+
+  close_pfm_file (pfm_handle);
+
+  if (open_args.head.proj_data.projection)
+    {
+      fprintf (stderr, "\n%s is not a geographic PFM structure, pfmMisp only handles geographic PFM structures.\n",
+               pfm_file_name.toLatin1 ().data ());
+      return (-1);
+    }
+
+
+  fprintf (stdout, "MESSAGE %s\n", VERSION);
+  fflush (stdout);
+
+
+  callbacks.phase = batch_phase_callback;
+  callbacks.value = batch_value_callback;
+  callbacks.message = batch_message_callback;
+  callbacks.cancelled = batch_cancelled_callback;
+
+  signal (SIGTERM, batch_signal_handler);
+  signal (SIGINT, batch_signal_handler);
+
+  status = misp_surface (pfm_file_name, &options, &callbacks);
+
+
+  fprintf (stdout, "DONE %d\n", status);
+  fflush (stdout);
+
+  return (status);
+}
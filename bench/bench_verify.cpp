@@ -0,0 +1,292 @@
+
+/*********************************************************************************************
+
+    This is public domain software that was developed by or for the U.S. Naval Oceanographic
+    Office and/or the U.S. Army Corps of Engineers.
+
+    This is a work of the U.S. Government. In accordance with 17 USC 105, copyright protection
+    is not available for any work of the U.S. Government.
+
+    Neither the United States Government, nor any employees of the United States Government,
+    nor the author, makes any warranty, express or implied, without even the implied warranty
+    of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE, or assumes any liability or
+    responsibility for the accuracy, completeness, or usefulness of any information,
+    apparatus, product, or process disclosed, or represents that its use would not infringe
+    privately-owned rights. Reference herein to any specific commercial products, process,
+    or service by trade name, trademark, manufacturer, or otherwise, does not necessarily
+    constitute or imply its endorsement, recommendation, or favoring by the United States
+    Government. The views and opinions of authors expressed herein do not necessarily state
+    or reflect those of the United States Government, and shall not be used for advertising
+    or product endorsement purposes.
+*********************************************************************************************/
+
+
+/****************************************  IMPORTANT NOTE  **********************************
+
+    Comments in this file that start with / * ! or / / ! are being used by Doxygen to
+    document the software.  Dashes in these comment blocks are used to create bullet lists.
+    The lack of blank lines after a block of dash preceeded comments means that the next
+    block of dash preceeded comments is a new, indented bullet list.  I've tried to keep the
+    Doxygen formatting to a minimum but there are some other items (like <br> and <pre>)
+    that need to be left alone.  If you see a comment that starts with / * ! or / / ! and
+    there is something that looks a bit weird it is probably due to some arcane Doxygen
+    syntax.  Be very careful modifying blocks of Doxygen comments.
+
+*****************************************  IMPORTANT NOTE  **********************************/
+
+
+
+#include "bench_verify.hpp"
+#include "../bin_raster.hpp"
+#include "../nibble.hpp"
+#include "../polygon_spans.hpp"
+
+#include <cmath>
+
+
+/*  Brute force checks of the fast versions of things that pfmMisp used to do a bin at a time.  The nibbler is checked
+    against a search of the whole (2 * nibble + 1) square around every bin on random masks and the polygon spans are
+    checked against bin_inside_ptr for every bin on random polygons.  */
+
+
+//  xorshift, same as make_synthetic_pfm, so a seed gives the same cases on any box.
+
+static uint32_t next_random (uint32_t *state)
+{
+  uint32_t x = *state;
+
+  x ^= x << 13;
+  x ^= x >> 17;
+  x ^= x << 5;
+
+  *state = x;
+
+  return (x);
+}
+
+
+
+static double uniform (uint32_t *state)
+{
+  return ((double) next_random (state) / 4294967296.0);
+}
+
+
+
+/***************************************************************************\
+*                                                                           *
+*   Module Name:        verify_nibble                                       *
+*                                                                           *
+*   Purpose:            Runs nibble_mask on random RASTER_DATA masks (from  *
+*                       a single bin wide to a few hundred bins, nearly     *
+*                       empty to a third full, nibble distances of 1 to 40) *
+*                       and compares RASTER_NEAR with a search of every bin *
+*                       in the (2 * nibble + 1) square around each bin.     *
+*                                                                           *
+*   Arguments:          trials          -   number of random masks          *
+*                       seed            -   random seed                     *
+*                       callbacks       -   progress hooks                  *
+*                                                                           *
+*   Returns:            Number of bins that didn't match                    *
+*                                                                           *
+\***************************************************************************/
+
+int32_t verify_nibble (int32_t trials, uint32_t seed, RUN_CALLBACKS *callbacks)
+{
+  BIN_RASTER          raster;
+  uint32_t            state = seed ? seed : 1;
+  int32_t             mismatches = 0;
+  int64_t             bins = 0;
+
+
+  for (int32_t t = 0 ; t < trials ; t++)
+    {
+      int32_t width = 1 + next_random (&state) % 300;
+      int32_t height = 1 + next_random (&state) % 200;
+      int32_t nibble = 1 + next_random (&state) % 40;
+      double fill = 0.001 + 0.33 * uniform (&state) * uniform (&state);
+
+      alloc_bin_raster (&raster, width, height);
+
+      for (int32_t i = 0 ; i < height ; i++)
+        {
+          for (int32_t j = 0 ; j < width ; j++) if (uniform (&state) < fill) raster_set (&raster, RASTER_DATA, j, i);
+        }
+
+      nibble_mask (&raster, nibble, callbacks);
+
+
+      for (int32_t i = 0 ; i < height ; i++)
+        {
+          for (int32_t j = 0 ; j < width ; j++)
+            {
+              uint8_t near = NVFalse;
+
+              for (int32_t y = MAX (i - nibble, 0) ; !near && y <= MIN (i + nibble, height - 1) ; y++)
+                {
+                  for (int32_t x = MAX (j - nibble, 0) ; x <= MIN (j + nibble, width - 1) ; x++)
+                    {
+                      if (raster_get (&raster, RASTER_DATA, x, y))
+                        {
+                          near = NVTrue;
+                          break;
+                        }
+                    }
+                }
+
+              if (near != raster_get (&raster, RASTER_NEAR, j, i))
+                {
+                  if (!mismatches)
+                    fprintf (stderr, "    nibble %d, %d x %d mask: bin %d, %d is %d, should be %d\n", nibble, width,
+                             height, j, i, raster_get (&raster, RASTER_NEAR, j, i), near);
+
+                  mismatches++;
+                }
+
+              bins++;
+            }
+        }
+
+      free_bin_raster (&raster);
+    }
+
+
+  fprintf (stderr, "Nibbler : %d random masks, %lld bins, %d wrong\n", trials, (long long) bins, mismatches);
+
+  return (mismatches);
+}
+
+
+
+//  Whether bin corner j, i (in bin units) lies on one of the polygon's edges.  Either answer is right for those so the
+//  spans and bin_inside_ptr don't have to agree.
+
+static uint8_t on_edge (BIN_HEADER *head, int32_t j, int32_t i)
+{
+  for (int32_t k = 0 ; k < head->polygon_count ; k++)
+    {
+      int32_t m = (k + 1) % head->polygon_count;
+
+      double x0 = (head->polygon[k].x - head->mbr.min_x) / head->x_bin_size_degrees;
+      double y0 = (head->polygon[k].y - head->mbr.min_y) / head->y_bin_size_degrees;
+      double x1 = (head->polygon[m].x - head->mbr.min_x) / head->x_bin_size_degrees;
+      double y1 = (head->polygon[m].y - head->mbr.min_y) / head->y_bin_size_degrees;
+
+      if (j < MIN (x0, x1) - 1.0e-6 || j > MAX (x0, x1) + 1.0e-6 || i < MIN (y0, y1) - 1.0e-6 ||
+          i > MAX (y0, y1) + 1.0e-6) continue;
+
+      double length = hypot (x1 - x0, y1 - y0);
+
+      if (length < 1.0e-9 || fabs ((x1 - x0) * (i - y0) - (y1 - y0) * (j - x0)) / length < 1.0e-6) return (NVTrue);
+    }
+
+  return (NVFalse);
+}
+
+
+
+/***************************************************************************\
+*                                                                           *
+*   Module Name:        verify_polygon_spans                                *
+*                                                                           *
+*   Purpose:            Builds the polygon spans for random polygons (3 to  *
+*                       20 vertices, concave and self intersecting, half of *
+*                       them with the vertices on bin corners so that edges *
+*                       run along rows and through corners) and compares    *
+*                       them with bin_inside_ptr at every bin corner.       *
+*                       Corners that lie on an edge are only counted, which *
+*                       side they land on is up to the point in polygon     *
+*                       test.                                               *
+*                                                                           *
+*   Arguments:          trials          -   number of random polygons       *
+*                       seed            -   random seed                     *
+*                                                                           *
+*   Returns:            Number of bins that didn't match                    *
+*                                                                           *
+\***************************************************************************/
+
+int32_t verify_polygon_spans (int32_t trials, uint32_t seed)
+{
+  BIN_HEADER          head;
+  POLYGON_SPANS       polygon;
+  NV_F64_COORD2       xy;
+  uint32_t            state = seed ? seed : 1;
+  int32_t             mismatches = 0;
+  int64_t             bins = 0, edge_bins = 0;
+
+
+  for (int32_t t = 0 ; t < trials ; t++)
+    {
+      memset (&head, 0, sizeof (BIN_HEADER));
+
+      head.bin_width = 4 + next_random (&state) % 200;
+      head.bin_height = 4 + next_random (&state) % 200;
+      head.x_bin_size_degrees = head.y_bin_size_degrees = 0.001;
+      head.bin_size_xy = 100.0;
+      head.mbr.min_x = -70.0;
+      head.mbr.min_y = 30.0;
+      head.mbr.max_x = head.mbr.min_x + head.bin_width * head.x_bin_size_degrees;
+      head.mbr.max_y = head.mbr.min_y + head.bin_height * head.y_bin_size_degrees;
+      head.polygon_count = 3 + next_random (&state) % 18;
+
+      uint8_t corners = next_random (&state) & 1;
+
+      for (int32_t k = 0 ; k < head.polygon_count ; k++)
+        {
+          double x = uniform (&state) * head.bin_width;
+          double y = uniform (&state) * head.bin_height;
+
+          if (corners)
+            {
+              x = floor (x);
+              y = floor (y);
+            }
+
+          head.polygon[k].x = head.mbr.min_x + x * head.x_bin_size_degrees;
+          head.polygon[k].y = head.mbr.min_y + y * head.y_bin_size_degrees;
+        }
+
+
+      build_polygon_spans (&head, &polygon);
+
+      for (int32_t i = 0 ; i < head.bin_height ; i++)
+        {
+          int32_t k = polygon.first[i];
+
+          for (int32_t j = 0 ; j < head.bin_width ; j++)
+            {
+              while (k < polygon.first[i + 1] && polygon.spans[k].end < j) k++;
+
+              uint8_t in_span = (k < polygon.first[i + 1] && polygon.spans[k].start <= j);
+
+              xy.x = head.mbr.min_x + j * head.x_bin_size_degrees;
+              xy.y = head.mbr.min_y + i * head.y_bin_size_degrees;
+
+              uint8_t in_polygon = bin_inside_ptr (&head, xy) ? NVTrue : NVFalse;
+
+              if (in_span != in_polygon && on_edge (&head, j, i))
+                {
+                  edge_bins++;
+                }
+              else if (in_span != in_polygon)
+                {
+                  if (!mismatches)
+                    fprintf (stderr, "    %d vertex polygon, %d x %d bins: bin %d, %d is %d, should be %d\n",
+                             head.polygon_count, head.bin_width, head.bin_height, j, i, in_span, in_polygon);
+
+                  mismatches++;
+                }
+
+              bins++;
+            }
+        }
+
+      free_polygon_spans (&polygon);
+    }
+
+
+  fprintf (stderr, "Polygon spans : %d random polygons, %lld bins, %lld differ on an edge, %d wrong\n", trials,
+           (long long) bins, (long long) edge_bins, mismatches);
+
+  return (mismatches);
+}
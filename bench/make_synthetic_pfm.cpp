@@ -0,0 +1,280 @@
+
+/*********************************************************************************************
+
+    This is public domain software that was developed by or for the U.S. Naval Oceanographic
+    Office and/or the U.S. Army Corps of Engineers.
+
+    This is a work of the U.S. Government. In accordance with 17 USC 105, copyright protection
+    is not available for any work of the U.S. Government.
+
+    Neither the United States Government, nor any employees of the United States Government,
+    nor the author, makes any warranty, express or implied, without even the implied warranty
+    of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE, or assumes any liability or
+    responsibility for the accuracy, completeness, or usefulness of any information,
+    apparatus, product, or process disclosed, or represents that its use would not infringe
+    privately-owned rights. Reference herein to any specific commercial products, process,
+    or service by trade name, trademark, manufacturer, or otherwise, does not necessarily
+    constitute or imply its endorsement, recommendation, or favoring by the United States
+    Government. The views and opinions of authors expressed herein do not necessarily state
+    or reflect those of the United States Government, and shall not be used for advertising
+    or product endorsement purposes.
+*********************************************************************************************/
+
+
+/****************************************  IMPORTANT NOTE  **********************************
+
+    Comments in this file that start with / * ! or / / ! are being used by Doxygen to
+    document the software.  Dashes in these comment blocks are used to create bullet lists.
+    The lack of blank lines after a block of dash preceeded comments means that the next
+    block of dash preceeded comments is a new, indented bullet list.  I've tried to keep the
+    Doxygen formatting to a minimum but there are some other items (like <br> and <pre>)
+    that need to be left alone.  If you see a comment that starts with / * ! or / / ! and
+    there is something that looks a bit weird it is probably due to some arcane Doxygen
+    syntax.  Be very careful modifying blocks of Doxygen comments.
+
+*****************************************  IMPORTANT NOTE  **********************************/
+
+
+
+#include "make_synthetic_pfm.hpp"
+
+
+#define         SYNTHETIC_BIN_SIZE      0.0001     /* Bin size in degrees (about 11 meters) */
+#define         SYNTHETIC_WEST          -80.0
+#define         SYNTHETIC_SOUTH         30.0
+
+
+//  xorshift so that the same seed gives the same PFM on any box.
+
+static uint32_t next_random (uint32_t *state)
+{
+  uint32_t x = *state;
+
+  x ^= x << 13;
+  x ^= x >> 17;
+  x ^= x << 5;
+
+  *state = x;
+
+  return (x);
+}
+
+
+
+static double uniform (uint32_t *state)
+{
+  return ((double) next_random (state) / 4294967296.0);
+}
+
+
+
+//  A smooth, wavy seafloor (positive down) with a little noise.
+
+static double synthetic_depth (double x, double y, uint32_t *state)
+{
+  return (100.0 + 20.0 * sin (x / 53.0) * cos (y / 71.0) + 0.002 * x + 5.0 * sin ((x + y) / 17.0) +
+          0.2 * (uniform (state) - 0.5));
+}
+
+
+
+/*  Marks the holes (bins with no data) by throwing circles at the area until the requested fraction is covered.  */
+
+static void make_holes (uint8_t *hole, SYNTHETIC_PFM *synth, uint32_t *state)
+{
+  int64_t covered = 0, bins = (int64_t) synth->width * synth->height;
+  int64_t target = (int64_t) (MIN (MAX (synth->holes, 0.0), 0.9) * bins);
+  int32_t radius = MAX (2, MIN (synth->width, synth->height) / 20);
+
+
+  while (covered < target)
+    {
+      int32_t cx = next_random (state) % synth->width;
+      int32_t cy = next_random (state) % synth->height;
+      int32_t r = radius / 2 + next_random (state) % radius;
+
+      for (int32_t i = MAX (0, cy - r) ; i <= MIN (synth->height - 1, cy + r) ; i++)
+        {
+          for (int32_t j = MAX (0, cx - r) ; j <= MIN (synth->width - 1, cx + r) ; j++)
+            {
+              int64_t k = (int64_t) i * synth->width + j;
+
+              if (!hole[k] && (i - cy) * (i - cy) + (j - cx) * (j - cx) <= r * r)
+                {
+                  hole[k] = 1;
+                  covered++;
+                }
+            }
+        }
+    }
+}
+
+
+
+/***************************************************************************\
+*                                                                           *
+*   Module Name:        make_synthetic_pfm                                  *
+*                                                                           *
+*   Purpose:            Builds a geographic PFM of the requested size with  *
+*                       random soundings over a synthetic seafloor for      *
+*                       benchmarking.  Holes are circular areas with no     *
+*                       data, the polygon is either the full rectangle or   *
+*                       a diamond inscribed in it, and soundings in the     *
+*                       west "land" fraction are flagged as land masked     *
+*                       points (PFM_USER_10) like pfmLoad does.             *
+*                                                                           *
+*   Arguments:          list_path       -   PFM list file to create (must   *
+*                                           not exist)                      *
+*                       synth           -   generator settings              *
+*                                                                           *
+*   Returns:            Number of soundings loaded, -1 on error             *
+*                                                                           *
+\***************************************************************************/
+
+int32_t make_synthetic_pfm (char *list_path, SYNTHETIC_PFM *synth)
+{
+  PFM_OPEN_ARGS       open_args;
+  DEPTH_RECORD        depth;
+  BIN_RECORD          bin;
+  NV_I32_COORD2       coord;
+  int32_t             pfm_handle, count = 0;
+  uint32_t            state;
+  uint8_t             *hole;
+
+
+  state = synth->seed ? synth->seed : 1;
+
+
+  memset (&open_args, 0, sizeof (PFM_OPEN_ARGS));
+
+  strcpy (open_args.list_path, list_path);
+  open_args.checkpoint = 0;
+  open_args.max_depth = 1000.0;
+  open_args.offset = 100.0;
+  open_args.scale = 100.0;
+
+  open_args.head.proj_data.projection = 0;
+  open_args.head.bin_size_xy = 0.0;
+  open_args.head.x_bin_size_degrees = SYNTHETIC_BIN_SIZE;
+  open_args.head.y_bin_size_degrees = SYNTHETIC_BIN_SIZE;
+  open_args.head.mbr.min_x = SYNTHETIC_WEST;
+  open_args.head.mbr.min_y = SYNTHETIC_SOUTH;
+  open_args.head.mbr.max_x = SYNTHETIC_WEST + synth->width * SYNTHETIC_BIN_SIZE;
+  open_args.head.mbr.max_y = SYNTHETIC_SOUTH + synth->height * SYNTHETIC_BIN_SIZE;
+  open_args.head.null_depth = open_args.max_depth + 1.0;
+  open_args.head.dynamic_reload = NVFalse;
+  open_args.head.num_bin_attr = 0;
+  strcpy (open_args.head.classification, "UNCLASSIFIED");
+  strcpy (open_args.head.user_flag_name[9], "Land masked point");
+
+
+  if (synth->polygon == SYNTHETIC_DIAMOND)
+    {
+      double cx = (open_args.head.mbr.min_x + open_args.head.mbr.max_x) / 2.0;
+      double cy = (open_args.head.mbr.min_y + open_args.head.mbr.max_y) / 2.0;
+
+      open_args.head.polygon[0].x = cx;
+      open_args.head.polygon[0].y = open_args.head.mbr.min_y;
+      open_args.head.polygon[1].x = open_args.head.mbr.max_x;
+      open_args.head.polygon[1].y = cy;
+      open_args.head.polygon[2].x = cx;
+      open_args.head.polygon[2].y = open_args.head.mbr.max_y;
+      open_args.head.polygon[3].x = open_args.head.mbr.min_x;
+      open_args.head.polygon[3].y = cy;
+    }
+  else
+    {
+      open_args.head.polygon[0].x = open_args.head.mbr.min_x;
+      open_args.head.polygon[0].y = open_args.head.mbr.min_y;
+      open_args.head.polygon[1].x = open_args.head.mbr.min_x;
+      open_args.head.polygon[1].y = open_args.head.mbr.max_y;
+      open_args.head.polygon[2].x = open_args.head.mbr.max_x;
+      open_args.head.polygon[2].y = open_args.head.mbr.max_y;
+      open_args.head.polygon[3].x = open_args.head.mbr.max_x;
+      open_args.head.polygon[3].y = open_args.head.mbr.min_y;
+    }
+  open_args.head.polygon_count = 4;
+
+
+  if ((pfm_handle = open_pfm_file (&open_args)) < 0)
+    {
+      fprintf (stderr, "\nUnable to create %s : %s\n", list_path, pfm_error_str (pfm_error));
+      return (-1);
+    }
+
+
+  hole = (uint8_t *) calloc ((int64_t) synth->width * synth->height, sizeof (uint8_t));
+
+  if (hole == NULL)
+    {
+      perror ("Allocating synthetic hole mask");
+      exit (-1);
+    }
+
+  make_holes (hole, synth, &state);
+
+
+  memset (&depth, 0, sizeof (DEPTH_RECORD));
+
+  depth.file_number = write_input_file (pfm_handle, (char *) "synthetic.dat", PFM_UNDEFINED_DATA);
+  depth.line_number = write_line_file (pfm_handle, (char *) "synthetic");
+
+  int32_t land_width = NINT (MIN (MAX (synth->land, 0.0), 1.0) * synth->width);
+
+
+  for (int32_t i = 0 ; i < synth->height ; i++)
+    {
+      for (int32_t j = 0 ; j < synth->width ; j++)
+        {
+          if (hole[(int64_t) i * synth->width + j]) continue;
+
+
+          //  Integer part of the density plus one more some of the time.
+
+          int32_t n = (int32_t) synth->density;
+          if (uniform (&state) < synth->density - (double) n) n++;
+
+          for (int32_t k = 0 ; k < n ; k++)
+            {
+              double x = (double) j + uniform (&state);
+              double y = (double) i + uniform (&state);
+
+              depth.coord.x = j;
+              depth.coord.y = i;
+              depth.xyz.x = open_args.head.mbr.min_x + x * SYNTHETIC_BIN_SIZE;
+              depth.xyz.y = open_args.head.mbr.min_y + y * SYNTHETIC_BIN_SIZE;
+              depth.xyz.z = synthetic_depth (x, y, &state);
+              depth.ping_number = count;
+              depth.beam_number = k;
+              depth.validity = (j < land_width) ? PFM_USER_10 : 0;
+
+              add_depth_record_index (pfm_handle, &depth);
+
+              count++;
+            }
+        }
+    }
+
+  free (hole);
+
+
+  //  Compute the bin values (min/max filtered, PFM_DATA, etc) the way the loader does.
+
+  for (int32_t i = 0 ; i < synth->height ; i++)
+    {
+      coord.y = i;
+
+      for (int32_t j = 0 ; j < synth->width ; j++)
+        {
+          coord.x = j;
+
+          recompute_bin_values_index (pfm_handle, coord, &bin, 0);
+        }
+    }
+
+
+  close_pfm_file (pfm_handle);
+
+
+  return (count);
+}
@@ -0,0 +1,486 @@
+
+/*********************************************************************************************
+
+    This is public domain software that was developed by or for the U.S. Naval Oceanographic
+    Office and/or the U.S. Army Corps of Engineers.
+
+    This is a work of the U.S. Government. In accordance with 17 USC 105, copyright protection
+    is not available for any work of the U.S. Government.
+
+    Neither the United States Government, nor any employees of the United States Government,
+    nor the author, makes any warranty, express or implied, without even the implied warranty
+    of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE, or assumes any liability or
+    responsibility for the accuracy, completeness, or usefulness of any information,
+    apparatus, product, or process disclosed, or represents that its use would not infringe
+    privately-owned rights. Reference herein to any specific commercial products, process,
+    or service by trade name, trademark, manufacturer, or otherwise, does not necessarily
+    constitute or imply its endorsement, recommendation, or favoring by the United States
+    Government. The views and opinions of authors expressed herein do not necessarily state
+    or reflect those of the United States Government, and shall not be used for advertising
+    or product endorsement purposes.
+*********************************************************************************************/
+
+
+/****************************************  IMPORTANT NOTE  **********************************
+
+    Comments in this file that start with / * ! or / / ! are being used by Doxygen to
+    document the software.  Dashes in these comment blocks are used to create bullet lists.
+    The lack of blank lines after a block of dash preceeded comments means that the next
+    block of dash preceeded comments is a new, indented bullet list.  I've tried to keep the
+    Doxygen formatting to a minimum but there are some other items (like <br> and <pre>)
+    that need to be left alone.  If you see a comment that starts with / * ! or / / ! and
+    there is something that looks a bit weird it is probably due to some arcane Doxygen
+    syntax.  Be very careful modifying blocks of Doxygen comments.
+
+*****************************************  IMPORTANT NOTE  **********************************/
+
+
+
+#include "make_synthetic_pfm.hpp"
+#include "bench_verify.hpp"
+#include "../misp_surface.hpp"
+#include "../set_defaults.hpp"
+#include "../surface_engine.hpp"
+#include "../version.hpp"
+
+#include <getopt.h>
+
+
+/*  pfmMispBench builds synthetic PFMs at a number of sizes and runs the full misp_surface pipeline on each of them.
+    The PFM is rebuilt (same seed, so the same soundings) before every run since each run writes its surface back
+    into it.  Every run writes its own PFM_FILE.misp_report.json (see run_stats), this collects them into one
+    bench_results.json in the bench directory and prints a table of the phase times.  With --verify it doesn't build
+    anything, it just runs the brute force checks in bench_verify.  */
+
+
+//  Phase times for one run, pulled out of its report for the table.
+
+typedef struct
+{
+  int32_t       scale;
+  int32_t       engine;
+  int32_t       run;
+  double        wall;                       //  Whole run (seconds)
+  QMap<QString, double> phase;              //  Phase name to wall seconds
+} BENCH_RUN;
+
+
+static void bench_phase_callback (QString title __attribute__ ((unused)), int32_t range __attribute__ ((unused)))
+{
+}
+
+
+
+static void bench_value_callback (int32_t value __attribute__ ((unused)))
+{
+}
+
+
+
+//  misp_surface sends the phase summary as messages after the run, we just echo everything to stderr.
+
+static void bench_message_callback (QString info)
+{
+  fprintf (stderr, "    %s\n", info.toLatin1 ().data ());
+}
+
+
+
+static uint8_t bench_cancelled_callback ()
+{
+  return (NVFalse);
+}
+
+
+
+static void usage ()
+{
+  fprintf (stderr, "\nUsage: pfmMispBench [--dir DIR] [--scales N,N,...] [--density SOUNDINGS] [--holes FRACTION]\n");
+  fprintf (stderr, "                    [--polygon rect|diamond] [--land FRACTION] [--repeat N] [--tile BINS]\n");
+  fprintf (stderr, "                    [--nibble BINS] [--seed N] [--engines misp,idw,tin,multigrid]\n");
+  fprintf (stderr, "       pfmMispBench --verify [--seed N]\n\n");
+  fprintf (stderr, "Where:\n\n");
+  fprintf (stderr, "\t--dir\t\t=\tdirectory for the synthetic PFMs and results (default .)\n");
+  fprintf (stderr, "\t--scales\t=\tsquare PFM sizes in bins (default 256,1024,2048)\n");
+  fprintf (stderr, "\t--density\t=\tmean soundings per bin (default 4)\n");
+  fprintf (stderr, "\t--holes\t\t=\tfraction of the area with no data (default 0.2)\n");
+  fprintf (stderr, "\t--polygon\t=\tPFM polygon shape (default rect)\n");
+  fprintf (stderr, "\t--land\t\t=\tfraction of the width flagged as land masked (default 0.1)\n");
+  fprintf (stderr, "\t--repeat\t=\truns per scale (default 2)\n");
+  fprintf (stderr, "\t--tile\t\t=\ttile size for the solve (default 0, single grid)\n");
+  fprintf (stderr, "\t--nibble\t=\tnibble distance (default 8)\n");
+  fprintf (stderr, "\t--seed\t\t=\trandom seed (default 1)\n");
+  fprintf (stderr, "\t--engines\t=\tinterpolators to run at each scale (default misp), use\n");
+  fprintf (stderr, "\t\t\t\tmisp,multigrid to compare the multigrid engine with libmisp\n");
+  fprintf (stderr, "\t--verify\t=\tcheck the nibbler and the polygon spans against brute force\n");
+  fprintf (stderr, "\t\t\t\tversions on random cases and exit (-1 if anything differs)\n\n");
+  fprintf (stderr, "The synthetic PFMs are rebuilt before every run.  The point cache is turned off so that every\n");
+  fprintf (stderr, "run reads the PFM.\n\n");
+  fflush (stderr);
+}
+
+
+
+//  Gets rid of an old synthetic PFM (list file and data directory).
+
+static void remove_pfm (QString list)
+{
+  QFile::remove (list);
+  QFile::remove (list + ".misp_cache");
+  QFile::remove (list + ".misp_report.json");
+
+  QDir data (list + ".data");
+  if (data.exists ()) data.removeRecursively ();
+}
+
+
+
+//  Rebuilds the synthetic PFM from scratch, returns the number of soundings or -1 on error.
+
+static int32_t build_pfm (QString list, SYNTHETIC_PFM *synth)
+{
+  char                list_path[1024];
+
+
+  remove_pfm (list);
+
+  strcpy (list_path, list.toLatin1 ());
+
+  return (make_synthetic_pfm (list_path, synth));
+}
+
+
+
+//  Gets the total and phase wall times out of a run report.  We write the report by hand (see run_stats) with one
+//  phase per line so we don't need a JSON parser to read it back.
+
+static void read_report_times (QByteArray report, BENCH_RUN *run)
+{
+  QList<QByteArray> lines = report.split ('\n');
+  char                name[64];
+  double              wall;
+
+
+  run->wall = 0.0;
+
+  for (int32_t i = 0 ; i < lines.size () ; i++)
+    {
+      if (sscanf (lines[i].data (), " {\"name\": \"%63[^\"]\", \"wall_seconds\": %lf", name, &wall) == 2)
+        {
+          run->phase[QString (name)] += wall;
+        }
+      else if (sscanf (lines[i].data (), " \"wall_seconds\": %lf", &wall) == 1)
+        {
+          run->wall = wall;
+        }
+    }
+}
+
+
+
+//  One row per run, one column per phase (in the order we first saw them).
+
+static void print_phase_table (QVector<BENCH_RUN> &runs)
+{
+  QStringList         names;
+
+
+  for (int32_t r = 0 ; r < runs.size () ; r++)
+    {
+      QStringList keys = runs[r].phase.keys ();
+
+      for (int32_t k = 0 ; k < keys.size () ; k++) if (!names.contains (keys[k])) names.append (keys[k]);
+    }
+
+  fprintf (stderr, "\n%8s %-10s %4s %9s", "Scale", "Engine", "Run", "total");
+  for (int32_t k = 0 ; k < names.size () ; k++) fprintf (stderr, " %9.9s", names[k].toLatin1 ().data ());
+  fprintf (stderr, "\n");
+
+  for (int32_t r = 0 ; r < runs.size () ; r++)
+    {
+      fprintf (stderr, "%8d %-10s %4d %9.3f", runs[r].scale, surface_engines[runs[r].engine].name, runs[r].run + 1,
+               runs[r].wall);
+
+      for (int32_t k = 0 ; k < names.size () ; k++)
+        {
+          if (runs[r].phase.contains (names[k]))
+            {
+              fprintf (stderr, " %9.3f", runs[r].phase[names[k]]);
+            }
+          else
+            {
+              fprintf (stderr, " %9s", "-");
+            }
+        }
+
+      fprintf (stderr, "\n");
+    }
+
+  fflush (stderr);
+}
+
+
+
+int32_t main (int32_t argc, char **argv)
+{
+  SYNTHETIC_PFM       synth;
+  OPTIONS             options;
+  RUN_CALLBACKS       callbacks;
+  QString             dir = ".", scales = "256,1024,2048", engines = "misp";
+  int32_t             option_index = 0, repeat = 2, count, built, status;
+  uint8_t             verify = NVFalse;
+  QVector<BENCH_RUN>  runs;
+  FILE                *fp;
+
+
+  QCoreApplication a (argc, argv);
+
+
+  static struct option long_options[] = {{"dir", required_argument, 0, 0},
+                                         {"scales", required_argument, 0, 0},
+                                         {"density", required_argument, 0, 0},
+                                         {"holes", required_argument, 0, 0},
+                                         {"polygon", required_argument, 0, 0},
+                                         {"land", required_argument, 0, 0},
+                                         {"repeat", required_argument, 0, 0},
+                                         {"tile", required_argument, 0, 0},
+                                         {"nibble", required_argument, 0, 0},
+                                         {"seed", required_argument, 0, 0},
+                                         {"engines", required_argument, 0, 0},
+                                         {"verify", no_argument, 0, 0},
+                                         {"help", no_argument, 0, 0},
+                                         {0, no_argument, 0, 0}};
+
+
+  synth.density = 4.0;
+  synth.holes = 0.2;
+  synth.polygon = SYNTHETIC_RECTANGLE;
+  synth.land = 0.1;
+  synth.seed = 1;
+
+
+  set_defaults (&options);
+
+  options.clear_int = NVTrue;
+  options.nibble = 8;
+  options.point_cache = NVFalse;
+
+
+  while (NVTrue) 
+    {
+      int32_t c = getopt_long (argc, argv, "", long_options, &option_index);
+      if (c == -1) break;
+
+      if (c != 0)
+        {
+          usage ();
+          return (-1);
+        }
+
+      switch (option_index)
+        {
+        case 0:
+          dir = QString (optarg);
+          break;
+
+        case 1:
+          scales = QString (optarg);
+          break;
+
+        case 2:
+          synth.density = atof (optarg);
+          break;
+
+        case 3:
+          synth.holes = atof (optarg);
+          break;
+
+        case 4:
+          if (!strcmp (optarg, "rect"))
+            {
+              synth.polygon = SYNTHETIC_RECTANGLE;
+            }
+          else if (!strcmp (optarg, "diamond"))
+            {
+              synth.polygon = SYNTHETIC_DIAMOND;
+            }
+          else
+            {
+              fprintf (stderr, "\nUnknown polygon shape %s\n", optarg);
+              usage ();
+              return (-1);
+            }
+          break;
+
+        case 5:
+          synth.land = atof (optarg);
+          break;
+
+        case 6:
+          repeat = MAX (1, atoi (optarg));
+          break;
+
+        case 7:
+          options.tile_size = MAX (0, atoi (optarg));
+          break;
+
+        case 8:
+          options.nibble = MAX (0, atoi (optarg));
+          break;
+
+        case 9:
+          synth.seed = (uint32_t) atoi (optarg);
+          break;
+
+        case 10:
+          engines = QString (optarg);
+          break;
+
+        case 11:
+          verify = NVTrue;
+          break;
+
+        case 12:
+          usage ();
+          return (0);
+
+        default:
+          usage ();
+          return (-1);
+        }
+    }
+
+
+  QStringList engine_list = engines.split (",", QString::SkipEmptyParts);
+
+  for (int32_t e = 0 ; e < engine_list.size () ; e++)
+    {
+      if (find_surface_engine (engine_list[e].toLatin1 ()) < 0)
+        {
+          fprintf (stderr, "\nUnknown engine %s\n", engine_list[e].toLatin1 ().data ());
+          usage ();
+          return (-1);
+        }
+    }
+
+
+  callbacks.phase = bench_phase_callback;
+  callbacks.value = bench_value_callback;
+  callbacks.message = bench_message_callback;
+  callbacks.cancelled = bench_cancelled_callback;
+
+
+  if (verify)
+    {
+      int32_t wrong = verify_nibble (200, synth.seed, &callbacks) + verify_polygon_spans (500, synth.seed);
+
+      return (wrong ? -1 : 0);
+    }
+
+
+  QString results_name = dir + "/bench_results.json";
+
+  if ((fp = fopen (results_name.toLatin1 (), "w")) == NULL)
+    {
+      perror (results_name.toLatin1 ());
+      return (-1);
+    }
+
+  fprintf (stderr, "\n%s\n\n", VERSION);
+
+  fprintf (fp, "{\n");
+  fprintf (fp, "  \"version\": \"%s\",\n", VERSION);
+  fprintf (fp, "  \"density\": %f, \"holes\": %f, \"polygon\": \"%s\", \"land\": %f, \"seed\": %u,\n", synth.density,
+           synth.holes, synth.polygon == SYNTHETIC_DIAMOND ? "diamond" : "rect", synth.land, synth.seed);
+  fprintf (fp, "  \"runs\": [\n");
+
+
+  QStringList scale_list = scales.split (",", QString::SkipEmptyParts);
+  uint8_t first = NVTrue;
+
+  for (int32_t s = 0 ; s < scale_list.size () ; s++)
+    {
+      int32_t size = scale_list[s].toInt ();
+
+      if (size < 16)
+        {
+          fprintf (stderr, "Skipping scale %s (must be 16 bins or more)\n", scale_list[s].toLatin1 ().data ());
+          continue;
+        }
+
+      synth.width = synth.height = size;
+
+
+      QString list = dir + QString ("/bench_%1.pfm").arg (size);
+
+      fprintf (stderr, "Building %s (%d x %d bins)\n", list.toLatin1 ().data (), size, size);
+      fflush (stderr);
+
+      count = -1;
+
+
+      for (int32_t e = 0 ; e < engine_list.size () ; e++)
+        {
+          options.engine = find_surface_engine (engine_list[e].toLatin1 ());
+
+          for (int32_t r = 0 ; r < repeat ; r++)
+            {
+              //  Every run writes its surface into the PFM so the next one has to start from a fresh copy.
+
+              if ((built = build_pfm (list, &synth)) < 0)
+                {
+                  fclose (fp);
+                  return (-1);
+                }
+
+              if (count < 0) fprintf (stderr, "    %d soundings\n", built);
+              count = built;
+
+              fprintf (stderr, "Run %d of %d at %d x %d (%s)\n", r + 1, repeat, size, size,
+                       surface_engines[options.engine].name);
+              fflush (stderr);
+
+              status = misp_surface (list, &options, &callbacks);
+
+
+              //  Copy the run report into the results.
+
+              QFile report (list + ".misp_report.json");
+
+              if (status || !report.open (QIODevice::ReadOnly))
+                {
+                  fprintf (stderr, "    run failed (status %d)\n", status);
+                  continue;
+                }
+
+              fprintf (fp, "%s    {\"scale\": %d, \"soundings\": %d, \"engine\": \"%s\", \"run\": %d, \"report\":\n",
+                       first ? "" : ",\n", size, count, surface_engines[options.engine].name, r);
+              BENCH_RUN run;
+              QByteArray contents = report.readAll ();
+
+              fprintf (fp, "%s    }", contents.data ());
+              first = NVFalse;
+
+              run.scale = size;
+              run.engine = options.engine;
+              run.run = r;
+              read_report_times (contents, &run);
+              runs.append (run);
+
+              report.close ();
+            }
+        }
+    }
+
+  fprintf (fp, "\n  ]\n");
+  fprintf (fp, "}\n");
+  fclose (fp);
+
+
+  print_phase_table (runs);
+
+  fprintf (stderr, "\nResults written to %s\n\n", results_name.toLatin1 ().data ());
+
+
+  return (0);
+}
@@ -0,0 +1,102 @@
+
+/*********************************************************************************************
+
+    This is public domain software that was developed by or for the U.S. Naval Oceanographic
+    Office and/or the U.S. Army Corps of Engineers.
+
+    This is a work of the U.S. Government. In accordance with 17 USC 105, copyright protection
+    is not available for any work of the U.S. Government.
+
+    Neither the United States Government, nor any employees of the United States Government,
+    nor the author, makes any warranty, express or implied, without even the implied warranty
+    of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE, or assumes any liability or
+    responsibility for the accuracy, completeness, or usefulness of any information,
+    apparatus, product, or process disclosed, or represents that its use would not infringe
+    privately-owned rights. Reference herein to any specific commercial products, process,
+    or service by trade name, trademark, manufacturer, or otherwise, does not necessarily
+    constitute or imply its endorsement, recommendation, or favoring by the United States
+    Government. The views and opinions of authors expressed herein do not necessarily state
+    or reflect those of the United States Government, and shall not be used for advertising
+    or product endorsement purposes.
+*********************************************************************************************/
+
+
+/****************************************  IMPORTANT NOTE  **********************************
+
+    Comments in this file that start with / * ! or / / ! are being used by Doxygen to
+    document the software.  Dashes in these comment blocks are used to create bullet lists.
+    The lack of blank lines after a block of dash preceeded comments means that the next
+    block of dash preceeded comments is a new, indented bullet list.  I've tried to keep the
+    Doxygen formatting to a minimum but there are some other items (like <br> and <pre>)
+    that need to be left alone.  If you see a comment that starts with / * ! or / / ! and
+    there is something that looks a bit weird it is probably due to some arcane Doxygen
+    syntax.  Be very careful modifying blocks of Doxygen comments.
+
+*****************************************  IMPORTANT NOTE  **********************************/
+
+
+
+#ifndef BIN_RASTER_H
+#define BIN_RASTER_H
+
+#include "pfmMispDef.hpp"
+
+
+/*  Bit planes in the bin raster.  The first four are filled from the bin records during ingest and are kept up to
+    date by the write back passes so that nobody has to go back to the PFM to find out what state a bin is in.  The
+    others are only allocated when they're needed.  */
+
+#define         RASTER_DATA             0          /* PFM_DATA is set */
+#define         RASTER_INTERPOLATED     1          /* PFM_INTERPOLATED is set */
+#define         RASTER_LAND             2          /* PFM_USER_10 (land masked point) is set */
+#define         RASTER_SOUNDINGS        3          /* num_soundings is non-zero */
+#define         RASTER_ROW              4          /* Nibbler scratch, data within nibble bins in the same row */
+#define         RASTER_NEAR             5          /* Data within nibble bins (chessboard distance) */
+#define         RASTER_SRTM             6          /* Bin center is SRTM land (only allocated for land clearing) */
+
+#define         RASTER_PLANES           7
+
+
+/*  One bit per bin per plane.  Every row starts on a 64 bit word boundary so different threads can work on different
+    rows without stepping on each other.  */
+
+typedef struct
+{
+  int32_t             width;
+  int32_t             height;
+  int32_t             words;                      //  64 bit words per row
+  uint64_t            *plane[RASTER_PLANES];
+} BIN_RASTER;
+
+
+void alloc_bin_raster (BIN_RASTER *raster, int32_t width, int32_t height);
+void alloc_raster_plane (BIN_RASTER *raster, int32_t plane);
+void free_raster_plane (BIN_RASTER *raster, int32_t plane);
+void free_bin_raster (BIN_RASTER *raster);
+
+
+static inline uint64_t *raster_row (BIN_RASTER *raster, int32_t plane, int32_t row)
+{
+  return (&raster->plane[plane][(int64_t) row * raster->words]);
+}
+
+
+static inline uint8_t raster_get (BIN_RASTER *raster, int32_t plane, int32_t x, int32_t y)
+{
+  return ((raster_row (raster, plane, y)[x >> 6] >> (x & 63)) & 1);
+}
+
+
+static inline void raster_set (BIN_RASTER *raster, int32_t plane, int32_t x, int32_t y)
+{
+  raster_row (raster, plane, y)[x >> 6] |= ((uint64_t) 1 << (x & 63));
+}
+
+
+static inline void raster_clear (BIN_RASTER *raster, int32_t plane, int32_t x, int32_t y)
+{
+  raster_row (raster, plane, y)[x >> 6] &= ~((uint64_t) 1 << (x & 63));
+}
+
+
+#endif
@@ -0,0 +1,138 @@
+
+/*********************************************************************************************
+
+    This is public domain software that was developed by or for the U.S. Naval Oceanographic
+    Office and/or the U.S. Army Corps of Engineers.
+
+    This is a work of the U.S. Government. In accordance with 17 USC 105, copyright protection
+    is not available for any work of the U.S. Government.
+
+    Neither the United States Government, nor any employees of the United States Government,
+    nor the author, makes any warranty, express or implied, without even the implied warranty
+    of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE, or assumes any liability or
+    responsibility for the accuracy, completeness, or usefulness of any information,
+    apparatus, product, or process disclosed, or represents that its use would not infringe
+    privately-owned rights. Reference herein to any specific commercial products, process,
+    or service by trade name, trademark, manufacturer, or otherwise, does not necessarily
+    constitute or imply its endorsement, recommendation, or favoring by the United States
+    Government. The views and opinions of authors expressed herein do not necessarily state
+    or reflect those of the United States Government, and shall not be used for advertising
+    or product endorsement purposes.
+*********************************************************************************************/
+
+
+/****************************************  IMPORTANT NOTE  **********************************
+
+    Comments in this file that start with / * ! or / / ! are being used by Doxygen to
+    document the software.  Dashes in these comment blocks are used to create bullet lists.
+    The lack of blank lines after a block of dash preceeded comments means that the next
+    block of dash preceeded comments is a new, indented bullet list.  I've tried to keep the
+    Doxygen formatting to a minimum but there are some other items (like <br> and <pre>)
+    that need to be left alone.  If you see a comment that starts with / * ! or / / ! and
+    there is something that looks a bit weird it is probably due to some arcane Doxygen
+    syntax.  Be very careful modifying blocks of Doxygen comments.
+
+*****************************************  IMPORTANT NOTE  **********************************/
+
+
+
+#include "bin_row.hpp"
+
+
+void open_bin_row (BIN_ROW *row, int32_t pfm_handle, int32_t width, uint32_t validity_mask)
+{
+  row->pfm_handle = pfm_handle;
+  row->width = width;
+  row->row = -1;
+  row->dirty_count = 0;
+  row->validity_mask = validity_mask;
+
+  row->bins = (BIN_RECORD *) malloc (width * sizeof (BIN_RECORD));
+  row->dirty = (uint8_t *) calloc (width, sizeof (uint8_t));
+
+  if (row->bins == NULL || row->dirty == NULL)
+    {
+      perror ("Allocating bin row buffer");
+      exit (-1);
+    }
+}
+
+
+
+/*  Reads row "y" of bin records into the buffer with a single read_bin_row call and returns the buffer.  Any pending
+    writes are flushed first.  */
+
+BIN_RECORD *read_bin_row_buffer (BIN_ROW *row, int32_t y)
+{
+  flush_bin_row (row);
+
+  if (read_bin_row (row->pfm_handle, row->width, y, 0, row->bins)) pfm_error_exit (pfm_error);
+
+  row->row = y;
+
+  return (row->bins);
+}
+
+
+
+/*  Queues a write for bin x of row y.  For BIN_ROW_RECORD the bin record in the buffer (which must hold row y) is
+    written, for BIN_ROW_VALIDITY the row doesn't have to have been read, only bins[x].validity is used.  Moving to a
+    new row flushes the old one.  */
+
+void mark_bin_row (BIN_ROW *row, int32_t x, int32_t y, uint8_t type)
+{
+  if (y != row->row)
+    {
+      flush_bin_row (row);
+      row->row = y;
+    }
+
+  if (!row->dirty[x]) row->dirty_count++;
+
+  row->dirty[x] |= type;
+}
+
+
+
+//  Writes out all of the queued bins in the row (in column order).
+
+void flush_bin_row (BIN_ROW *row)
+{
+  NV_I32_COORD2       coord;
+
+
+  if (!row->dirty_count) return;
+
+  coord.y = row->row;
+
+  for (int32_t x = 0 ; x < row->width ; x++)
+    {
+      if (!row->dirty[x]) continue;
+
+      coord.x = x;
+      row->bins[x].coord = coord;
+
+      if (row->dirty[x] & BIN_ROW_RECORD)
+        {
+          write_bin_record_index (row->pfm_handle, &row->bins[x]);
+        }
+      else
+        {
+          write_bin_record_validity_index (row->pfm_handle, &row->bins[x], row->validity_mask);
+        }
+
+      row->dirty[x] = 0;
+    }
+
+  row->dirty_count = 0;
+}
+
+
+
+void close_bin_row (BIN_ROW *row)
+{
+  flush_bin_row (row);
+
+  free (row->bins);
+  free (row->dirty);
+}
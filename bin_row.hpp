@@ -0,0 +1,71 @@
+
+/*********************************************************************************************
+
+    This is public domain software that was developed by or for the U.S. Naval Oceanographic
+    Office and/or the U.S. Army Corps of Engineers.
+
+    This is a work of the U.S. Government. In accordance with 17 USC 105, copyright protection
+    is not available for any work of the U.S. Government.
+
+    Neither the United States Government, nor any employees of the United States Government,
+    nor the author, makes any warranty, express or implied, without even the implied warranty
+    of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE, or assumes any liability or
+    responsibility for the accuracy, completeness, or usefulness of any information,
+    apparatus, product, or process disclosed, or represents that its use would not infringe
+    privately-owned rights. Reference herein to any specific commercial products, process,
+    or service by trade name, trademark, manufacturer, or otherwise, does not necessarily
+    constitute or imply its endorsement, recommendation, or favoring by the United States
+    Government. The views and opinions of authors expressed herein do not necessarily state
+    or reflect those of the United States Government, and shall not be used for advertising
+    or product endorsement purposes.
+*********************************************************************************************/
+
+
+/****************************************  IMPORTANT NOTE  **********************************
+
+    Comments in this file that start with / * ! or / / ! are being used by Doxygen to
+    document the software.  Dashes in these comment blocks are used to create bullet lists.
+    The lack of blank lines after a block of dash preceeded comments means that the next
+    block of dash preceeded comments is a new, indented bullet list.  I've tried to keep the
+    Doxygen formatting to a minimum but there are some other items (like <br> and <pre>)
+    that need to be left alone.  If you see a comment that starts with / * ! or / / ! and
+    there is something that looks a bit weird it is probably due to some arcane Doxygen
+    syntax.  Be very careful modifying blocks of Doxygen comments.
+
+*****************************************  IMPORTANT NOTE  **********************************/
+
+
+
+#ifndef BIN_ROW_H
+#define BIN_ROW_H
+
+#include "pfmMispDef.hpp"
+
+
+#define         BIN_ROW_RECORD          1          /* Write the whole bin record */
+#define         BIN_ROW_VALIDITY        2          /* Only write the validity bits in the row's validity mask */
+
+
+/*  A reusable buffer for one row of bin records.  Reads fetch the whole row in one call, writes are queued with
+    mark_bin_row and go out together with flush_bin_row.  */
+
+typedef struct
+{
+  int32_t             pfm_handle;
+  int32_t             width;
+  int32_t             row;                        //  Row in the buffer (-1 if none)
+  BIN_RECORD          *bins;
+  uint8_t             *dirty;                     //  BIN_ROW_RECORD or BIN_ROW_VALIDITY for each bin
+  int32_t             dirty_count;
+  uint32_t            validity_mask;              //  Mask for BIN_ROW_VALIDITY writes
+} BIN_ROW;
+
+
+void open_bin_row (BIN_ROW *row, int32_t pfm_handle, int32_t width, uint32_t validity_mask);
+BIN_RECORD *read_bin_row_buffer (BIN_ROW *row, int32_t y);
+void mark_bin_row (BIN_ROW *row, int32_t x, int32_t y, uint8_t type);
+void flush_bin_row (BIN_ROW *row);
+void close_bin_row (BIN_ROW *row);
+
+
+#endif
@@ -0,0 +1,443 @@
+
+/*********************************************************************************************
+
+    This is public domain software that was developed by or for the U.S. Naval Oceanographic
+    Office and/or the U.S. Army Corps of Engineers.
+
+    This is a work of the U.S. Government. In accordance with 17 USC 105, copyright protection
+    is not available for any work of the U.S. Government.
+
+    Neither the United States Government, nor any employees of the United States Government,
+    nor the author, makes any warranty, express or implied, without even the implied warranty
+    of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE, or assumes any liability or
+    responsibility for the accuracy, completeness, or usefulness of any information,
+    apparatus, product, or process disclosed, or represents that its use would not infringe
+    privately-owned rights. Reference herein to any specific commercial products, process,
+    or service by trade name, trademark, manufacturer, or otherwise, does not necessarily
+    constitute or imply its endorsement, recommendation, or favoring by the United States
+    Government. The views and opinions of authors expressed herein do not necessarily state
+    or reflect those of the United States Government, and shall not be used for advertising
+    or product endorsement purposes.
+*********************************************************************************************/
+
+
+/****************************************  IMPORTANT NOTE  **********************************
+
+    Comments in this file that start with / * ! or / / ! are being used by Doxygen to
+    document the software.  Dashes in these comment blocks are used to create bullet lists.
+    The lack of blank lines after a block of dash preceeded comments means that the next
+    block of dash preceeded comments is a new, indented bullet list.  I've tried to keep the
+    Doxygen formatting to a minimum but there are some other items (like <br> and <pre>)
+    that need to be left alone.  If you see a comment that starts with / * ! or / / ! and
+    there is something that looks a bit weird it is probably due to some arcane Doxygen
+    syntax.  Be very careful modifying blocks of Doxygen comments.
+
+*****************************************  IMPORTANT NOTE  **********************************/
+
+
+
+#include "export_grid.hpp"
+#include "solve_surface.hpp"
+#include "surface_engine.hpp"
+
+#ifdef NVLinux
+#include <sys/wait.h>
+#include <signal.h>
+#include <unistd.h>
+#include <errno.h>
+#endif
+
+
+static const char *surface_suffix[3] = {"min", "max", "all"};
+
+
+//  The export solves don't report MISP's progress, there's nobody to report it to in a child process.
+
+static void quiet_progress_callback (char *info __attribute__ ((unused)))
+{
+}
+
+
+
+/*  NVTrue if the export surfaces are solved in their own processes, a single MISP grid each (see misp_grid).  The other
+    engines already use all of the cores and a tiled MISP solve already runs a process per tile so those are solved one
+    at a time in finish_export_solves.  */
+
+static uint8_t forked_exports (int32_t width, int32_t height, OPTIONS *options)
+{
+#ifdef NVLinux
+  return (surface_engines[options->engine].global_state && single_grid (width, height, options));
+#else
+  return (NVFalse);
+#endif
+}
+
+
+
+/*  Sets up an EXPORT_GRID for each surface in options->export_mask and returns the number of them.  On Linux the grids
+    are shared mappings (in memory or, out of core, in a scratch file) so the child processes that solve them can hand
+    them back.  The number of rows that MISP gave us goes in the int32_t after the grid.  */
+
+static int32_t *mapped_rows (EXPORT_GRID *export_grid)
+{
+  return ((int32_t *) ((char *) export_grid->grid + export_grid->bytes - sizeof (int32_t)));
+}
+
+
+
+int32_t alloc_export_grids (PFM_OPEN_ARGS *open_args, OPTIONS *options, EXPORT_GRID *exports)
+{
+  int32_t             count = 0;
+
+
+  for (int32_t s = 0 ; s < 3 ; s++)
+    {
+      if (!(options->export_mask & (1 << s))) continue;
+
+      EXPORT_GRID *export_grid = &exports[count++];
+
+      export_grid->surface = s;
+      export_grid->shared = (s == options->surface);
+      export_grid->pid = 0;
+      export_grid->file = NULL;
+      export_grid->name = QString (open_args->list_path) + ".misp_" + surface_suffix[s] + ".bil";
+      export_grid->grid = NULL;
+      export_grid->scratch.data = NULL;
+      export_grid->grid_rows = 0;
+      export_grid->bytes = (int64_t) open_args->head.bin_width * open_args->head.bin_height * sizeof (float) +
+        sizeof (int32_t);
+
+      if (export_grid->shared) continue;
+
+      export_grid->grid = (float *) alloc_scratch_grid (&export_grid->scratch, export_grid->bytes, NVTrue);
+    }
+
+
+  return (count);
+}
+
+
+
+/*  Starts a process for each export surface (other than the PFM surface) that solves it into the shared grid.  libmisp
+    keeps all of its state in static memory so this is the only way to run the solves at the same time.  The children
+    only run misp_grid (the misp_rtrv row is allocated here, before the fork).  When forked_exports says no this does
+    nothing and finish_export_solves solves them one at a time.  */
+
+void start_export_solves (POINT_BUFFER *points __attribute__ ((unused)), NV_F64_XYMBR mbr __attribute__ ((unused)),
+                          int32_t width __attribute__ ((unused)), int32_t height __attribute__ ((unused)),
+                          OPTIONS *options __attribute__ ((unused)), EXPORT_GRID *exports __attribute__ ((unused)),
+                          int32_t count __attribute__ ((unused)))
+{
+#ifdef NVLinux
+  if (!forked_exports (width, height, options)) return;
+
+
+  //  One more column than we need due to chrtr specific changes in misp_rtrv (see single_solve).
+
+  float *row = (float *) malloc ((width + 1) * sizeof (float));
+
+  if (row == NULL)
+    {
+      perror ("Allocating export row");
+      exit (-1);
+    }
+
+  for (int32_t e = 0 ; e < count ; e++)
+    {
+      if (exports[e].shared) continue;
+
+      pid_t pid = fork ();
+
+      if (pid < 0)
+        {
+          perror ("Starting export surface process");
+          exit (-1);
+        }
+
+      if (pid == 0)
+        {
+          POINT_BUFFER *surface_points = &points[exports[e].surface];
+
+
+          //  finish_export_solves stops us with SIGTERM if the run is cancelled, batch mode's handler would ignore it.
+
+          signal (SIGTERM, SIG_DFL);
+
+          misp_register_progress_callback (quiet_progress_callback);
+
+          int32_t rows = misp_grid (surface_points, NULL, surface_points->count, mbr, width, height, options->weight,
+                                    exports[e].grid, row);
+
+          *mapped_rows (&exports[e]) = MAX (rows, 0);
+
+          _exit (rows < 0 ? 1 : 0);
+        }
+
+      exports[e].pid = pid;
+    }
+
+  free (row);
+#endif
+}
+
+
+
+/***************************************************************************\
+*                                                                           *
+*   Module Name:        finish_export_solves                                *
+*                                                                           *
+*   Purpose:            Waits for the export surface processes started by   *
+*                       start_export_solves (or, if there aren't any,       *
+*                       solves the export surfaces one at a time) and       *
+*                       points the export of the PFM surface, if there is   *
+*                       one, at "grid".  A surface that couldn't be solved  *
+*                       is left empty.                                      *
+*                                                                           *
+*   Arguments:          points          -   points for each surface         *
+*                       mbr             -   MISP MBR (bin units)            *
+*                       width           -   grid width (bins)               *
+*                       height          -   grid height (bins)              *
+*                       options         -   run options                     *
+*                       callbacks       -   progress hooks                  *
+*                       grid            -   the PFM surface                 *
+*                       grid_rows       -   rows in the PFM surface         *
+*                       exports         -   export grids                    *
+*                       count           -   number of export grids          *
+*                                                                           *
+*   Returns:            NVTrue if the run was cancelled                     *
+*                                                                           *
+\***************************************************************************/
+
+uint8_t finish_export_solves (POINT_BUFFER *points, NV_F64_XYMBR mbr, int32_t width, int32_t height, OPTIONS *options,
+                              RUN_CALLBACKS *callbacks, float *grid, int32_t grid_rows, EXPORT_GRID *exports,
+                              int32_t count)
+{
+  uint8_t             cancelled = NVFalse;
+  int32_t             solves = 0;
+
+
+  for (int32_t e = 0 ; e < count ; e++)
+    {
+      if (exports[e].shared)
+        {
+          exports[e].grid = grid;
+          exports[e].grid_rows = grid_rows;
+        }
+      else
+        {
+          solves++;
+        }
+    }
+
+  if (!solves) return (NVFalse);
+
+
+#ifdef NVLinux
+
+  if (forked_exports (width, height, options))
+    {
+      //  These have been running since start_export_solves so, most of the time, they're already done.
+
+      callbacks->phase (QCoreApplication::translate ("pfmMisp", "Generating export surfaces"), solves);
+
+      int32_t done = 0;
+
+      while (done < solves)
+        {
+          uint8_t reaped = NVFalse;
+
+          for (int32_t e = 0 ; e < count ; e++)
+            {
+              if (exports[e].shared || !exports[e].pid) continue;
+
+              int status;
+              pid_t pid = waitpid (exports[e].pid, &status, WNOHANG);
+
+              if (pid == 0 || (pid < 0 && errno == EINTR)) continue;
+
+              exports[e].pid = 0;
+              reaped = NVTrue;
+              done++;
+
+              if (pid > 0 && WIFEXITED (status) && !WEXITSTATUS (status))
+                {
+                  exports[e].grid_rows = *mapped_rows (&exports[e]);
+                }
+              else
+                {
+                  if (!cancelled)
+                    callbacks->message (QCoreApplication::translate ("pfmMisp", "Unable to grid %1, it will be left empty").arg (exports[e].name));
+                }
+
+              callbacks->value (done);
+            }
+
+
+          if (!reaped)
+            {
+              usleep (50000);
+
+              if (!cancelled && callbacks->cancelled ())
+                {
+                  cancelled = NVTrue;
+
+                  for (int32_t e = 0 ; e < count ; e++) if (!exports[e].shared && exports[e].pid) kill (exports[e].pid, SIGTERM);
+                }
+            }
+        }
+
+      return (cancelled);
+    }
+
+#endif
+
+
+  //  One at a time, each of them using the row band threads (or one core for MISP if we can't fork).
+
+  for (int32_t e = 0 ; e < count && !cancelled ; e++)
+    {
+      if (exports[e].shared) continue;
+
+      OPTIONS export_options = *options;
+
+      export_options.surface = exports[e].surface;
+      export_options.tile_check = 0.0;
+
+      if (solve_surface (&points[exports[e].surface], NVFalse, mbr, width, height, &export_options, callbacks,
+                         exports[e].grid, &exports[e].grid_rows) == RUN_CANCELLED) cancelled = NVTrue;
+    }
+
+
+  return (cancelled);
+}
+
+
+
+/*  Writes the .hdr (and, for geographic PFMs, .prj) files and opens the .bil file for each export grid.  Row 0 of the
+    PFM is the southern row and BIL files start with the northern row so write_export_row seeks to the row.  */
+
+void open_export_grids (PFM_OPEN_ARGS *open_args, EXPORT_GRID *exports, int32_t count)
+{
+  FILE                *fp;
+  double              x_size, y_size;
+  uint16_t            order = 1;
+
+
+  BIN_HEADER *head = &open_args->head;
+
+  if (head->proj_data.projection)
+    {
+      x_size = y_size = head->bin_size_xy;
+    }
+  else
+    {
+      x_size = head->x_bin_size_degrees;
+      y_size = head->y_bin_size_degrees;
+    }
+
+
+  for (int32_t e = 0 ; e < count ; e++)
+    {
+      QString base = exports[e].name.left (exports[e].name.length () - 4);
+
+      if ((fp = fopen ((base + ".hdr").toLatin1 ().data (), "w")) == NULL)
+        {
+          perror ((base + ".hdr").toLatin1 ().data ());
+          exit (-1);
+        }
+
+      fprintf (fp, "BYTEORDER      %s\n", (*(uint8_t *) &order) ? "I" : "M");
+      fprintf (fp, "LAYOUT         BIL\n");
+      fprintf (fp, "NROWS          %d\n", head->bin_height);
+      fprintf (fp, "NCOLS          %d\n", head->bin_width);
+      fprintf (fp, "NBANDS         1\n");
+      fprintf (fp, "NBITS          32\n");
+      fprintf (fp, "PIXELTYPE      FLOAT\n");
+      fprintf (fp, "BANDROWBYTES   %d\n", head->bin_width * (int32_t) sizeof (float));
+      fprintf (fp, "TOTALROWBYTES  %d\n", head->bin_width * (int32_t) sizeof (float));
+      fprintf (fp, "ULXMAP         %.11f\n", head->mbr.min_x + x_size * 0.5);
+      fprintf (fp, "ULYMAP         %.11f\n", head->mbr.min_y + y_size * ((double) head->bin_height - 0.5));
+      fprintf (fp, "XDIM           %.11f\n", x_size);
+      fprintf (fp, "YDIM           %.11f\n", y_size);
+      fprintf (fp, "NODATA         %f\n", head->null_depth);
+
+      fclose (fp);
+
+
+      if (!head->proj_data.projection)
+        {
+          if ((fp = fopen ((base + ".prj").toLatin1 ().data (), "w")) == NULL)
+            {
+              perror ((base + ".prj").toLatin1 ().data ());
+              exit (-1);
+            }
+
+          fprintf (fp, "GEOGCS[\"GCS_WGS_1984\",DATUM[\"D_WGS_1984\",SPHEROID[\"WGS_1984\",6378137.0,298.257223563]],"
+                   "PRIMEM[\"Greenwich\",0.0],UNIT[\"Degree\",0.0174532925199433]]\n");
+
+          fclose (fp);
+        }
+
+
+      exports[e].file = new QFile (exports[e].name);
+
+      if (!exports[e].file->open (QIODevice::WriteOnly | QIODevice::Truncate) ||
+          !exports[e].file->resize ((qint64) head->bin_width * head->bin_height * sizeof (float)))
+        {
+          perror (exports[e].name.toLatin1 ().data ());
+          exit (-1);
+        }
+    }
+}
+
+
+
+//  Writes row "row" (PFM row order) of the export grid.
+
+void write_export_row (BIN_HEADER *head, EXPORT_GRID *export_grid, int32_t row, float *values)
+{
+  qint64 bytes = (qint64) head->bin_width * sizeof (float);
+
+  export_grid->file->seek ((qint64) (head->bin_height - 1 - row) * bytes);
+
+  if (export_grid->file->write ((char *) values, bytes) != bytes)
+    {
+      perror (export_grid->name.toLatin1 ().data ());
+      exit (-1);
+    }
+}
+
+
+
+/*  Closes the export grid files and frees the grids (not the PFM surface's).  If the run was cancelled the files are
+    incomplete so they're removed.  */
+
+void close_export_grids (EXPORT_GRID *exports, int32_t count, uint8_t cancelled, RUN_CALLBACKS *callbacks)
+{
+  for (int32_t e = 0 ; e < count ; e++)
+    {
+      if (exports[e].file)
+        {
+          exports[e].file->close ();
+          delete exports[e].file;
+          exports[e].file = NULL;
+
+          QString base = exports[e].name.left (exports[e].name.length () - 4);
+
+          if (cancelled)
+            {
+              QFile::remove (exports[e].name);
+              QFile::remove (base + ".hdr");
+              QFile::remove (base + ".prj");
+            }
+          else
+            {
+              callbacks->message (QCoreApplication::translate ("pfmMisp", "Exported %1").arg (exports[e].name));
+            }
+        }
+
+      if (!exports[e].shared) free_scratch_grid (&exports[e].scratch);
+
+      exports[e].grid = NULL;
+    }
+}
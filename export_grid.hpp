@@ -0,0 +1,77 @@
+
+/*********************************************************************************************
+
+    This is public domain software that was developed by or for the U.S. Naval Oceanographic
+    Office and/or the U.S. Army Corps of Engineers.
+
+    This is a work of the U.S. Government. In accordance with 17 USC 105, copyright protection
+    is not available for any work of the U.S. Government.
+
+    Neither the United States Government, nor any employees of the United States Government,
+    nor the author, makes any warranty, express or implied, without even the implied warranty
+    of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE, or assumes any liability or
+    responsibility for the accuracy, completeness, or usefulness of any information,
+    apparatus, product, or process disclosed, or represents that its use would not infringe
+    privately-owned rights. Reference herein to any specific commercial products, process,
+    or service by trade name, trademark, manufacturer, or otherwise, does not necessarily
+    constitute or imply its endorsement, recommendation, or favoring by the United States
+    Government. The views and opinions of authors expressed herein do not necessarily state
+    or reflect those of the United States Government, and shall not be used for advertising
+    or product endorsement purposes.
+*********************************************************************************************/
+
+
+/****************************************  IMPORTANT NOTE  **********************************
+
+    Comments in this file that start with / * ! or / / ! are being used by Doxygen to
+    document the software.  Dashes in these comment blocks are used to create bullet lists.
+    The lack of blank lines after a block of dash preceeded comments means that the next
+    block of dash preceeded comments is a new, indented bullet list.  I've tried to keep the
+    Doxygen formatting to a minimum but there are some other items (like <br> and <pre>)
+    that need to be left alone.  If you see a comment that starts with / * ! or / / ! and
+    there is something that looks a bit weird it is probably due to some arcane Doxygen
+    syntax.  Be very careful modifying blocks of Doxygen comments.
+
+*****************************************  IMPORTANT NOTE  **********************************/
+
+
+
+#ifndef EXPORT_GRID_H
+#define EXPORT_GRID_H
+
+#include "pfmMispDef.hpp"
+#include "scratch_grid.hpp"
+
+
+/*  A surface that is written to a grid file next to the PFM (PFM_FILE.misp_min.bil, PFM_FILE.misp_max.bil, or
+    PFM_FILE.misp_all.bil) instead of (or as well as) the PFM's average surface.  The grids are ESRI BIL (.bil and .hdr)
+    32 bit float files which GDAL reads as EHdr so they can be turned into GeoTIFFs or anything else with
+    gdal_translate.  The surfaces other than options->surface are solved in their own processes while the PFM surface
+    is being solved (see start_export_solves).  */
+
+typedef struct
+{
+  int32_t             surface;                    //  0 - minimum filtered, 1 - maximum filtered, 2 - all depths
+  float               *grid;                      //  bin_width by bin_height surface
+  int32_t             grid_rows;                  //  Rows retrieved from MISP
+  uint8_t             shared;                     //  This is the PFM surface so grid belongs to misp_surface
+  int64_t             bytes;                      //  Size of the grid block
+  SCRATCH_GRID        scratch;                    //  Where the grid block lives (see scratch_grid)
+  int32_t             pid;                        //  Process solving the surface (Linux)
+  QFile               *file;
+  QString             name;
+} EXPORT_GRID;
+
+
+int32_t alloc_export_grids (PFM_OPEN_ARGS *open_args, OPTIONS *options, EXPORT_GRID *exports);
+void start_export_solves (POINT_BUFFER *points, NV_F64_XYMBR mbr, int32_t width, int32_t height, OPTIONS *options,
+                          EXPORT_GRID *exports, int32_t count);
+uint8_t finish_export_solves (POINT_BUFFER *points, NV_F64_XYMBR mbr, int32_t width, int32_t height, OPTIONS *options,
+                              RUN_CALLBACKS *callbacks, float *grid, int32_t grid_rows, EXPORT_GRID *exports,
+                              int32_t count);
+void open_export_grids (PFM_OPEN_ARGS *open_args, EXPORT_GRID *exports, int32_t count);
+void write_export_row (BIN_HEADER *head, EXPORT_GRID *export_grid, int32_t row, float *values);
+void close_export_grids (EXPORT_GRID *exports, int32_t count, uint8_t cancelled, RUN_CALLBACKS *callbacks);
+
+
+#endif
@@ -0,0 +1,689 @@
+
+/*********************************************************************************************
+
+    This is public domain software that was developed by or for the U.S. Naval Oceanographic
+    Office and/or the U.S. Army Corps of Engineers.
+
+    This is a work of the U.S. Government. In accordance with 17 USC 105, copyright protection
+    is not available for any work of the U.S. Government.
+
+    Neither the United States Government, nor any employees of the United States Government,
+    nor the author, makes any warranty, express or implied, without even the implied warranty
+    of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE, or assumes any liability or
+    responsibility for the accuracy, completeness, or usefulness of any information,
+    apparatus, product, or process disclosed, or represents that its use would not infringe
+    privately-owned rights. Reference herein to any specific commercial products, process,
+    or service by trade name, trademark, manufacturer, or otherwise, does not necessarily
+    constitute or imply its endorsement, recommendation, or favoring by the United States
+    Government. The views and opinions of authors expressed herein do not necessarily state
+    or reflect those of the United States Government, and shall not be used for advertising
+    or product endorsement purposes.
+*********************************************************************************************/
+
+
+/****************************************  IMPORTANT NOTE  **********************************
+
+    Comments in this file that start with / * ! or / / ! are being used by Doxygen to
+    document the software.  Dashes in these comment blocks are used to create bullet lists.
+    The lack of blank lines after a block of dash preceeded comments means that the next
+    block of dash preceeded comments is a new, indented bullet list.  I've tried to keep the
+    Doxygen formatting to a minimum but there are some other items (like <br> and <pre>)
+    that need to be left alone.  If you see a comment that starts with / * ! or / / ! and
+    there is something that looks a bit weird it is probably due to some arcane Doxygen
+    syntax.  Be very careful modifying blocks of Doxygen comments.
+
+*****************************************  IMPORTANT NOTE  **********************************/
+
+
+
+#include "hole_fill.hpp"
+#include "polygon_spans.hpp"
+#include "solve_surface.hpp"
+#include "surface_engine.hpp"
+#include "run_bands.hpp"
+
+#include <cmath>
+#include <algorithm>
+#include <atomic>
+
+#ifdef NVLinux
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <signal.h>
+#include <unistd.h>
+#include <errno.h>
+#endif
+
+
+#define         HOLE_MIN_RING           8          /* Smallest ring of surrounding bins solved with a hole */
+
+
+//  There are usually far too many holes for MISP's progress messages to be any use.
+
+static void quiet_progress_callback (char *info __attribute__ ((unused)))
+{
+}
+
+
+
+/***************************************************************************\
+*                                                                           *
+*   Module Name:        label_holes                                         *
+*                                                                           *
+*   Purpose:            Finds the holes, the connected (4 neighbor) groups  *
+*                       of empty bins inside the PFM polygon that are going *
+*                       to be written with an interpolated value.  Bins     *
+*                       that the nibbling or the SRTM land clearing is      *
+*                       going to clear aren't part of a hole so those       *
+*                       planes (RASTER_NEAR and RASTER_SRTM) have to be     *
+*                       filled first.  Each hole gets a ring of             *
+*                       surrounding bins (half of the hole's size, at least *
+*                       HOLE_MIN_RING and at most the tile halo) so MISP    *
+*                       has real data all around it.  If the holes and      *
+*                       their rings cover more than half of the PFM it's    *
+*                       faster to solve the whole thing.                    *
+*                                                                           *
+*   Arguments:          head            -   PFM bin header                  *
+*                       raster          -   bin raster                      *
+*                       options         -   run options                     *
+*                       callbacks       -   progress hooks                  *
+*                       holes           -   returned holes                  *
+*                                                                           *
+*   Returns:            NVTrue if the holes should be solved one by one     *
+*                       (see fill_holes), NVFalse to solve the whole PFM    *
+*                                                                           *
+\***************************************************************************/
+
+uint8_t label_holes (BIN_HEADER *head, BIN_RASTER *raster, OPTIONS *options, RUN_CALLBACKS *callbacks, HOLE_SET *holes)
+{
+  POLYGON_SPANS       polygon;
+  int64_t             *stack, stack_size, sp, area = 0;
+  int32_t             size = 0;
+
+
+  int32_t width = head->bin_width;
+  int32_t height = head->bin_height;
+
+  uint8_t nibble_flag = (options->clear_int && options->nibble);
+
+  holes->count = 0;
+  holes->hole = NULL;
+
+  holes->label = (int32_t *) alloc_scratch_grid (&holes->label_scratch, (int64_t) width * height * sizeof (int32_t),
+                                                 NVFalse);
+
+
+  //  If nibble is 0 with clear_int set nothing gets interpolated so there are no holes at all.
+
+  if (options->clear_int && !options->nibble) return (NVTrue);
+
+
+  //  Mark every bin that is going to get an interpolated value with -1.
+
+  build_polygon_spans (head, &polygon);
+
+  for (int32_t i = 0 ; i < height ; i++)
+    {
+      for (int32_t k = polygon.first[i] ; k < polygon.first[i + 1] ; k++)
+        {
+          for (int32_t j = polygon.spans[k].start ; j <= polygon.spans[k].end ; j++)
+            {
+              if (raster_get (raster, RASTER_DATA, j, i)) continue;
+
+              if (nibble_flag && !raster_get (raster, RASTER_NEAR, j, i)) continue;
+
+              if (options->clear_land && !raster_get (raster, RASTER_SOUNDINGS, j, i) &&
+                  raster_get (raster, RASTER_SRTM, j, i)) continue;
+
+              holes->label[(int64_t) i * width + j] = -1;
+            }
+        }
+    }
+
+  free_polygon_spans (&polygon);
+
+
+  //  Flood fill each hole.
+
+  stack_size = 4096;
+  stack = (int64_t *) malloc (stack_size * sizeof (int64_t));
+
+  if (stack == NULL)
+    {
+      perror ("Allocating hole stack");
+      exit (-1);
+    }
+
+  for (int64_t k = 0 ; k < (int64_t) width * height ; k++)
+    {
+      if (holes->label[k] != -1) continue;
+
+      if (holes->count == size)
+        {
+          size = size ? size * 2 : 1024;
+
+          holes->hole = (HOLE *) realloc (holes->hole, size * sizeof (HOLE));
+
+          if (holes->hole == NULL)
+            {
+              perror ("Allocating holes");
+              exit (-1);
+            }
+        }
+
+      int32_t number = holes->count++;
+      HOLE *hole = &holes->hole[number];
+
+      hole->x0 = hole->x1 = k % width;
+      hole->y0 = hole->y1 = k / width;
+      hole->bins = 0;
+
+      holes->label[k] = number + 1;
+      stack[0] = k;
+      sp = 1;
+
+      while (sp)
+        {
+          int64_t bin = stack[--sp];
+          int32_t x = bin % width;
+          int32_t y = bin / width;
+
+          hole->x0 = MIN (hole->x0, x);
+          hole->x1 = MAX (hole->x1, x);
+          hole->y0 = MIN (hole->y0, y);
+          hole->y1 = MAX (hole->y1, y);
+          hole->bins++;
+
+
+          //  Each bin goes on the stack once (when it's labeled) so the stack never needs more than four more slots.
+
+          if (sp + 4 > stack_size)
+            {
+              stack_size *= 2;
+
+              stack = (int64_t *) realloc (stack, stack_size * sizeof (int64_t));
+
+              if (stack == NULL)
+                {
+                  perror ("Allocating hole stack");
+                  exit (-1);
+                }
+            }
+
+          if (x > 0 && holes->label[bin - 1] == -1) holes->label[stack[sp++] = bin - 1] = number + 1;
+          if (x < width - 1 && holes->label[bin + 1] == -1) holes->label[stack[sp++] = bin + 1] = number + 1;
+          if (y > 0 && holes->label[bin - width] == -1) holes->label[stack[sp++] = bin - width] = number + 1;
+          if (y < height - 1 && holes->label[bin + width] == -1) holes->label[stack[sp++] = bin + width] = number + 1;
+        }
+
+      hole->x1++;
+      hole->y1++;
+
+
+      int32_t ring = MIN (MAX (HOLE_MIN_RING, MAX (hole->x1 - hole->x0, hole->y1 - hole->y0) / 2),
+                          MAX (options->tile_halo, HOLE_MIN_RING));
+
+      hole->ex0 = MAX (hole->x0 - ring, 0);
+      hole->ey0 = MAX (hole->y0 - ring, 0);
+      hole->ex1 = MIN (hole->x1 + ring, width);
+      hole->ey1 = MIN (hole->y1 + ring, height);
+
+      area += (int64_t) (hole->ex1 - hole->ex0) * (hole->ey1 - hole->ey0);
+    }
+
+  free (stack);
+
+
+  if (area > (int64_t) width * height / 2)
+    {
+      callbacks->message (QCoreApplication::translate ("pfmMisp", "%1 holes cover most of the PFM, solving the whole "
+                                                       "surface").arg (holes->count));
+      free_holes (holes);
+      return (NVFalse);
+    }
+
+
+  callbacks->message (QCoreApplication::translate ("pfmMisp", "Filling %1 holes (%2 grid nodes)").arg (holes->count).
+                      arg ((qlonglong) area));
+
+  return (NVTrue);
+}
+
+
+
+/*  The points are bucketed by row so each hole can find its points without looking at all of them.  The points in row
+    i are row_index[row_start[i]] through row_index[row_start[i + 1] - 1].  order is the holes, largest first.  */
+
+typedef struct
+{
+  POINT_BUFFER        *points;
+  int64_t             *row_start;
+  int64_t             *row_index;
+  HOLE_SET            *holes;
+  int32_t             *order;
+  int32_t             width;
+  OPTIONS             *options;
+  float               *grid;
+  std::atomic<bool>   failed;
+  BAND_STATUS         status;
+} HOLE_ARGS;
+
+
+
+//  Room (points) that hole_points needs for a hole.
+
+static int64_t hole_space (HOLE_ARGS *args, HOLE *hole)
+{
+  return (MAX (args->row_start[hole->ey1] - args->row_start[hole->ey0], 1));
+}
+
+
+
+//  Puts the points in a hole's bounding box plus the ring in "index" and returns the number of them.
+
+static int64_t hole_points (HOLE_ARGS *args, HOLE *hole, int64_t *index)
+{
+  int64_t             count = 0;
+
+
+  for (int64_t k = args->row_start[hole->ey0] ; k < args->row_start[hole->ey1] ; k++)
+    {
+      double x = args->points->x[args->row_index[k]];
+
+      if (x >= (double) hole->ex0 && x < (double) hole->ex1) index[count++] = args->row_index[k];
+    }
+
+  return (count);
+}
+
+
+
+//  Puts the values for the hole's own bins from its solved area ("out") in the grid.
+
+static void place_hole (HOLE_ARGS *args, int32_t number, float *out)
+{
+  HOLE *hole = &args->holes->hole[number];
+
+  int32_t ew = hole->ex1 - hole->ex0;
+
+  for (int32_t y = hole->y0 ; y < hole->y1 ; y++)
+    {
+      for (int32_t x = hole->x0 ; x < hole->x1 ; x++)
+        {
+          int64_t k = (int64_t) y * args->width + x;
+
+          if (args->holes->label[k] != number + 1) continue;
+
+          float value = out[(int64_t) (y - hole->ey0) * ew + (x - hole->ex0)];
+
+          args->grid[k] = std::isnan (value) ? NO_GRID_VALUE : value;
+        }
+    }
+}
+
+
+
+//  Solves one hole over its bounding box plus the ring with the selected engine and puts the result in the grid.
+
+static int32_t solve_hole (HOLE_ARGS *args, int32_t number)
+{
+  HOLE *hole = &args->holes->hole[number];
+
+  int32_t ew = hole->ex1 - hole->ex0;
+  int32_t eh = hole->ey1 - hole->ey0;
+
+
+  int64_t *index = (int64_t *) malloc (hole_space (args, hole) * sizeof (int64_t));
+  float *out = (float *) malloc ((int64_t) ew * eh * sizeof (float));
+
+  if (index == NULL || out == NULL) return (-1);
+
+  int64_t count = hole_points (args, hole, index);
+
+  int32_t status = solve_local (args->points, index, count, hole->ex0, hole->ey0, hole->ex1, hole->ey1, args->options,
+                                out);
+
+  if (!status) place_hole (args, number, out);
+
+  free (out);
+  free (index);
+
+
+  return (status);
+}
+
+
+
+//  Solves the holes order[start] through order[end - 1] in one of the row band threads.
+
+static void hole_band (int32_t band __attribute__ ((unused)), int32_t start, int32_t end, void *data)
+{
+  HOLE_ARGS *args = (HOLE_ARGS *) data;
+
+  for (int32_t h = start ; h < end ; h++)
+    {
+      if (args->status.cancel) break;
+
+      if (solve_hole (args, args->order[h])) args->failed = true;
+
+      args->status.rows_done++;
+    }
+}
+
+
+
+/***************************************************************************\
+*                                                                           *
+*   Module Name:        fill_holes                                          *
+*                                                                           *
+*   Purpose:            Solves each hole from label_holes on its own small  *
+*                       grid and puts the results in the surface grid.      *
+*                       Every other bin gets NO_GRID_VALUE (write_surface   *
+*                       won't write them unless they're nibbled).  The      *
+*                       local engines solve the holes in the row band       *
+*                       threads (largest holes first).  MISP keeps its      *
+*                       state in static memory so, on Linux, the holes are  *
+*                       split between one child process per core (largest   *
+*                       holes first, each to the least loaded process)      *
+*                       that write straight into the grid so the grid has   *
+*                       to be a shared scratch grid.  The children only run *
+*                       misp_grid (see solve_surface), their buffers are    *
+*                       allocated here before the fork.  Everywhere else    *
+*                       MISP solves them one at a time.                     *
+*                                                                           *
+*   Arguments:          points          -   normalized (bin unit) points    *
+*                       holes           -   holes from label_holes          *
+*                       width           -   grid width (bins)               *
+*                       height          -   grid height (bins)              *
+*                       options         -   run options                     *
+*                       callbacks       -   progress hooks                  *
+*                       grid            -   width * height output grid      *
+*                                                                           *
+*   Returns:            0 or RUN_CANCELLED                                  *
+*                                                                           *
+\***************************************************************************/
+
+int32_t fill_holes (POINT_BUFFER *points, HOLE_SET *holes, int32_t width, int32_t height, OPTIONS *options,
+                    RUN_CALLBACKS *callbacks, float *grid)
+{
+  HOLE_ARGS           args;
+  int64_t             *cursor;
+  uint8_t             cancelled = NVFalse;
+
+
+  for (int64_t k = 0 ; k < (int64_t) width * height ; k++) grid[k] = NO_GRID_VALUE;
+
+  if (!holes->count) return (0);
+
+
+  args.points = points;
+  args.holes = holes;
+  args.width = width;
+  args.options = options;
+  args.grid = grid;
+  args.failed = false;
+
+
+  //  Bucket the points by row.
+
+  args.row_start = (int64_t *) calloc (height + 1, sizeof (int64_t));
+  cursor = (int64_t *) malloc (height * sizeof (int64_t));
+  args.row_index = (int64_t *) malloc (MAX (points->count, 1) * sizeof (int64_t));
+  args.order = (int32_t *) malloc (holes->count * sizeof (int32_t));
+
+  if (args.row_start == NULL || cursor == NULL || args.row_index == NULL || args.order == NULL)
+    {
+      perror ("Allocating hole point index");
+      exit (-1);
+    }
+
+  for (int64_t k = 0 ; k < points->count ; k++)
+    {
+      int32_t row = MIN (MAX ((int32_t) floor (points->y[k]), 0), height - 1);
+
+      args.row_start[row + 1]++;
+    }
+
+  for (int32_t i = 0 ; i < height ; i++)
+    {
+      args.row_start[i + 1] += args.row_start[i];
+      cursor[i] = args.row_start[i];
+    }
+
+  for (int64_t k = 0 ; k < points->count ; k++)
+    {
+      int32_t row = MIN (MAX ((int32_t) floor (points->y[k]), 0), height - 1);
+
+      args.row_index[cursor[row]++] = k;
+    }
+
+  free (cursor);
+
+
+  //  Largest first.
+
+  HOLE *hole = holes->hole;
+
+  for (int32_t h = 0 ; h < holes->count ; h++) args.order[h] = h;
+
+  std::sort (args.order, args.order + holes->count, [hole] (int32_t a, int32_t b)
+             {
+               return ((int64_t) (hole[a].ex1 - hole[a].ex0) * (hole[a].ey1 - hole[a].ey0) >
+                       (int64_t) (hole[b].ex1 - hole[b].ex0) * (hole[b].ey1 - hole[b].ey0));
+             });
+
+
+  callbacks->phase (QCoreApplication::translate ("pfmMisp", "Filling holes"), holes->count);
+
+
+  if (!surface_engines[options->engine].global_state)
+    {
+      cancelled = run_bands (holes->count, band_count (holes->count), hole_band, &args, &args.status, callbacks);
+    }
+  else
+    {
+      misp_register_progress_callback (quiet_progress_callback);
+
+#ifdef NVLinux
+
+      int32_t procs = MIN (QThread::idealThreadCount (), holes->count);
+
+
+      //  Each hole goes to the process with the least work so far.
+
+      int32_t *group = (int32_t *) malloc (holes->count * sizeof (int32_t));
+      int64_t *load = (int64_t *) calloc (procs, sizeof (int64_t));
+      pid_t *pids = (pid_t *) calloc (procs, sizeof (pid_t));
+
+      if (group == NULL || load == NULL || pids == NULL)
+        {
+          perror ("Allocating hole processes");
+          exit (-1);
+        }
+
+      int64_t max_points = 1, max_area = 0;
+      int32_t max_width = 0;
+
+      for (int32_t h = 0 ; h < holes->count ; h++)
+        {
+          int32_t g = 0;
+          int32_t o = args.order[h];
+          int64_t area = (int64_t) (hole[o].ex1 - hole[o].ex0) * (hole[o].ey1 - hole[o].ey0);
+
+          for (int32_t p = 1 ; p < procs ; p++) if (load[p] < load[g]) g = p;
+
+          group[o] = g;
+          load[g] += area;
+
+          max_points = MAX (max_points, hole_space (&args, &hole[o]));
+          max_area = MAX (max_area, area);
+          max_width = MAX (max_width, hole[o].ex1 - hole[o].ex0);
+        }
+
+
+      /*  The children's point index and output (plus the misp_rtrv row) for the biggest hole.  Each child writes its
+          own copy.  */
+
+      int64_t *index = (int64_t *) malloc (max_points * sizeof (int64_t));
+      float *work = (float *) malloc ((max_area + max_width + 1) * sizeof (float));
+
+      if (index == NULL || work == NULL)
+        {
+          perror ("Allocating hole buffers");
+          exit (-1);
+        }
+
+
+      //  Each process counts the holes it has done in its own slot so we can show progress.
+
+      int32_t *progress = (int32_t *) mmap (NULL, procs * sizeof (int32_t), PROT_READ | PROT_WRITE,
+                                            MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+
+      if (progress == MAP_FAILED)
+        {
+          perror ("Mapping hole progress");
+          exit (-1);
+        }
+
+      for (int32_t p = 0 ; p < procs ; p++)
+        {
+          progress[p] = 0;
+
+          pid_t pid = fork ();
+
+          if (pid < 0)
+            {
+              perror ("Starting hole process");
+              exit (-1);
+            }
+
+          if (pid == 0)
+            {
+              int32_t status = 0;
+
+              //  Same as the tiles, SIGTERM from a cancelled run has to kill us even if batch mode handles it.
+
+              signal (SIGTERM, SIG_DFL);
+
+              for (int32_t h = 0 ; h < holes->count ; h++)
+                {
+                  int32_t o = args.order[h];
+
+                  if (group[o] != p) continue;
+
+                  int32_t ew = hole[o].ex1 - hole[o].ex0;
+                  int32_t eh = hole[o].ey1 - hole[o].ey0;
+
+                  int64_t count = hole_points (&args, &hole[o], index);
+
+                  if (misp_grid (points, index, count, area_mbr (hole[o].ex0, hole[o].ey0, hole[o].ex1, hole[o].ey1),
+                                 ew, eh, options->weight, work, &work[(int64_t) ew * eh]) < 0)
+                    {
+                      status = 1;
+                    }
+                  else
+                    {
+                      place_hole (&args, o, work);
+                    }
+
+                  progress[p]++;
+                }
+
+              _exit (status);
+            }
+
+          pids[p] = pid;
+        }
+
+
+      int32_t running = procs;
+
+      while (running)
+        {
+          uint8_t reaped = NVFalse;
+
+          for (int32_t p = 0 ; p < procs ; p++)
+            {
+              if (!pids[p]) continue;
+
+              int status;
+              pid_t pid = waitpid (pids[p], &status, WNOHANG);
+
+              if (pid == 0 || (pid < 0 && errno == EINTR)) continue;
+
+              pids[p] = 0;
+              running--;
+              reaped = NVTrue;
+
+              if (!(pid > 0 && WIFEXITED (status) && !WEXITSTATUS (status))) args.failed = true;
+            }
+
+
+          int32_t done = 0;
+
+          for (int32_t p = 0 ; p < procs ; p++) done += progress[p];
+
+          callbacks->value (done);
+
+
+          if (!reaped)
+            {
+              usleep (50000);
+
+              if (!cancelled && callbacks->cancelled ())
+                {
+                  cancelled = NVTrue;
+
+                  for (int32_t p = 0 ; p < procs ; p++) if (pids[p]) kill (pids[p], SIGTERM);
+                }
+            }
+        }
+
+      munmap (progress, procs * sizeof (int32_t));
+      free (work);
+      free (index);
+      free (pids);
+      free (load);
+      free (group);
+
+#else
+
+      for (int32_t h = 0 ; h < holes->count ; h++)
+        {
+          if (solve_hole (&args, args.order[h])) args.failed = true;
+
+          callbacks->value (h + 1);
+
+          if (callbacks->cancelled ())
+            {
+              cancelled = NVTrue;
+              break;
+            }
+        }
+
+#endif
+    }
+
+
+  if (args.failed && !cancelled)
+    callbacks->message (QCoreApplication::translate ("pfmMisp", "Unable to fill some holes, they will be left empty"));
+
+  free (args.order);
+  free (args.row_index);
+  free (args.row_start);
+
+
+  return (cancelled ? RUN_CANCELLED : 0);
+}
+
+
+
+void free_holes (HOLE_SET *holes)
+{
+  free (holes->hole);
+  holes->hole = NULL;
+  holes->count = 0;
+
+  free_scratch_grid (&holes->label_scratch);
+  holes->label = NULL;
+}
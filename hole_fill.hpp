@@ -0,0 +1,74 @@
+
+/*********************************************************************************************
+
+    This is public domain software that was developed by or for the U.S. Naval Oceanographic
+    Office and/or the U.S. Army Corps of Engineers.
+
+    This is a work of the U.S. Government. In accordance with 17 USC 105, copyright protection
+    is not available for any work of the U.S. Government.
+
+    Neither the United States Government, nor any employees of the United States Government,
+    nor the author, makes any warranty, express or implied, without even the implied warranty
+    of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE, or assumes any liability or
+    responsibility for the accuracy, completeness, or usefulness of any information,
+    apparatus, product, or process disclosed, or represents that its use would not infringe
+    privately-owned rights. Reference herein to any specific commercial products, process,
+    or service by trade name, trademark, manufacturer, or otherwise, does not necessarily
+    constitute or imply its endorsement, recommendation, or favoring by the United States
+    Government. The views and opinions of authors expressed herein do not necessarily state
+    or reflect those of the United States Government, and shall not be used for advertising
+    or product endorsement purposes.
+*********************************************************************************************/
+
+
+/****************************************  IMPORTANT NOTE  **********************************
+
+    Comments in this file that start with / * ! or / / ! are being used by Doxygen to
+    document the software.  Dashes in these comment blocks are used to create bullet lists.
+    The lack of blank lines after a block of dash preceeded comments means that the next
+    block of dash preceeded comments is a new, indented bullet list.  I've tried to keep the
+    Doxygen formatting to a minimum but there are some other items (like <br> and <pre>)
+    that need to be left alone.  If you see a comment that starts with / * ! or / / ! and
+    there is something that looks a bit weird it is probably due to some arcane Doxygen
+    syntax.  Be very careful modifying blocks of Doxygen comments.
+
+*****************************************  IMPORTANT NOTE  **********************************/
+
+
+
+#ifndef HOLE_FILL_H
+#define HOLE_FILL_H
+
+#include "pfmMispDef.hpp"
+#include "bin_raster.hpp"
+#include "scratch_grid.hpp"
+
+
+/*  The connected (4 neighbor) groups of empty bins inside the PFM polygon that are going to get an interpolated value.
+    When we're not replacing all bins these are the only bins that need a surface so each one can be solved on its
+    own small grid instead of solving the whole PFM (see fill_holes).  */
+
+typedef struct
+{
+  int32_t             x0, y0, x1, y1;             //  Bounding box of the hole's bins (x1/y1 exclusive)
+  int32_t             ex0, ey0, ex1, ey1;         //  Bounding box plus the ring of surrounding bins
+  int64_t             bins;                       //  Number of bins in the hole
+} HOLE;
+
+
+typedef struct
+{
+  int32_t             count;
+  HOLE                *hole;
+  int32_t             *label;                     //  Hole number + 1 for each bin, 0 for bins that aren't in a hole
+  SCRATCH_GRID        label_scratch;
+} HOLE_SET;
+
+
+uint8_t label_holes (BIN_HEADER *head, BIN_RASTER *raster, OPTIONS *options, RUN_CALLBACKS *callbacks, HOLE_SET *holes);
+int32_t fill_holes (POINT_BUFFER *points, HOLE_SET *holes, int32_t width, int32_t height, OPTIONS *options,
+                    RUN_CALLBACKS *callbacks, float *grid);
+void free_holes (HOLE_SET *holes);
+
+
+#endif
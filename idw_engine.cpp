@@ -0,0 +1,265 @@
+
+/*********************************************************************************************
+
+    This is public domain software that was developed by or for the U.S. Naval Oceanographic
+    Office and/or the U.S. Army Corps of Engineers.
+
+    This is a work of the U.S. Government. In accordance with 17 USC 105, copyright protection
+    is not available for any work of the U.S. Government.
+
+    Neither the United States Government, nor any employees of the United States Government,
+    nor the author, makes any warranty, express or implied, without even the implied warranty
+    of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE, or assumes any liability or
+    responsibility for the accuracy, completeness, or usefulness of any information,
+    apparatus, product, or process disclosed, or represents that its use would not infringe
+    privately-owned rights. Reference herein to any specific commercial products, process,
+    or service by trade name, trademark, manufacturer, or otherwise, does not necessarily
+    constitute or imply its endorsement, recommendation, or favoring by the United States
+    Government. The views and opinions of authors expressed herein do not necessarily state
+    or reflect those of the United States Government, and shall not be used for advertising
+    or product endorsement purposes.
+*********************************************************************************************/
+
+
+/****************************************  IMPORTANT NOTE  **********************************
+
+    Comments in this file that start with / * ! or / / ! are being used by Doxygen to
+    document the software.  Dashes in these comment blocks are used to create bullet lists.
+    The lack of blank lines after a block of dash preceeded comments means that the next
+    block of dash preceeded comments is a new, indented bullet list.  I've tried to keep the
+    Doxygen formatting to a minimum but there are some other items (like <br> and <pre>)
+    that need to be left alone.  If you see a comment that starts with / * ! or / / ! and
+    there is something that looks a bit weird it is probably due to some arcane Doxygen
+    syntax.  Be very careful modifying blocks of Doxygen comments.
+
+*****************************************  IMPORTANT NOTE  **********************************/
+
+
+
+#include "idw_engine.hpp"
+#include "surface_engine.hpp"
+#include "scratch_grid.hpp"
+#include "run_bands.hpp"
+
+#include <cmath>
+
+
+#define         IDW_NEIGHBORS           8          /* Points we want before we stop looking further out */
+
+
+/*  The points are bucketed by their nearest grid node (see nearest_node) so each node only has to look at the cells
+    around it.  The points in cell (j, i) of the area are cell_index[cell_start[k]] through cell_index[cell_start[k + 1] - 1] where
+    k = i * width + j.  */
+
+typedef struct
+{
+  POINT_BUFFER        *points;
+  int64_t             *cell_start;
+  int64_t             *cell_index;
+  int32_t             x0, y0, width, height;
+  int32_t             reach;
+  float               *out;
+  BAND_STATUS         status;
+} IDW_ARGS;
+
+
+
+//  Adds the points in bin (cx, cy) of the area to the sums.  Returns NVTrue if one of them is right on the node.
+
+static uint8_t add_cell (IDW_ARGS *args, int32_t cx, int32_t cy, double px, double py, double *sum_w, double *sum_wz,
+                         int64_t *found, float *value)
+{
+  if (cx < 0 || cx >= args->width || cy < 0 || cy >= args->height) return (NVFalse);
+
+  int64_t k = (int64_t) cy * args->width + cx;
+
+  for (int64_t n = args->cell_start[k] ; n < args->cell_start[k + 1] ; n++)
+    {
+      int64_t p = args->cell_index[n];
+
+      double dx = args->points->x[p] - px;
+      double dy = args->points->y[p] - py;
+      double d2 = dx * dx + dy * dy;
+
+      if (d2 < 1.0e-12)
+        {
+          *value = args->points->z[p];
+          return (NVTrue);
+        }
+
+
+      //  Inverse distance squared.
+
+      *sum_w += 1.0 / d2;
+      *sum_wz += args->points->z[p] / d2;
+      (*found)++;
+    }
+
+  return (NVFalse);
+}
+
+
+
+/*  Grids rows start_row to end_row - 1 of the area.  Each node looks at square rings of bins around its own bin until
+    it has IDW_NEIGHBORS points, then takes one more ring so the square doesn't bias the result, or gives up at the
+    reach.  */
+
+static void idw_rows (int32_t band __attribute__ ((unused)), int32_t start_row, int32_t end_row, void *data)
+{
+  IDW_ARGS *args = (IDW_ARGS *) data;
+
+
+  for (int32_t i = start_row ; i < end_row ; i++)
+    {
+      if (args->status.cancel) break;
+
+      for (int32_t j = 0 ; j < args->width ; j++)
+        {
+          double px = (double) (args->x0 + j);
+          double py = (double) (args->y0 + i);
+          double sum_w = 0.0, sum_wz = 0.0;
+          int64_t found = 0;
+          int32_t last = args->reach;
+          float value = NAN;
+          uint8_t hit = NVFalse;
+
+
+          for (int32_t r = 0 ; r <= last && !hit ; r++)
+            {
+              if (!r)
+                {
+                  hit = add_cell (args, j, i, px, py, &sum_w, &sum_wz, &found, &value);
+                }
+              else
+                {
+                  for (int32_t c = j - r ; c <= j + r && !hit ; c++)
+                    {
+                      hit = add_cell (args, c, i - r, px, py, &sum_w, &sum_wz, &found, &value) ||
+                        add_cell (args, c, i + r, px, py, &sum_w, &sum_wz, &found, &value);
+                    }
+
+                  for (int32_t c = i - r + 1 ; c <= i + r - 1 && !hit ; c++)
+                    {
+                      hit = add_cell (args, j - r, c, px, py, &sum_w, &sum_wz, &found, &value) ||
+                        add_cell (args, j + r, c, px, py, &sum_w, &sum_wz, &found, &value);
+                    }
+                }
+
+              if (found >= IDW_NEIGHBORS && last == args->reach) last = MIN (r + 1, args->reach);
+            }
+
+          if (!hit && found) value = (float) (sum_wz / sum_w);
+
+          args->out[(int64_t) i * args->width + j] = value;
+        }
+
+      args->status.rows_done++;
+    }
+}
+
+
+
+/***************************************************************************\
+*                                                                           *
+*   Module Name:        idw_solve                                           *
+*                                                                           *
+*   Purpose:            Inverse distance weighting engine (see              *
+*                       surface_engine).  Each grid node gets the inverse   *
+*                       distance squared weighted mean of the points in     *
+*                       the cells around it (at least IDW_NEIGHBORS of them *
+*                       if they're within engine_reach bins).  The points   *
+*                       are bucketed by node first so the search is local.  *
+*                       For the whole grid the rows are done in the row     *
+*                       band threads.                                       *
+*                                                                           *
+*   Arguments:          See SURFACE_ENGINE in surface_engine.hpp            *
+*                                                                           *
+*   Returns:            0 or RUN_CANCELLED                                  *
+*                                                                           *
+\***************************************************************************/
+
+int32_t idw_solve (POINT_BUFFER *points, int64_t *index, int64_t count, int32_t x0, int32_t y0, int32_t x1, int32_t y1,
+                   OPTIONS *options, RUN_CALLBACKS *callbacks, float *out)
+{
+  IDW_ARGS            args;
+  SCRATCH_GRID        cell_scratch;
+  uint8_t             cancelled = NVFalse;
+
+
+  args.points = points;
+  args.x0 = x0;
+  args.y0 = y0;
+  args.width = x1 - x0;
+  args.height = y1 - y0;
+  args.reach = engine_reach (options);
+  args.out = out;
+
+  int64_t cells = (int64_t) args.width * args.height;
+
+
+  //  The cell counts are as big as the grid so, out of core, they go in a scratch file too.
+
+  args.cell_start = (int64_t *) alloc_scratch_grid (&cell_scratch, (cells + 1) * sizeof (int64_t), NVFalse);
+  args.cell_index = (int64_t *) malloc (MAX (count, 1) * sizeof (int64_t));
+
+  if (args.cell_index == NULL)
+    {
+      perror ("Allocating IDW index");
+      exit (-1);
+    }
+
+
+  /*  Count, then fill using cell_start as the cursor, then shift it back (the points outside the area are left out).
+      This way the only grid sized array is cell_start.  */
+
+  for (int32_t pass = 0 ; pass < 2 ; pass++)
+    {
+      for (int64_t n = 0 ; n < count ; n++)
+        {
+          int64_t p = index ? index[n] : n;
+
+          int32_t cx = nearest_node (points->x[p], x0, args.width);
+          int32_t cy = nearest_node (points->y[p], y0, args.height);
+
+          if (cx < 0 || cy < 0) continue;
+
+          int64_t k = (int64_t) cy * args.width + cx;
+
+          if (pass)
+            {
+              args.cell_index[args.cell_start[k]++] = p;
+            }
+          else
+            {
+              args.cell_start[k + 1]++;
+            }
+        }
+
+
+      if (!pass) for (int64_t k = 0 ; k < cells ; k++) args.cell_start[k + 1] += args.cell_start[k];
+    }
+
+  memmove (&args.cell_start[1], &args.cell_start[0], cells * sizeof (int64_t));
+  args.cell_start[0] = 0;
+
+
+  if (callbacks)
+    {
+      callbacks->phase (QCoreApplication::translate ("pfmMisp", "Generating IDW surface"), args.height);
+
+      cancelled = run_bands (args.height, band_count (args.height), idw_rows, &args, &args.status, callbacks);
+    }
+  else
+    {
+      args.status.cancel = false;
+
+      idw_rows (0, 0, args.height, &args);
+    }
+
+
+  free (args.cell_index);
+  free_scratch_grid (&cell_scratch);
+
+
+  return (cancelled ? RUN_CANCELLED : 0);
+}
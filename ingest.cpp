@@ -0,0 +1,536 @@
+
+/*********************************************************************************************
+
+    This is public domain software that was developed by or for the U.S. Naval Oceanographic
+    Office and/or the U.S. Army Corps of Engineers.
+
+    This is a work of the U.S. Government. In accordance with 17 USC 105, copyright protection
+    is not available for any work of the U.S. Government.
+
+    Neither the United States Government, nor any employees of the United States Government,
+    nor the author, makes any warranty, express or implied, without even the implied warranty
+    of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE, or assumes any liability or
+    responsibility for the accuracy, completeness, or usefulness of any information,
+    apparatus, product, or process disclosed, or represents that its use would not infringe
+    privately-owned rights. Reference herein to any specific commercial products, process,
+    or service by trade name, trademark, manufacturer, or otherwise, does not necessarily
+    constitute or imply its endorsement, recommendation, or favoring by the United States
+    Government. The views and opinions of authors expressed herein do not necessarily state
+    or reflect those of the United States Government, and shall not be used for advertising
+    or product endorsement purposes.
+*********************************************************************************************/
+
+
+/****************************************  IMPORTANT NOTE  **********************************
+
+    Comments in this file that start with / * ! or / / ! are being used by Doxygen to
+    document the software.  Dashes in these comment blocks are used to create bullet lists.
+    The lack of blank lines after a block of dash preceeded comments means that the next
+    block of dash preceeded comments is a new, indented bullet list.  I've tried to keep the
+    Doxygen formatting to a minimum but there are some other items (like <br> and <pre>)
+    that need to be left alone.  If you see a comment that starts with / * ! or / / ! and
+    there is something that looks a bit weird it is probably due to some arcane Doxygen
+    syntax.  Be very careful modifying blocks of Doxygen comments.
+
+*****************************************  IMPORTANT NOTE  **********************************/
+
+
+
+#include "ingest.hpp"
+#include "occupancy.hpp"
+#include "point_buffer.hpp"
+#include "point_ring.hpp"
+#include "solve_surface.hpp"
+#include "reduce_bin.hpp"
+
+
+/*  The PFM library keeps its open file table in static memory so we don't let more than one thread open or close a
+    handle at a time.  Reads on different handles are independent.  */
+
+static QMutex pfm_open_mutex;
+
+
+/*  The bands read and filter the depth records and pass the points on in chunks, through a ring for each band and
+    surface (rings[surface * bands + band]), to the calling thread.  That collects them, in band order, in
+    points[surface] and, for a single grid solve, loads the points for options->surface into MISP while the bands keep
+    reading.  */
+
+typedef struct
+{
+  PFM_OPEN_ARGS       *open_args;
+  OPTIONS             *options;
+  BIN_RASTER          *raster;
+  OCCUPANCY           *occupancy;
+  POINT_RING          *rings;
+  POINT_BUFFER        *points;
+  int32_t             surfaces;                   //  1 << surface for each surface being ingested
+  int32_t             bands;
+  int32_t             next_band;                  //  Band the consumer is working on
+  uint8_t             load;                       //  Load the points into MISP as they come in
+  double              x_scale, y_scale;
+  std::atomic<int64_t> soundings;
+  std::atomic<int64_t> removed;                   //  Points removed by the bin reduction
+  BAND_STATUS         status;
+} INGEST_DATA;
+
+
+
+int32_t open_band_pfm (PFM_OPEN_ARGS *band_args, char *list_path)
+{
+  QMutexLocker lock (&pfm_open_mutex);
+
+  strcpy (band_args->list_path, list_path);
+
+  band_args->checkpoint = 0;
+
+  return (open_existing_pfm_file (band_args));
+}
+
+
+
+void close_band_pfm (int32_t pfm_handle)
+{
+  QMutexLocker lock (&pfm_open_mutex);
+
+  close_pfm_file (pfm_handle);
+}
+
+
+
+/*  Normalizes the points in the chunk to bin units (see misp_surface) in one pass and hands it to the consumer.  The
+    only thing the projection changes is the bin size, as a reciprocal so we multiply instead of divide.  */
+
+static void publish_chunk (INGEST_DATA *ingest, POINT_RING *ring, POINT_BUFFER *chunk)
+{
+  BIN_HEADER *head = &ingest->open_args->head;
+
+  normalize_points (chunk, 0, head->mbr.min_x, head->mbr.min_y, ingest->x_scale, ingest->y_scale);
+
+  publish_point_ring (ring);
+}
+
+
+
+//  All depths, every sounding is written to the end of the buffer and the count only moves on if it is valid.
+
+static inline void add_all_depths (POINT_BUFFER *buffer, DEPTH_RECORD *depth, int32_t recnum)
+{
+  reserve_points (buffer, recnum);
+
+  int64_t n = buffer->count;
+
+  for (int32_t k = 0 ; k < recnum ; k++)
+    {
+      buffer->x[n] = depth[k].xyz.x;
+      buffer->y[n] = depth[k].xyz.y;
+      buffer->z[n] = depth[k].xyz.z;
+
+      n += !(depth[k].validity & (PFM_INVAL | PFM_DELETED | PFM_REFERENCE));
+    }
+
+  buffer->count = n;
+}
+
+
+
+//  Filtered surfaces, the first valid sounding that matches the bin's filtered depth.
+
+static inline void add_filtered (POINT_BUFFER *buffer, DEPTH_RECORD *depth, int32_t recnum, float filtered)
+{
+  for (int32_t k = 0 ; k < recnum ; k++)
+    {
+      if (!(depth[k].validity & (PFM_INVAL | PFM_DELETED | PFM_REFERENCE)) &&
+          fabs (depth[k].xyz.z - filtered) < MISP_EPS)
+        {
+          reserve_points (buffer, 1);
+
+          buffer->x[buffer->count] = depth[k].xyz.x;
+          buffer->y[buffer->count] = depth[k].xyz.y;
+          buffer->z[buffer->count] = depth[k].xyz.z;
+
+          buffer->count++;
+          break;
+        }
+    }
+}
+
+
+
+/*  The ingest kernel, compiled once for each set of surfaces (1 << 0 - minimum filtered, 1 << 1 - maximum filtered,
+    1 << 2 - all depths) so there's no switch per sounding.  Each depth array is read once and sorted into the point
+    chunks of all of the surfaces.  The points are stored as they come out of the PFM and a chunk is normalized when
+    it's full (at the end of a row).  The all depths points for each bin can be reduced (see reduce_bin) as soon as
+    they've been added.
+
+    The bins come from the RASTER_SOUNDINGS plane that build_occupancy filled, 64 at a time, so empty bins (and
+    empty rows) cost next to nothing and no bin records are read here.  */
+
+template <int32_t SURFACES>
+static int64_t ingest_rows (INGEST_DATA *ingest, int32_t pfm_handle, int32_t band, int32_t start_row, int32_t end_row)
+{
+  DEPTH_RECORD        *depth;
+  NV_I32_COORD2       coord;
+  int32_t             recnum, count;
+  int64_t             soundings = 0, removed = 0;
+  POINT_BUFFER        *buffer[3] = {NULL, NULL, NULL};
+
+
+  BIN_HEADER *head = &ingest->open_args->head;
+  OPTIONS *options = ingest->options;
+  BIN_RASTER *raster = ingest->raster;
+  OCCUPANCY *occupancy = ingest->occupancy;
+  POINT_RING *ring[3];
+
+
+  for (int32_t s = 0 ; s < 3 ; s++)
+    {
+      ring[s] = &ingest->rings[s * ingest->bands + band];
+
+      if ((SURFACES & (1 << s)) && (buffer[s] = fill_point_ring (ring[s], &ingest->status)) == NULL) return (0);
+    }
+
+
+  for (int32_t i = start_row ; i < end_row ; i++)
+    {
+      if (ingest->status.cancel) break;
+
+      if (!occupancy->soundings[i])
+        {
+          ingest->status.rows_done++;
+          continue;
+        }
+
+      coord.y = i;
+      count = 0;
+
+      uint64_t *occupied = raster_row (raster, RASTER_SOUNDINGS, i);
+
+      for (int32_t w = 0 ; w < raster->words ; w++)
+        {
+          for (uint64_t bits = occupied[w] ; bits ; bits &= bits - 1)
+            {
+              coord.x = (w << 6) + __builtin_ctzll (bits);
+
+              int32_t bin = count++;
+
+              if (read_depth_array_index (pfm_handle, coord, &depth, &recnum)) continue;
+
+              soundings += recnum;
+
+              if (SURFACES & 1) add_filtered (buffer[0], depth, recnum, occupancy->filtered[0][i][bin]);
+              if (SURFACES & 2) add_filtered (buffer[1], depth, recnum, occupancy->filtered[1][i][bin]);
+              if (SURFACES & 4)
+                {
+                  int64_t start = buffer[2]->count;
+
+                  add_all_depths (buffer[2], depth, recnum);
+
+                  removed += reduce_bin (buffer[2], start, options->reduce, options->reduce_cap, head->mbr.min_x,
+                                         head->mbr.min_y, ingest->x_scale, ingest->y_scale);
+                }
+
+              free (depth);
+            }
+        }
+
+      ingest->status.rows_done++;
+
+
+      //  Pass the chunks on once they're full.  If we're cancelled while waiting for an empty one we just stop.
+
+      for (int32_t s = 0 ; s < 3 ; s++)
+        {
+          if ((SURFACES & (1 << s)) && buffer[s]->count >= POINT_CHUNK_SIZE)
+            {
+              publish_chunk (ingest, ring[s], buffer[s]);
+
+              if ((buffer[s] = fill_point_ring (ring[s], &ingest->status)) == NULL)
+                {
+                  ingest->removed += removed;
+                  return (soundings);
+                }
+            }
+        }
+    }
+
+
+  for (int32_t s = 0 ; s < 3 ; s++)
+    {
+      if ((SURFACES & (1 << s)) && buffer[s]->count) publish_chunk (ingest, ring[s], buffer[s]);
+    }
+
+  ingest->removed += removed;
+
+
+  return (soundings);
+}
+
+
+
+//  Reads rows start_row through end_row - 1 into the band's rings using its own PFM handle.
+
+static void ingest_band (int32_t band, int32_t start_row, int32_t end_row, void *data)
+{
+  INGEST_DATA         *ingest = (INGEST_DATA *) data;
+  PFM_OPEN_ARGS       band_args;
+  int32_t             pfm_handle;
+  int64_t             soundings = 0;
+
+
+  if (start_row < end_row)
+    {
+      pfm_handle = open_band_pfm (&band_args, ingest->open_args->list_path);
+
+      if (pfm_handle < 0) pfm_error_exit (pfm_error);
+
+
+      switch (ingest->surfaces)
+        {
+        case 1:
+          soundings = ingest_rows<1> (ingest, pfm_handle, band, start_row, end_row);
+          break;
+
+        case 2:
+          soundings = ingest_rows<2> (ingest, pfm_handle, band, start_row, end_row);
+          break;
+
+        case 3:
+          soundings = ingest_rows<3> (ingest, pfm_handle, band, start_row, end_row);
+          break;
+
+        case 4:
+          soundings = ingest_rows<4> (ingest, pfm_handle, band, start_row, end_row);
+          break;
+
+        case 5:
+          soundings = ingest_rows<5> (ingest, pfm_handle, band, start_row, end_row);
+          break;
+
+        case 6:
+          soundings = ingest_rows<6> (ingest, pfm_handle, band, start_row, end_row);
+          break;
+
+        case 7:
+          soundings = ingest_rows<7> (ingest, pfm_handle, band, start_row, end_row);
+          break;
+        }
+
+
+      close_band_pfm (pfm_handle);
+
+      ingest->soundings += soundings;
+    }
+
+
+  for (int32_t s = 0 ; s < 3 ; s++) finish_point_ring (&ingest->rings[s * ingest->bands + band]);
+}
+
+
+
+/*  The consumer.  Takes the chunks from the bands strictly in band order (so the points always end up in the same
+    order no matter how the threads were scheduled), adds them to the surface's points and, if we're doing a single
+    grid, loads the ones for options->surface into MISP.  A band's chunks are freed as soon as it's done with.
+    Returns NVTrue if there was anything to do.  */
+
+static uint8_t consume_chunks (void *data)
+{
+  INGEST_DATA         *ingest = (INGEST_DATA *) data;
+  uint8_t             busy = NVFalse, done;
+
+
+  while (ingest->next_band < ingest->bands)
+    {
+      done = NVTrue;
+
+      for (int32_t s = 0 ; s < 3 ; s++)
+        {
+          if (!(ingest->surfaces & (1 << s))) continue;
+
+          POINT_RING *ring = &ingest->rings[s * ingest->bands + ingest->next_band];
+
+
+          //  Check done before looking for a chunk, the band sets it after its last publish.
+
+          bool finished = ring->done;
+
+          POINT_BUFFER *chunk;
+
+          while ((chunk = front_point_ring (ring)) != NULL)
+            {
+              append_points (&ingest->points[s], chunk);
+
+              if (ingest->load && s == ingest->options->surface) load_misp_points (chunk, NULL, chunk->count);
+
+              release_point_ring (ring);
+
+              busy = NVTrue;
+            }
+
+          if (!finished) done = NVFalse;
+        }
+
+      if (!done) break;
+
+      for (int32_t s = 0 ; s < 3 ; s++)
+        {
+          for (int32_t j = 0 ; j < POINT_RING_SLOTS ; j++)
+            free_points (&ingest->rings[s * ingest->bands + ingest->next_band].slot[j]);
+        }
+
+      ingest->next_band++;
+    }
+
+
+  return (busy);
+}
+
+
+
+/***************************************************************************\
+*                                                                           *
+*   Module Name:        ingest_pfm                                          *
+*                                                                           *
+*   Purpose:            Reads the depth records for the surface from the    *
+*                       PFM in parallel row bands.  The bin records are     *
+*                       read first (build_occupancy) to save the bin state  *
+*                       in the raster for the write back passes and to      *
+*                       find the bins that have soundings.  The rows are    *
+*                       then split into bands with about the same number    *
+*                       of soundings.  Each band has its own PFM handle     *
+*                       and passes its points on, in chunks, to the         *
+*                       calling thread (see consume_chunks).  This collects *
+*                       them in band order, so the result doesn't depend    *
+*                       on how the threads were scheduled, and, if "load"   *
+*                       is set, loads them into MISP while the bands are    *
+*                       still reading so the I/O and the MISP load overlap. *
+*                       Each depth record is read once for all of the       *
+*                       surfaces in "surfaces".                             *
+*                                                                           *
+*   Arguments:          open_args       -   open args of the PFM (the       *
+*                                           header is used for the bin      *
+*                                           geometry)                       *
+*                       options         -   run options                     *
+*                       callbacks       -   progress hooks                  *
+*                       bands           -   number of row bands             *
+*                       surfaces        -   surfaces to ingest (1 <<        *
+*                                           surface for each)               *
+*                       load            -   load the points for             *
+*                                           options->surface into MISP      *
+*                                           (start_single_solve must have   *
+*                                           been called)                    *
+*                       raster          -   zeroed bin raster (DATA,        *
+*                                           INTERPOLATED, LAND, and         *
+*                                           SOUNDINGS planes are filled)    *
+*                       warm            -   returned warm start surface     *
+*                                           from the bin records (see       *
+*                                           warm_value), NULL if not wanted *
+*                       points          -   returned normalized points for  *
+*                                           each surface (3 of them,        *
+*                                           indexed by surface, free with   *
+*                                           free_points)                    *
+*                       soundings       -   returned number of depth        *
+*                                           records read                    *
+*                                                                           *
+*   Returns:            NVTrue if the run was cancelled                     *
+*                                                                           *
+\***************************************************************************/
+
+uint8_t ingest_pfm (PFM_OPEN_ARGS *open_args, OPTIONS *options, RUN_CALLBACKS *callbacks, int32_t bands,
+                    int32_t surfaces, uint8_t load, BIN_RASTER *raster, float *warm, POINT_BUFFER *points,
+                    int64_t *soundings)
+{
+  uint8_t             cancelled;
+  int32_t             *split;
+  OCCUPANCY           occupancy;
+  INGEST_DATA         ingest;
+
+
+  memset (points, 0, 3 * sizeof (POINT_BUFFER));
+
+  *soundings = 0;
+
+
+  callbacks->phase (QCoreApplication::translate ("pfmMisp", "Finding bins with data"), open_args->head.bin_height);
+
+  cancelled = build_occupancy (open_args, surfaces, callbacks, bands, raster, warm, &occupancy);
+
+  if (cancelled)
+    {
+      free_occupancy (&occupancy);
+      return (cancelled);
+    }
+
+
+  split = (int32_t *) malloc ((bands + 1) * sizeof (int32_t));
+
+  if (split == NULL)
+    {
+      perror ("Allocating row bands");
+      exit (-1);
+    }
+
+  balance_bands (&occupancy, bands, split);
+
+
+  /*  Room for all of the points up front so they never have to be copied (all of the soundings for the all depths
+      surface, one per bin with soundings for the filtered surfaces).  With the bin reduction no bin keeps more than
+      reduce_cap points so that's the most the all depths surface can have (append_points grows it if need be).  */
+
+  int64_t total = 0, occupied_bins = 0;
+
+  for (int32_t i = 0 ; i < occupancy.height ; i++)
+    {
+      uint64_t *occupied = raster_row (raster, RASTER_SOUNDINGS, i);
+
+      for (int32_t w = 0 ; w < raster->words ; w++) occupied_bins += __builtin_popcountll (occupied[w]);
+
+      total += occupancy.soundings[i];
+    }
+
+  int64_t kept = (options->reduce != REDUCE_NONE) ? MIN (total, occupied_bins * options->reduce_cap) : total;
+
+  for (int32_t s = 0 ; s < 3 ; s++)
+    {
+      if (surfaces & (1 << s)) reserve_points (&points[s], (s == 2) ? kept : occupied_bins);
+    }
+
+
+  ingest.open_args = open_args;
+  ingest.options = options;
+  ingest.raster = raster;
+  ingest.occupancy = &occupancy;
+  ingest.rings = alloc_point_rings (3 * bands);
+  ingest.points = points;
+  ingest.surfaces = surfaces;
+  ingest.bands = bands;
+  ingest.next_band = 0;
+  ingest.load = load;
+  ingest.soundings = 0;
+  ingest.removed = 0;
+
+  if (open_args->head.proj_data.projection)
+    {
+      ingest.x_scale = ingest.y_scale = 1.0 / open_args->head.bin_size_xy;
+    }
+  else
+    {
+      ingest.x_scale = 1.0 / open_args->head.x_bin_size_degrees;
+      ingest.y_scale = 1.0 / open_args->head.y_bin_size_degrees;
+    }
+
+
+  callbacks->phase (QCoreApplication::translate ("pfmMisp", "Reading data for surface"), open_args->head.bin_height);
+
+  cancelled = run_band_split (bands, split, ingest_band, consume_chunks, &ingest, &ingest.status, callbacks);
+
+  *soundings = ingest.soundings;
+
+  if ((surfaces & 4) && options->reduce != REDUCE_NONE)
+    callbacks->message (QCoreApplication::translate ("pfmMisp", "Points removed by bin reduction : %1").arg ((qlonglong) ingest.removed));
+
+  free_point_rings (ingest.rings, 3 * bands);
+  free (split);
+  free_occupancy (&occupancy);
+
+  return (cancelled);
+}
@@ -51,11 +51,22 @@
 \***************************************************************************/
 
 #include "pfmMisp.hpp"
+#include "batch_misp.hpp"
 #include "version.hpp"
 
 
 int main (int argc, char **argv)
 {
+    //  Batch mode doesn't create any widgets so we only need a core application (no X display).
+
+    if (is_batch_run (argc, argv))
+      {
+        QCoreApplication b (argc, argv);
+
+        return (batch_misp (argc, argv));
+      }
+
+
     QApplication a (argc, argv);
 
 
@@ -0,0 +1,127 @@
+
+/*********************************************************************************************
+
+    This is public domain software that was developed by or for the U.S. Naval Oceanographic
+    Office and/or the U.S. Army Corps of Engineers.
+
+    This is a work of the U.S. Government. In accordance with 17 USC 105, copyright protection
+    is not available for any work of the U.S. Government.
+
+    Neither the United States Government, nor any employees of the United States Government,
+    nor the author, makes any warranty, express or implied, without even the implied warranty
+    of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE, or assumes any liability or
+    responsibility for the accuracy, completeness, or usefulness of any information,
+    apparatus, product, or process disclosed, or represents that its use would not infringe
+    privately-owned rights. Reference herein to any specific commercial products, process,
+    or service by trade name, trademark, manufacturer, or otherwise, does not necessarily
+    constitute or imply its endorsement, recommendation, or favoring by the United States
+    Government. The views and opinions of authors expressed herein do not necessarily state
+    or reflect those of the United States Government, and shall not be used for advertising
+    or product endorsement purposes.
+*********************************************************************************************/
+
+
+/****************************************  IMPORTANT NOTE  **********************************
+
+    Comments in this file that start with / * ! or / / ! are being used by Doxygen to
+    document the software.  Dashes in these comment blocks are used to create bullet lists.
+    The lack of blank lines after a block of dash preceeded comments means that the next
+    block of dash preceeded comments is a new, indented bullet list.  I've tried to keep the
+    Doxygen formatting to a minimum but there are some other items (like <br> and <pre>)
+    that need to be left alone.  If you see a comment that starts with / * ! or / / ! and
+    there is something that looks a bit weird it is probably due to some arcane Doxygen
+    syntax.  Be very careful modifying blocks of Doxygen comments.
+
+*****************************************  IMPORTANT NOTE  **********************************/
+
+
+
+#include "mispWorker.hpp"
+#include "misp_surface.hpp"
+
+
+//  misp_surface only takes plain function pointers so we keep track of the worker that is running.
+
+mispWorker *mispWorker::current = NULL;
+
+
+mispWorker::mispWorker (QString file, OPTIONS *op)
+{
+  pfm_file_name = file;
+  options = *op;
+  cancel_flag = false;
+  range = percent = 0;
+}
+
+
+
+//  Called from the GUI thread.  The worker checks the flag between rows.
+
+void mispWorker::cancel ()
+{
+  cancel_flag = true;
+}
+
+
+
+void mispWorker::slotRun ()
+{
+  RUN_CALLBACKS       callbacks;
+
+
+  current = this;
+
+  callbacks.phase = phaseCallback;
+  callbacks.value = valueCallback;
+  callbacks.message = messageCallback;
+  callbacks.cancelled = cancelledCallback;
+
+  int32_t status = misp_surface (pfm_file_name, &options, &callbacks);
+
+  current = NULL;
+
+  emit runFinished (status);
+}
+
+
+
+void mispWorker::phaseCallback (QString title, int32_t range)
+{
+  current->range = range;
+  current->percent = -1;
+
+  emit current->phaseStarted (title, range);
+}
+
+
+
+//  Only send progress when the percentage changes.  There's no point in flooding the GUI event loop with one event
+//  per row on a 20000 row PFM.
+
+void mispWorker::valueCallback (int32_t value)
+{
+  if (current->range <= 0) return;
+
+  int32_t pct = NINT (((double) value / (double) current->range) * 100.0);
+
+  if (pct != current->percent)
+    {
+      current->percent = pct;
+
+      emit current->progressValue (value);
+    }
+}
+
+
+
+void mispWorker::messageCallback (QString info)
+{
+  emit current->statusMessage (info);
+}
+
+
+
+uint8_t mispWorker::cancelledCallback ()
+{
+  return (current->cancel_flag ? NVTrue : NVFalse);
+}
@@ -0,0 +1,462 @@
+
+/*********************************************************************************************
+
+    This is public domain software that was developed by or for the U.S. Naval Oceanographic
+    Office and/or the U.S. Army Corps of Engineers.
+
+    This is a work of the U.S. Government. In accordance with 17 USC 105, copyright protection
+    is not available for any work of the U.S. Government.
+
+    Neither the United States Government, nor any employees of the United States Government,
+    nor the author, makes any warranty, express or implied, without even the implied warranty
+    of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE, or assumes any liability or
+    responsibility for the accuracy, completeness, or usefulness of any information,
+    apparatus, product, or process disclosed, or represents that its use would not infringe
+    privately-owned rights. Reference herein to any specific commercial products, process,
+    or service by trade name, trademark, manufacturer, or otherwise, does not necessarily
+    constitute or imply its endorsement, recommendation, or favoring by the United States
+    Government. The views and opinions of authors expressed herein do not necessarily state
+    or reflect those of the United States Government, and shall not be used for advertising
+    or product endorsement purposes.
+*********************************************************************************************/
+
+
+/****************************************  IMPORTANT NOTE  **********************************
+
+    Comments in this file that start with / * ! or / / ! are being used by Doxygen to
+    document the software.  Dashes in these comment blocks are used to create bullet lists.
+    The lack of blank lines after a block of dash preceeded comments means that the next
+    block of dash preceeded comments is a new, indented bullet list.  I've tried to keep the
+    Doxygen formatting to a minimum but there are some other items (like <br> and <pre>)
+    that need to be left alone.  If you see a comment that starts with / * ! or / / ! and
+    there is something that looks a bit weird it is probably due to some arcane Doxygen
+    syntax.  Be very careful modifying blocks of Doxygen comments.
+
+*****************************************  IMPORTANT NOTE  **********************************/
+
+
+
+#include "misp_surface.hpp"
+#include "ingest.hpp"
+#include "solve_surface.hpp"
+#include "nibble.hpp"
+#include "write_surface.hpp"
+#include "point_cache.hpp"
+#include "run_stats.hpp"
+#include "srtm_raster.hpp"
+#include "export_grid.hpp"
+#include "scratch_grid.hpp"
+#include "hole_fill.hpp"
+#include "surface_engine.hpp"
+#include "multigrid_engine.hpp"
+#include "warm_start.hpp"
+
+
+//  Frees the points, or closes the point cache if that's where they came from.
+
+static void release_points (POINT_BUFFER *points, POINT_CACHE *cache, uint8_t cached)
+{
+  if (cached)
+    {
+      close_point_cache (cache);
+    }
+  else
+    {
+      for (int32_t s = 0 ; s < 3 ; s++) free_points (&points[s]);
+    }
+}
+
+
+
+/***************************************************************************\
+*                                                                           *
+*   Module Name:        misp_surface                                        *
+*                                                                           *
+*   Purpose:            Reads the PFM, computes the MISP surface, and       *
+*                       writes it back to the Average Filtered/Edited       *
+*                       surface.  This doesn't touch any widgets so it can  *
+*                       be run from the wizard or in batch mode.  All       *
+*                       progress is reported through the callbacks.  Each   *
+*                       phase is timed and, if the run finishes, the        *
+*                       timings are written to PFM_FILE.misp_report.json    *
+*                       (see run_stats).  Any other surfaces in             *
+*                       options->export_mask are ingested in the same pass, *
+*                       solved at the same time, and written to grid files  *
+*                       in the same sweep (see export_grid).  With a        *
+*                       memory budget the whole grids can go to scratch     *
+*                       files (see scratch_grid) and the solves are tiled   *
+*                       to fit (see solve_surface).  If only the empty      *
+*                       bins are being replaced and options->hole_fill is   *
+*                       set each hole is solved on its own (see hole_fill). *
+*                       With options->warm_residual set the multigrid       *
+*                       engine starts from the surface that's already in    *
+*                       the PFM (see warm_start).                           *
+*                                                                           *
+*   Arguments:          pfm_file_name   -   PFM list or handle file         *
+*                       options         -   run options                     *
+*                       callbacks       -   progress hooks                  *
+*                                                                           *
+*   Returns:            0 on success, RUN_CANCELLED if the run was          *
+*                       cancelled (checked between rows), or                *
+*                       RUN_CHECK_FAILED if the tiled surface didn't pass   *
+*                       the comparison with the single grid                 *
+*                                                                           *
+\***************************************************************************/
+
+int32_t misp_surface (QString pfm_file_name, OPTIONS *options, RUN_CALLBACKS *callbacks)
+{
+  int32_t             pfm_handle, bands, grid_rows, status, surfaces, export_count, solves;
+  float               *grid, *warm = NULL;
+  SCRATCH_GRID        grid_scratch, warm_scratch;
+  NV_F64_XYMBR        mbr;
+  POINT_BUFFER        points[3], *primary;
+  EXPORT_GRID         exports[3];
+  PFM_OPEN_ARGS       open_args;
+  BIN_RASTER          raster;
+  POINT_CACHE         cache;
+  OPTIONS             solve_options;
+  HOLE_SET            holes;
+  RUN_STATS           stats;
+  PHASE_STATS         *phase;
+  int64_t             bins;
+  uint8_t             land_mask_flag = NVFalse, cancelled, cached = NVFalse, loaded = NVFalse, hole_mode, warm_start;
+
+
+  init_run_stats (&stats);
+
+  phase = start_phase_stats (&stats, "open");
+
+
+  strcpy (open_args.list_path, pfm_file_name.toLatin1 ());
+
+  open_args.checkpoint = 0;
+  pfm_handle = open_existing_pfm_file (&open_args);
+
+  if (pfm_handle < 0) pfm_error_exit (pfm_error);
+
+
+  //  Check for the land mask flag in PFM_USER_10 in any of the PFM layers.
+
+  land_mask_flag = NVFalse;
+  if (!strcmp (open_args.head.user_flag_name[9], "Land masked point")) land_mask_flag = NVTrue;
+
+
+  /*  We're going to let MISP handle everything in zero based units of the bin size.  That is, we subtract off the
+      west lon from longitudes then divide by the grid size in the X direction.  We do the same with the latitude using
+      the south latitude.  This will give us values that range from 0.0 to gridcols in longitude and 0.0 to gridrows
+      in latitude.  The assumption here is that the bins are essentially squares (spatially).  */
+
+  mbr.min_x = 0.0;
+  mbr.min_y = 0.0;
+  if (open_args.head.proj_data.projection)
+    {
+      mbr.max_x = (double) NINT ((open_args.head.mbr.max_x - open_args.head.mbr.min_x) / open_args.head.bin_size_xy);
+      mbr.max_y = (double) NINT ((open_args.head.mbr.max_y - open_args.head.mbr.min_y) / open_args.head.bin_size_xy);
+    }
+  else
+    {
+      mbr.max_x = (double) NINT ((open_args.head.mbr.max_x - open_args.head.mbr.min_x) /
+                                     open_args.head.x_bin_size_degrees);
+      mbr.max_y = (double) NINT ((open_args.head.mbr.max_y - open_args.head.mbr.min_y) /
+                                     open_args.head.y_bin_size_degrees);
+    }
+
+
+  bins = (int64_t) open_args.head.bin_width * open_args.head.bin_height;
+
+  alloc_bin_raster (&raster, open_args.head.bin_width, open_args.head.bin_height);
+
+
+  //  The PFM surface plus any others that are being exported.  They all come out of the same ingest pass.
+
+  surfaces = (1 << options->surface) | options->export_mask;
+
+
+  /*  The surface grid, the tile weights, and the export grids (other than the PFM surface's) are whole grids.  If
+      they won't fit in the memory budget they go in scratch files next to the PFM.  The surfaces are solved at the
+      same time so they split the MISP part of the budget.  */
+
+  solves = 1;
+  for (int32_t s = 0 ; s < 3 ; s++) if (s != options->surface && (options->export_mask & (1 << s))) solves++;
+
+  warm_start = (options->warm_residual > 0.0 && options->engine == ENGINE_MULTIGRID);
+
+  if (options->warm_residual > 0.0 && !warm_start)
+    callbacks->message (QCoreApplication::translate ("pfmMisp", "Warm start only applies to the multigrid engine, solving from scratch"));
+
+  if (options->tile_size > 0 && !surface_engines[options->engine].global_state)
+    callbacks->message (QCoreApplication::translate ("pfmMisp", "Tiling only applies to the MISP engine, %1 solves the whole grid "
+                                                     "in the row band threads")
+                        .arg (QCoreApplication::translate ("pfmMisp", surface_engines[options->engine].title)));
+
+  if (plan_scratch_grids (&open_args, options, solves + 1 + warm_start))
+    callbacks->message (QCoreApplication::translate ("pfmMisp", "Out of core, grids are in %1.misp_scratch files").arg (pfm_file_name));
+
+  solve_options = *options;
+  if (options->memory_budget) solve_options.memory_budget = MAX (options->memory_budget / solves, 1);
+
+  export_count = alloc_export_grids (&open_args, options, exports);
+
+
+  //  Only the empty bins get a surface value if we're not replacing all bins so we might not need the whole surface.
+
+  hole_mode = (options->hole_fill && !options->replace_all && surfaces == (1 << options->surface));
+
+  if (options->hole_fill && !options->replace_all && !hole_mode)
+    callbacks->message (QCoreApplication::translate ("pfmMisp", "The export grids need the whole surface, not filling holes on their own"));
+
+  memset (points, 0, sizeof (points));
+
+  primary = &points[options->surface];
+
+
+  /*  For a warm start the multigrid engine starts from the surface that's already in the PFM (the last run's surface
+      plus whatever has been edited since) and only relaxes until the residual is under options->warm_residual.  It's
+      read with the bin records in the ingest or, if the points come from the cache, on its own below.  */
+
+  if (warm_start) warm = (float *) alloc_scratch_grid (&warm_scratch, bins * sizeof (float), NVFalse);
+
+
+  /*  If nothing has changed since the last run we can skip reading the PFM altogether.  The cache only has the PFM
+      surface's points so we can't use it if we're exporting any other surfaces.  */
+
+  phase = start_phase_stats (&stats, "ingest");
+
+  cache.file = NULL;
+  if (options->point_cache && surfaces == (1 << options->surface))
+    cached = load_point_cache (&open_args, options, &cache, primary, &raster);
+
+  if (cached)
+    {
+      strcpy (phase->name, "cache");
+
+      callbacks->message (QCoreApplication::translate ("pfmMisp", "Points loaded from cache : %1").arg ((qlonglong) primary->count));
+    }
+  else
+    {
+      bands = band_count (open_args.head.bin_height);
+
+
+      //  For a single MISP grid the points go into MISP as they're read (see ingest_pfm).
+
+      loaded = (!hole_mode && options->engine == ENGINE_MISP &&
+                single_grid (open_args.head.bin_width, open_args.head.bin_height, &solve_options));
+
+      if (loaded) start_single_solve (mbr, &solve_options, callbacks);
+
+      cancelled = ingest_pfm (&open_args, options, callbacks, bands, surfaces, loaded, &raster, warm, points,
+                              &phase->soundings_read);
+
+      phase->bins_visited = bins;
+
+
+      //  Nothing has been written to the PFM yet so a cancel here leaves it untouched.
+
+      if (cancelled)
+        {
+          for (int32_t s = 0 ; s < 3 ; s++) free_points (&points[s]);
+          if (warm) free_scratch_grid (&warm_scratch);
+          close_export_grids (exports, export_count, NVTrue, callbacks);
+          free_bin_raster (&raster);
+          close_pfm_file (pfm_handle);
+          return (RUN_CANCELLED);
+        }
+
+      if (options->point_cache) save_point_cache (&open_args, options, primary, &raster);
+
+      callbacks->message (QCoreApplication::translate ("pfmMisp", "Points loaded : %1").arg ((qlonglong) primary->count));
+    }
+
+
+  phase->points = primary->count;
+
+
+  /*  Work out which bins are within the nibbling distance of a bin with valid data.  This and the SRTM land mask don't
+      depend on the surface but they're needed to find the holes (see label_holes).  Nothing has been written yet so a
+      cancel here still leaves the PFM untouched.  */
+
+  if (options->clear_int && options->nibble)
+    {
+      phase = start_phase_stats (&stats, "nibble");
+
+      if (nibble_mask (&raster, options->nibble, callbacks))
+        {
+          release_points (points, &cache, cached);
+          if (warm) free_scratch_grid (&warm_scratch);
+          close_export_grids (exports, export_count, NVTrue, callbacks);
+          free_bin_raster (&raster);
+          close_pfm_file (pfm_handle);
+          return (RUN_CANCELLED);
+        }
+
+      phase->bins_visited = bins;
+    }
+
+
+  //  The SRTM land mask at the bin centers (from the cache next to the PFM if we've done this area before).
+
+  if (options->clear_land)
+    {
+      phase = start_phase_stats (&stats, "srtm");
+
+      if (load_srtm_raster (&open_args, &raster, callbacks))
+        {
+          release_points (points, &cache, cached);
+          if (warm) free_scratch_grid (&warm_scratch);
+          close_export_grids (exports, export_count, NVTrue, callbacks);
+          free_bin_raster (&raster);
+          close_pfm_file (pfm_handle);
+          return (RUN_CANCELLED);
+        }
+    }
+
+
+  if (warm && cached)
+    {
+      phase = start_phase_stats (&stats, "warm");
+
+      if (read_warm_surface (&open_args, callbacks, warm))
+        {
+          free_scratch_grid (&warm_scratch);
+          release_points (points, &cache, cached);
+          close_export_grids (exports, export_count, NVTrue, callbacks);
+          free_bin_raster (&raster);
+          close_pfm_file (pfm_handle);
+          return (RUN_CANCELLED);
+        }
+
+      phase->bins_visited = bins;
+    }
+
+  if (warm) set_multigrid_start (warm, open_args.head.bin_width, open_args.head.bin_height);
+
+
+  if (hole_mode)
+    {
+      phase = start_phase_stats (&stats, "holes");
+
+      hole_mode = label_holes (&open_args.head, &raster, options, callbacks, &holes);
+
+      phase->bins_visited = bins;
+    }
+
+
+  phase = start_phase_stats (&stats, "solve");
+
+  phase->points = primary->count;
+
+  int64_t capped = multigrid_capped ();
+
+  //  The hole processes write straight into the grid so it has to be shared with them.
+
+  grid = (float *) alloc_scratch_grid (&grid_scratch, (int64_t) open_args.head.bin_width * open_args.head.bin_height *
+                                       sizeof (float), hole_mode);
+
+  if (hole_mode)
+    {
+      status = fill_holes (primary, &holes, open_args.head.bin_width, open_args.head.bin_height, options, callbacks,
+                           grid);
+
+      grid_rows = open_args.head.bin_height;
+
+      free_holes (&holes);
+
+      set_multigrid_start (NULL, 0, 0);
+    }
+  else
+    {
+      //  The export surfaces (on Linux) are solved in their own processes while we solve the PFM surface.
+
+      start_export_solves (points, mbr, open_args.head.bin_width, open_args.head.bin_height, &solve_options, exports,
+                           export_count);
+
+      status = solve_surface (primary, loaded, mbr, open_args.head.bin_width, open_args.head.bin_height, &solve_options,
+                              callbacks, grid, &grid_rows);
+
+
+      //  The start surface is the PFM surface, the export surfaces are solved from scratch.
+
+      set_multigrid_start (NULL, 0, 0);
+
+      if (finish_export_solves (points, mbr, open_args.head.bin_width, open_args.head.bin_height, &solve_options,
+                                callbacks, grid, grid_rows, exports, export_count)) status = RUN_CANCELLED;
+    }
+
+  stats.capped = multigrid_capped () - capped;
+
+  release_points (points, &cache, cached);
+
+  if (warm) free_scratch_grid (&warm_scratch);
+
+  /*  A surface that failed the tile check doesn't go into the PFM either (the report still goes out so the check's
+      numbers aren't lost).  */
+
+  if (status == RUN_CANCELLED || status == RUN_CHECK_FAILED)
+    {
+      free_scratch_grid (&grid_scratch);
+      close_export_grids (exports, export_count, NVTrue, callbacks);
+      free_bin_raster (&raster);
+      close_pfm_file (pfm_handle);
+
+      if (status == RUN_CHECK_FAILED) report_run_stats (&stats, pfm_file_name, options, status, callbacks);
+
+      return (status);
+    }
+
+
+  if (options->replace_all)
+    {
+      switch (options->surface)
+        {
+        case 2:
+          strcpy (open_args.head.average_filt_name, "AVERAGE MISP SURFACE");
+          write_bin_header (pfm_handle, &open_args.head, 0);
+          break;
+
+        case 0:
+          strcpy (open_args.head.average_filt_name, "MINIMUM MISP SURFACE");
+          write_bin_header (pfm_handle, &open_args.head, 0);
+          break;
+
+        case 1:
+          strcpy (open_args.head.average_filt_name, "MAXIMUM MISP SURFACE");
+          write_bin_header (pfm_handle, &open_args.head, 0);
+          break;
+        }
+    }
+
+
+  //  Surface values, nibbling, land clearing, and the export grids all go out in one pass over the bin file.
+
+  phase = start_phase_stats (&stats, "write");
+
+  open_export_grids (&open_args, exports, export_count);
+
+  cancelled = write_surface (pfm_handle, &open_args, options, callbacks, grid, grid_rows, &raster, land_mask_flag,
+                             exports, export_count, &phase->bins_written);
+
+  phase->bins_visited = bins;
+
+
+  phase = start_phase_stats (&stats, "close");
+
+  close_export_grids (exports, export_count, cancelled, callbacks);
+
+  free_scratch_grid (&grid_scratch);
+  close_pfm_file (pfm_handle);
+
+
+  //  The bin file has changed so bring the cache up to date (after closing the PFM so the time stamp is final).
+
+  if (!cancelled && options->point_cache) update_point_cache (&open_args, &raster);
+
+  free_bin_raster (&raster);
+
+
+  if (cancelled) return (RUN_CANCELLED);
+
+
+  report_run_stats (&stats, pfm_file_name, options, status, callbacks);
+
+  return (status);
+}
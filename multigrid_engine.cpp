@@ -0,0 +1,1075 @@
+
+/*********************************************************************************************
+
+    This is public domain software that was developed by or for the U.S. Naval Oceanographic
+    Office and/or the U.S. Army Corps of Engineers.
+
+    This is a work of the U.S. Government. In accordance with 17 USC 105, copyright protection
+    is not available for any work of the U.S. Government.
+
+    Neither the United States Government, nor any employees of the United States Government,
+    nor the author, makes any warranty, express or implied, without even the implied warranty
+    of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE, or assumes any liability or
+    responsibility for the accuracy, completeness, or usefulness of any information,
+    apparatus, product, or process disclosed, or represents that its use would not infringe
+    privately-owned rights. Reference herein to any specific commercial products, process,
+    or service by trade name, trademark, manufacturer, or otherwise, does not necessarily
+    constitute or imply its endorsement, recommendation, or favoring by the United States
+    Government. The views and opinions of authors expressed herein do not necessarily state
+    or reflect those of the United States Government, and shall not be used for advertising
+    or product endorsement purposes.
+*********************************************************************************************/
+
+
+/****************************************  IMPORTANT NOTE  **********************************
+
+    Comments in this file that start with / * ! or / / ! are being used by Doxygen to
+    document the software.  Dashes in these comment blocks are used to create bullet lists.
+    The lack of blank lines after a block of dash preceeded comments means that the next
+    block of dash preceeded comments is a new, indented bullet list.  I've tried to keep the
+    Doxygen formatting to a minimum but there are some other items (like <br> and <pre>)
+    that need to be left alone.  If you see a comment that starts with / * ! or / / ! and
+    there is something that looks a bit weird it is probably due to some arcane Doxygen
+    syntax.  Be very careful modifying blocks of Doxygen comments.
+
+*****************************************  IMPORTANT NOTE  **********************************/
+
+
+
+#include "multigrid_engine.hpp"
+#include "surface_engine.hpp"
+#include "scratch_grid.hpp"
+#include "run_bands.hpp"
+
+#include <cmath>
+#include <atomic>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+
+/*  Minimum curvature gridding (with tension, see Smith and Wessel, 1990) solved with multigrid.  Each bin with data
+    is held at the mean of its points and the rest of the bins relax towards
+
+        (1 - T) * del^4 (z) - T * del^2 (z) = 0
+
+    The grid is halved until it's MG_COARSEST bins on a side and the data is averaged into each level.  A coarse bin
+    is held if any of its four bins is, and from level MG_WIDE_HOLD down if any bin within one of them is (see
+    multigrid_solve).  The coarsest level is relaxed until it settles and each finer level starts from
+    the bilinear prolongation of the level below it and is improved with V-cycles (full multigrid).  A V-cycle smooths
+    the level with a few damped Jacobi sweeps, restricts the residual of the free bins to the next level down, solves
+    that for the correction the same way, adds the prolongated correction to the free bins and smooths again.  Jacobi
+    only takes out the short wavelengths, the coarse corrections take out the long ones that make plain relaxation so
+    slow on big grids (and libmisp's cost grow so quickly), so the work is close to linear in the number of bins.  The
+    full grid is cycled until no bin's residual is more than MG_TOLERANCE of the data range.  */
+
+#define         MG_COARSEST             8          /* Stop halving when either side is this small */
+#define         MG_MAX_LEVELS           16
+#define         MG_TENSION              0.25f      /* T above, 0 is pure minimum curvature */
+#define         MG_SMOOTH               3          /* Jacobi sweeps before and after each coarse grid correction */
+#define         MG_FMG_CYCLES           1          /* V-cycles on each level below the full grid */
+#define         MG_CYCLES               50         /* Most V-cycles on the full grid */
+#define         MG_COARSE_SWEEPS        4096       /* Most sweeps on the coarsest level in one cycle */
+#define         MG_COARSE_SETTLED       0.01f      /* The coarsest level has settled when a sweep moves it this much
+                                                      of what the first one did */
+#define         MG_TOLERANCE            1.0e-5f    /* Converged when no residual is more than this of the data range */
+#define         MG_THREAD_BINS          65536      /* Smallest level worth splitting into row bands */
+#define         MG_PAD                  2          /* Mirrored border so the 13 point stencil needs no edge tests */
+#define         MG_WIDE_HOLD            3          /* First level held over the whole restriction footprint */
+
+
+//  Work that one band does for all of them when they meet (see sync_bands).
+
+#define         MG_SERIAL_NONE          0
+#define         MG_SERIAL_SWAP          1          /* Pad the next grid of the level and swap it in after a sweep */
+#define         MG_SERIAL_PAD           2          /* Pad the top and bottom of the level */
+#define         MG_SERIAL_COARSE        3          /* The whole coarse grid correction for the level */
+#define         MG_SERIAL_CHECK         4          /* Decide whether there's another V-cycle */
+
+
+/*  One level of the grid.  The arrays are (width + 2 * MG_PAD) by (height + 2 * MG_PAD) with bin (j, i) at
+    (i + MG_PAD) * stride + j + MG_PAD.  Until the levels are built "relax" is the number of points in the bin, after
+    that it's 1.0 for bins that relax and 0.0 for bins held at the data so the sweep can multiply by it instead of
+    testing.  On the level being solved z is the surface, on the levels below it z is the correction and f is the
+    restricted residual it's solved for (there's no f on the full grid, it's always 0 there).  The c_ values are the
+    stencil for the bin spacing of the level (see set_stencil).  */
+
+typedef struct
+{
+  int32_t             width, height;
+  int64_t             stride;
+  float               c_center, c_near, c_diag, c_far, step;
+  float               *z, *zn, *f, *relax;
+  SCRATCH_GRID        z_scratch, zn_scratch, f_scratch, relax_scratch;
+} MG_LEVEL;
+
+
+/*  Shared state for the V-cycles on one level.  Levels top to split_levels - 1 are split into row bands that all wait
+    for each other after every step (the last one in does whatever has to be done for the whole level, see
+    sync_bands) so it's one run_band_split per level rather than one per sweep.  The levels below that are too small
+    to be worth it and are done by one band while the rest wait.  */
+
+typedef struct
+{
+  MG_LEVEL            *levels;
+  int32_t             count, top, split_levels;
+  float               tolerance, residual;
+  int32_t             max_cycles, cycles;
+  int32_t             bands, waiting, generation;
+  float               value, result;
+  uint8_t             stop;
+  QMutex              lock;
+  QWaitCondition      done;
+  BAND_STATUS         status;
+} MG_ARGS;
+
+
+//  Surface to start the full grid from (see set_multigrid_start), NaN where there isn't one.
+
+static float *start_grid = NULL;
+static int32_t start_width = 0, start_height = 0;
+
+
+//  Full grid solves that stopped at MG_CYCLES before they got down to the tolerance (see multigrid_capped).
+
+static std::atomic<int64_t> capped_solves (0);
+
+
+static void v_cycle (MG_ARGS *args, int32_t l, int32_t band, int32_t bands);
+
+
+
+static inline float *level_bin (MG_LEVEL *level, float *grid, int32_t i, int32_t j)
+{
+  return (&grid[(int64_t) (i + MG_PAD) * level->stride + j + MG_PAD]);
+}
+
+
+
+//  Rows of "level" that band "band" of "bands" works on.
+
+static inline void band_rows (MG_LEVEL *level, int32_t band, int32_t bands, int32_t *start_row, int32_t *end_row)
+{
+  *start_row = (int32_t) (((int64_t) level->height * band) / bands);
+  *end_row = (int32_t) (((int64_t) level->height * (band + 1)) / bands);
+}
+
+
+
+/*  Mirrors the ends of row i of "grid" into the padding about the outside edge of the end bins (the end bin is
+    repeated) which is the same line on every level.  Narrow grids are clamped instead.  */
+
+static void pad_row (MG_LEVEL *level, float *grid, int32_t i)
+{
+  float *row = level_bin (level, grid, i, 0);
+
+  for (int32_t k = 1 ; k <= MG_PAD ; k++)
+    {
+      row[-k] = row[MIN (k - 1, level->width - 1)];
+      row[level->width - 1 + k] = row[MAX (level->width - k, 0)];
+    }
+}
+
+
+
+//  Mirrors the top and bottom rows (padding included) of "grid" into the padding the same way.
+
+static void pad_ends (MG_LEVEL *level, float *grid)
+{
+  for (int32_t k = 1 ; k <= MG_PAD ; k++)
+    {
+      memcpy (level_bin (level, grid, -k, -MG_PAD), level_bin (level, grid, MIN (k - 1, level->height - 1), -MG_PAD),
+              level->stride * sizeof (float));
+      memcpy (level_bin (level, grid, level->height - 1 + k, -MG_PAD),
+              level_bin (level, grid, MAX (level->height - k, 0), -MG_PAD), level->stride * sizeof (float));
+    }
+}
+
+
+
+/*  The stencil for level l is the 13 point del^4 plus the 5 point del^2 with the spacing of the level (2^l bins),
+    scaled so the del^4 term doesn't change with the level (so the residual restricted to the next level down has to
+    be multiplied by 16).  In Fourier terms the stencil is b * s^2 + t * s with s = 4 sin^2 (kx / 2) + 4 sin^2 (ky / 2)
+    which, for the wavelengths the level below can't see, goes from s = 2 to s = 8.  The Jacobi step that damps those
+    best is the one that shrinks both ends by the same amount, about 0.87 a sweep for the full grid (any more than
+    2.5 times that step and the highest wavelengths grow instead).  */
+
+static void set_stencil (MG_LEVEL *level, int32_t l)
+{
+  float spacing = (float) (1 << l);
+  float biharmonic = 1.0f - MG_TENSION;
+  float laplacian = MG_TENSION * spacing * spacing;
+
+  level->c_center = 20.0f * biharmonic + 4.0f * laplacian;
+  level->c_near = -8.0f * biharmonic - laplacian;
+  level->c_diag = 2.0f * biharmonic;
+  level->c_far = biharmonic;
+
+  float low = 4.0f * biharmonic + 2.0f * laplacian, high = 64.0f * biharmonic + 8.0f * laplacian;
+
+  level->step = 2.0f / (low + high);
+}
+
+
+
+//  The stencil at p.
+
+static inline float apply_stencil (MG_LEVEL *level, const float *p)
+{
+  int64_t s = level->stride;
+
+  return (level->c_center * p[0] + level->c_near * (p[-1] + p[1] + p[-s] + p[s]) +
+          level->c_diag * (p[-s - 1] + p[-s + 1] + p[s - 1] + p[s + 1]) +
+          level->c_far * (p[-2] + p[2] + p[-2 * s] + p[2 * s]));
+}
+
+
+
+#ifdef __SSE2__
+
+//  The stencil at the four bins starting at p, "c" is the center, near, diagonal, and far coefficients.
+
+static inline __m128 apply_stencil_ps (const float *p, int64_t s, const __m128 *c)
+{
+  __m128 near = _mm_add_ps (_mm_add_ps (_mm_loadu_ps (p - 1), _mm_loadu_ps (p + 1)),
+                            _mm_add_ps (_mm_loadu_ps (p - s), _mm_loadu_ps (p + s)));
+  __m128 diag = _mm_add_ps (_mm_add_ps (_mm_loadu_ps (p - s - 1), _mm_loadu_ps (p - s + 1)),
+                            _mm_add_ps (_mm_loadu_ps (p + s - 1), _mm_loadu_ps (p + s + 1)));
+  __m128 far = _mm_add_ps (_mm_add_ps (_mm_loadu_ps (p - 2), _mm_loadu_ps (p + 2)),
+                           _mm_add_ps (_mm_loadu_ps (p - 2 * s), _mm_loadu_ps (p + 2 * s)));
+
+  return (_mm_add_ps (_mm_add_ps (_mm_mul_ps (c[0], _mm_loadu_ps (p)), _mm_mul_ps (c[1], near)),
+                      _mm_add_ps (_mm_mul_ps (c[2], diag), _mm_mul_ps (c[3], far))));
+}
+
+#endif
+
+
+
+/*  One damped Jacobi step for a row of bins, z is the first bin of the row in the current grid, zn the same bin in
+    the next one, and f the right hand side (NULL for 0).  Four bins at a time with SSE2 when we have it.  Returns the
+    biggest change.  */
+
+static float relax_row (MG_LEVEL *level, const float *z, float *zn, const float *f, const float *relax, int32_t width)
+{
+  float change = 0.0;
+  int32_t j = 0;
+
+
+#ifdef __SSE2__
+  __m128 c[4] = {_mm_set1_ps (level->c_center), _mm_set1_ps (level->c_near), _mm_set1_ps (level->c_diag),
+                 _mm_set1_ps (level->c_far)};
+  __m128 v_step = _mm_set1_ps (level->step), v_sign = _mm_set1_ps (-0.0f), v_change = _mm_setzero_ps ();
+
+  for ( ; j + 4 <= width ; j += 4)
+    {
+      __m128 lz = apply_stencil_ps (z + j, level->stride, c);
+
+      if (f) lz = _mm_sub_ps (lz, _mm_loadu_ps (f + j));
+
+      __m128 delta = _mm_mul_ps (_mm_mul_ps (v_step, _mm_loadu_ps (relax + j)), lz);
+
+      _mm_storeu_ps (zn + j, _mm_sub_ps (_mm_loadu_ps (z + j), delta));
+      v_change = _mm_max_ps (v_change, _mm_andnot_ps (v_sign, delta));
+    }
+
+  float lanes[4];
+  _mm_storeu_ps (lanes, v_change);
+  change = MAX (MAX (lanes[0], lanes[1]), MAX (lanes[2], lanes[3]));
+#endif
+
+  for ( ; j < width ; j++)
+    {
+      float lz = apply_stencil (level, z + j) - (f ? f[j] : 0.0f);
+      float delta = level->step * relax[j] * lz;
+
+      zn[j] = z[j] - delta;
+      change = MAX (change, fabsf (delta));
+    }
+
+  return (change);
+}
+
+
+
+//  Puts the residual (f - stencil) of the free bins of a row in r, 0 for held bins.  Returns the biggest one.
+
+static float residual_row (MG_LEVEL *level, const float *z, float *r, const float *f, const float *relax, int32_t width)
+{
+  float biggest = 0.0;
+  int32_t j = 0;
+
+
+#ifdef __SSE2__
+  __m128 c[4] = {_mm_set1_ps (level->c_center), _mm_set1_ps (level->c_near), _mm_set1_ps (level->c_diag),
+                 _mm_set1_ps (level->c_far)};
+  __m128 v_sign = _mm_set1_ps (-0.0f), v_biggest = _mm_setzero_ps ();
+
+  for ( ; j + 4 <= width ; j += 4)
+    {
+      __m128 res = _mm_sub_ps (f ? _mm_loadu_ps (f + j) : _mm_setzero_ps (), apply_stencil_ps (z + j, level->stride, c));
+
+      res = _mm_mul_ps (_mm_loadu_ps (relax + j), res);
+
+      _mm_storeu_ps (r + j, res);
+      v_biggest = _mm_max_ps (v_biggest, _mm_andnot_ps (v_sign, res));
+    }
+
+  float lanes[4];
+  _mm_storeu_ps (lanes, v_biggest);
+  biggest = MAX (MAX (lanes[0], lanes[1]), MAX (lanes[2], lanes[3]));
+#endif
+
+  for ( ; j < width ; j++)
+    {
+      r[j] = relax[j] * ((f ? f[j] : 0.0f) - apply_stencil (level, z + j));
+      biggest = MAX (biggest, fabsf (r[j]));
+    }
+
+  return (biggest);
+}
+
+
+
+//  Weight of fine bin fi in coarse bin c for the bilinear prolongation along one side (see prolongate).
+
+static inline float transfer_weight (int32_t fi, int32_t c, int32_t coarse_size)
+{
+  int32_t ci = fi / 2;
+  int32_t ni = MIN (MAX ((fi & 1) ? ci + 1 : ci - 1, 0), coarse_size - 1);
+
+  return (((ci == c) ? 0.75f : 0.0f) + ((ni == c) ? 0.25f : 0.0f));
+}
+
+
+
+/*  Restricts the residual of level l (in its zn grid) to rows start_row to end_row - 1 of level l + 1 and zeroes the
+    correction there.  The restriction is the transpose of the bilinear prolongation (full weighting over the 4 by 4
+    fine bins around the coarse one) over 4 and then times 16 for the stencil scaling.  Plain 2 by 2 averaging is
+    too rough a transfer for a fourth order stencil, the cycles hardly converge with it.  Held coarse bins get no
+    residual, they stay at 0 so the correction can't move the data.  */
+
+static void restrict_rows (MG_LEVEL *levels, int32_t l, int32_t start_row, int32_t end_row)
+{
+  MG_LEVEL *fine = &levels[l], *coarse = &levels[l + 1];
+
+
+  for (int32_t i = start_row ; i < end_row ; i++)
+    {
+      float *z = level_bin (coarse, coarse->z, i, 0);
+      float *f = level_bin (coarse, coarse->f, i, 0);
+      float *relax = level_bin (coarse, coarse->relax, i, 0);
+
+      for (int32_t j = 0 ; j < coarse->width ; j++)
+        {
+          float sum = 0.0;
+
+          z[j] = f[j] = 0.0;
+
+          if (relax[j] == 0.0) continue;
+
+          for (int32_t fi = MAX (2 * i - 1, 0) ; fi < MIN (2 * i + 3, fine->height) ; fi++)
+            {
+              float weight = transfer_weight (fi, i, coarse->height);
+
+              for (int32_t fj = MAX (2 * j - 1, 0) ; fj < MIN (2 * j + 3, fine->width) ; fj++)
+                sum += weight * transfer_weight (fj, j, coarse->width) * *level_bin (fine, fine->zn, fi, fj);
+            }
+
+          f[j] = 4.0f * sum;
+        }
+
+      pad_row (coarse, coarse->z, i);
+    }
+}
+
+
+
+/*  Bilinear interpolation of level l + 1 (bin centers of a level are at 1/4 and 3/4 of the bins of the next level
+    up, the edges are clamped) into the free bins of rows start_row to end_row - 1 of level l.  With "add" it's a
+    correction that goes on top of what's there, otherwise it's where the level starts from.  */
+
+static void prolongate (MG_LEVEL *levels, int32_t l, int32_t start_row, int32_t end_row, uint8_t add)
+{
+  MG_LEVEL *fine = &levels[l], *coarse = &levels[l + 1];
+
+
+  for (int32_t i = start_row ; i < end_row ; i++)
+    {
+      int32_t ci = i / 2;
+      int32_t ni = MIN (MAX ((i & 1) ? ci + 1 : ci - 1, 0), coarse->height - 1);
+
+      float *z = level_bin (fine, fine->z, i, 0);
+      float *relax = level_bin (fine, fine->relax, i, 0);
+      float *row = level_bin (coarse, coarse->z, ci, 0);
+      float *next = level_bin (coarse, coarse->z, ni, 0);
+
+      for (int32_t j = 0 ; j < fine->width ; j++)
+        {
+          if (relax[j] == 0.0) continue;
+
+          int32_t cj = j / 2;
+          int32_t nj = MIN (MAX ((j & 1) ? cj + 1 : cj - 1, 0), coarse->width - 1);
+
+          float value = 0.5625f * row[cj] + 0.1875f * (row[nj] + next[cj]) + 0.0625f * next[nj];
+
+          z[j] = add ? z[j] + value : value;
+        }
+
+      pad_row (fine, fine->z, i);
+    }
+}
+
+
+
+//  The MG_SERIAL_ work for level l, "value" is the biggest value the bands brought with them.
+
+static void run_serial (MG_ARGS *args, int32_t l, int32_t serial, float value)
+{
+  MG_LEVEL *level = &args->levels[l];
+
+
+  switch (serial)
+    {
+    case MG_SERIAL_SWAP:
+      {
+        pad_ends (level, level->zn);
+
+        float *swap = level->z;
+        level->z = level->zn;
+        level->zn = swap;
+      }
+      break;
+
+    case MG_SERIAL_PAD:
+      pad_ends (level, level->z);
+      break;
+
+    case MG_SERIAL_COARSE:
+      restrict_rows (args->levels, l, 0, args->levels[l + 1].height);
+      pad_ends (&args->levels[l + 1], args->levels[l + 1].z);
+      v_cycle (args, l + 1, 0, 1);
+      break;
+
+    case MG_SERIAL_CHECK:
+      args->residual = value / level->c_center;
+      args->stop = (args->residual <= args->tolerance || args->cycles >= args->max_cycles || args->status.cancel);
+      if (!args->stop) args->cycles++;
+      break;
+    }
+}
+
+
+
+/*  Waits for all of the bands to get here.  The last one in does the "serial" work for level l and wakes the rest.
+    Returns the biggest "value" any of the bands brought.  With one band (or inside the serial work, where the
+    levels are small enough for one band) there's nothing to wait for.  */
+
+static float sync_bands (MG_ARGS *args, int32_t bands, int32_t l, int32_t serial, float value)
+{
+  if (bands == 1)
+    {
+      run_serial (args, l, serial, value);
+      return (value);
+    }
+
+
+  args->lock.lock ();
+
+  args->value = MAX (args->value, value);
+
+  if (++args->waiting == bands)
+    {
+      run_serial (args, l, serial, args->value);
+
+      args->result = args->value;
+      args->value = 0.0;
+
+      args->waiting = 0;
+      args->generation++;
+      args->done.wakeAll ();
+    }
+  else
+    {
+      int32_t generation = args->generation;
+
+      while (generation == args->generation) args->done.wait (&args->lock);
+    }
+
+  value = args->result;
+
+  args->lock.unlock ();
+
+  return (value);
+}
+
+
+
+//  One Jacobi sweep over this band's rows of level l.  Returns the biggest change in any band.
+
+static float smooth (MG_ARGS *args, int32_t l, int32_t band, int32_t bands)
+{
+  MG_LEVEL *level = &args->levels[l];
+  int32_t start_row, end_row;
+  float change = 0.0;
+
+
+  band_rows (level, band, bands, &start_row, &end_row);
+
+  for (int32_t i = start_row ; i < end_row ; i++)
+    {
+      change = MAX (change, relax_row (level, level_bin (level, level->z, i, 0), level_bin (level, level->zn, i, 0),
+                                       level->f ? level_bin (level, level->f, i, 0) : NULL,
+                                       level_bin (level, level->relax, i, 0), level->width));
+
+      pad_row (level, level->zn, i);
+
+      if (l == args->top) args->status.rows_done++;
+    }
+
+  return (sync_bands (args, bands, l, MG_SERIAL_SWAP, change));
+}
+
+
+
+/*  One V-cycle on level l (this band's rows of it).  The coarsest level is just relaxed until it settles.  The
+    residual goes in zn, which is free until the next sweep.  */
+
+static void v_cycle (MG_ARGS *args, int32_t l, int32_t band, int32_t bands)
+{
+  MG_LEVEL *level = &args->levels[l];
+  int32_t start_row, end_row;
+
+
+  if (l == args->count - 1)
+    {
+      float first = smooth (args, l, band, bands), change = first;
+
+      for (int32_t sweep = 1 ; sweep < MG_COARSE_SWEEPS && change > MG_COARSE_SETTLED * first ; sweep++)
+        change = smooth (args, l, band, bands);
+
+      return;
+    }
+
+
+  for (int32_t sweep = 0 ; sweep < MG_SMOOTH ; sweep++) smooth (args, l, band, bands);
+
+  band_rows (level, band, bands, &start_row, &end_row);
+
+  for (int32_t i = start_row ; i < end_row ; i++)
+    residual_row (level, level_bin (level, level->z, i, 0), level_bin (level, level->zn, i, 0),
+                  level->f ? level_bin (level, level->f, i, 0) : NULL, level_bin (level, level->relax, i, 0),
+                  level->width);
+
+
+  //  The coarse bins take their residual from the rows of the bands on either side so everybody has to be done.
+
+  if (bands > 1 && l + 1 < args->split_levels)
+    {
+      int32_t coarse_start, coarse_end;
+
+      sync_bands (args, bands, l, MG_SERIAL_NONE, 0.0);
+
+      band_rows (&args->levels[l + 1], band, bands, &coarse_start, &coarse_end);
+
+      restrict_rows (args->levels, l, coarse_start, coarse_end);
+
+      sync_bands (args, bands, l + 1, MG_SERIAL_PAD, 0.0);
+
+      v_cycle (args, l + 1, band, bands);
+    }
+  else
+    {
+      sync_bands (args, bands, l, MG_SERIAL_COARSE, 0.0);
+    }
+
+
+  prolongate (args->levels, l, start_row, end_row, NVTrue);
+
+  sync_bands (args, bands, l, MG_SERIAL_PAD, 0.0);
+
+  for (int32_t sweep = 0 ; sweep < MG_SMOOTH ; sweep++) smooth (args, l, band, bands);
+}
+
+
+
+//  V-cycles on the top level until the biggest residual is under the tolerance (or we run out of cycles).
+
+static void cycle_rows (int32_t band, int32_t start_row, int32_t end_row, void *data)
+{
+  MG_ARGS *args = (MG_ARGS *) data;
+  MG_LEVEL *level = &args->levels[args->top];
+
+
+  while (NVTrue)
+    {
+      float residual = 0.0;
+
+      for (int32_t i = start_row ; i < end_row ; i++)
+        residual = MAX (residual, residual_row (level, level_bin (level, level->z, i, 0),
+                                                level_bin (level, level->zn, i, 0),
+                                                level->f ? level_bin (level, level->f, i, 0) : NULL,
+                                                level_bin (level, level->relax, i, 0), level->width));
+
+      sync_bands (args, args->bands, args->top, MG_SERIAL_CHECK, residual);
+
+      if (args->stop) break;
+
+      v_cycle (args, args->top, band, args->bands);
+    }
+}
+
+
+
+/*  Runs V-cycles on level l until no free bin's residual, divided by the center of the stencil (how far the bin is
+    from where its neighbors say it should be), is more than "tolerance" or it has done max_cycles of them.  The
+    number done is returned in "cycles" and the biggest residual in "residual".  Big levels are split into row bands
+    if we have callbacks.  Returns NVTrue if cancelled.  */
+
+static uint8_t solve_level (MG_LEVEL *levels, int32_t l, int32_t count, float tolerance, int32_t max_cycles,
+                            RUN_CALLBACKS *callbacks, int32_t *cycles, float *residual)
+{
+  MG_LEVEL *level = &levels[l];
+  MG_ARGS *args = new MG_ARGS;
+  uint8_t cancelled = NVFalse;
+
+
+  args->levels = levels;
+  args->count = count;
+  args->top = l;
+  args->tolerance = tolerance;
+  args->residual = 0.0;
+  args->max_cycles = max_cycles;
+  args->cycles = 0;
+  args->waiting = 0;
+  args->generation = 0;
+  args->value = 0.0;
+  args->result = 0.0;
+  args->stop = NVFalse;
+
+  args->split_levels = l;
+
+  while (callbacks && args->split_levels < count &&
+         (int64_t) levels[args->split_levels].width * levels[args->split_levels].height >= MG_THREAD_BINS)
+    args->split_levels++;
+
+  for (int32_t i = 0 ; i < level->height ; i++) pad_row (level, level->z, i);
+  pad_ends (level, level->z);
+
+
+  if (args->split_levels > l)
+    {
+      args->bands = MIN (QThread::idealThreadCount (), level->height);
+
+      int32_t *split = (int32_t *) malloc ((args->bands + 1) * sizeof (int32_t));
+
+      if (split == NULL)
+        {
+          perror ("Allocating multigrid bands");
+          exit (-1);
+        }
+
+      for (int32_t band = 0 ; band <= args->bands ; band++)
+        split[band] = (int32_t) (((int64_t) level->height * band) / args->bands);
+
+
+      //  Every band has to be running at once for the barriers, run_band_split uses one thread per band.
+
+      callbacks->phase (QCoreApplication::translate ("pfmMisp", "Relaxing multigrid level %1 of %2").arg (count - l).
+                        arg (count), level->height * 2 * MG_SMOOTH * max_cycles);
+
+      cancelled = run_band_split (args->bands, split, cycle_rows, NULL, args, &args->status, callbacks);
+
+      free (split);
+    }
+  else
+    {
+      args->bands = 1;
+      args->status.rows_done = 0;
+      args->status.cancel = false;
+
+      cycle_rows (0, 0, level->height, args);
+    }
+
+  *cycles = args->cycles;
+  *residual = args->residual;
+
+  delete args;
+
+
+  return (cancelled);
+}
+
+
+
+/*  Sets "out" to NaN for bins that are more than "reach" bins (in x or y) from a bin with data.  Uses the level's zn
+    grid (free by now) for the row pass and a running count per column for the column pass.  */
+
+static void clip_reach (MG_LEVEL *level, int32_t reach, float *out)
+{
+  int32_t *column;
+
+
+  if ((column = (int32_t *) calloc (level->width, sizeof (int32_t))) == NULL)
+    {
+      perror ("Allocating multigrid reach");
+      exit (-1);
+    }
+
+
+  //  Row pass, zn gets the number of data bins within reach along the row.
+
+  for (int32_t i = 0 ; i < level->height ; i++)
+    {
+      float *relax = level_bin (level, level->relax, i, 0);
+      float *near = level_bin (level, level->zn, i, 0);
+      int32_t in = 0;
+
+      for (int32_t j = 0 ; j < MIN (reach, level->width) ; j++) in += (relax[j] == 0.0);
+
+      for (int32_t j = 0 ; j < level->width ; j++)
+        {
+          if (j + reach < level->width) in += (relax[j + reach] == 0.0);
+          if (j - reach - 1 >= 0) in -= (relax[j - reach - 1] == 0.0);
+
+          near[j] = (float) in;
+        }
+    }
+
+
+  //  Column pass, slide a window of rows down the grid.
+
+  for (int32_t i = 0 ; i < MIN (reach, level->height) ; i++)
+    {
+      float *near = level_bin (level, level->zn, i, 0);
+
+      for (int32_t j = 0 ; j < level->width ; j++) column[j] += (near[j] != 0.0);
+    }
+
+  for (int32_t i = 0 ; i < level->height ; i++)
+    {
+      float *add = (i + reach < level->height) ? level_bin (level, level->zn, i + reach, 0) : NULL;
+      float *drop = (i - reach - 1 >= 0) ? level_bin (level, level->zn, i - reach - 1, 0) : NULL;
+
+      for (int32_t j = 0 ; j < level->width ; j++)
+        {
+          if (add) column[j] += (add[j] != 0.0);
+          if (drop) column[j] -= (drop[j] != 0.0);
+
+          if (!column[j]) out[(int64_t) i * level->width + j] = NAN;
+        }
+    }
+
+  free (column);
+}
+
+
+
+/*  Sets the surface (width by height, NaN for bins without a value) that the full grid starts from instead of the
+    prolongated coarse levels, or NULL to go back to solving from scratch.  misp_surface sets it to the surface that's
+    already in the PFM for a warm start (see read_warm_surface) and clears it before the export surfaces.  The grid
+    has to stay around until it's cleared.  */
+
+void set_multigrid_start (float *grid, int32_t width, int32_t height)
+{
+  start_grid = grid;
+  start_width = width;
+  start_height = height;
+}
+
+
+
+/*  Allocates a width by height level (level l of the pyramid).  The grids are as big as the surface grid so, out of
+    core, they go in scratch files.  The full grid doesn't need f.  */
+
+static void alloc_level (MG_LEVEL *level, int32_t l, int32_t width, int32_t height)
+{
+  level->width = width;
+  level->height = height;
+  level->stride = width + 2 * MG_PAD;
+
+  int64_t bytes = level->stride * (height + 2 * MG_PAD) * sizeof (float);
+
+  level->z = (float *) alloc_scratch_grid (&level->z_scratch, bytes, NVFalse);
+  level->zn = (float *) alloc_scratch_grid (&level->zn_scratch, bytes, NVFalse);
+  level->f = l ? (float *) alloc_scratch_grid (&level->f_scratch, bytes, NVFalse) : NULL;
+  level->relax = (float *) alloc_scratch_grid (&level->relax_scratch, bytes, NVFalse);
+
+  set_stencil (level, l);
+}
+
+
+
+/***************************************************************************\
+*                                                                           *
+*   Module Name:        multigrid_solve                                     *
+*                                                                           *
+*   Purpose:            Multigrid minimum curvature engine (see             *
+*                       surface_engine).  Bins the points onto the nearest  *
+*                       grid nodes and a pyramid of coarser grids, relaxes  *
+*                       the coarsest, then works back up prolongating each  *
+*                       level and improving it with V-cycles (see the       *
+*                       notes at the top of this file) until the full grid  *
+*                       converges.  The smoother is a damped Jacobi sweep   *
+*                       so every bin of a sweep is independent, it runs     *
+*                       four bins at a time with SSE2 and, for the big      *
+*                       levels, in row bands.  The surface is solved less   *
+*                       the mean of the data so the floats keep their       *
+*                       precision.  Bins further than engine_reach from     *
+*                       the data are left as NaN.                           *
+*                                                                           *
+*                       With a start surface (see set_multigrid_start) the  *
+*                       full grid starts from it instead and is cycled      *
+*                       until the biggest residual (the stencil applied to  *
+*                       the surface, not how far a sweep moves it) is       *
+*                       under options->warm_residual.  The coarse levels    *
+*                       are only solved first if there are free bins that   *
+*                       the start surface doesn't cover, otherwise they're  *
+*                       just there for the V-cycles.                        *
+*                                                                           *
+*                       A full grid that still has a residual over the      *
+*                       tolerance after MG_CYCLES V-cycles is counted (see  *
+*                       multigrid_capped) and reported in a message.        *
+*                                                                           *
+*   Arguments:          See SURFACE_ENGINE in surface_engine.hpp            *
+*                                                                           *
+*   Returns:            0 or RUN_CANCELLED                                  *
+*                                                                           *
+\***************************************************************************/
+
+int32_t multigrid_solve (POINT_BUFFER *points, int64_t *index, int64_t count, int32_t x0, int32_t y0, int32_t x1,
+                         int32_t y1, OPTIONS *options, RUN_CALLBACKS *callbacks, float *out)
+{
+  MG_LEVEL            levels[MG_MAX_LEVELS];
+  int32_t             level_count = 1, cycles = 0;
+  uint8_t             cancelled = NVFalse, warm;
+  float               min_z = 0.0, max_z = 0.0, mean_z = 0.0, residual = 0.0;
+  double              sum_z = 0.0;
+  int64_t             bins = 0, missing = 0;
+
+
+  MG_LEVEL *top = &levels[0];
+
+  alloc_level (top, 0, x1 - x0, y1 - y0);
+
+
+  /*  Mean of the points at each node of the full grid (running mean so the floats don't lose the small changes).  The
+      points go to their nearest node, same as IDW (see nearest_node).  */
+
+  for (int64_t n = 0 ; n < count ; n++)
+    {
+      int64_t p = index ? index[n] : n;
+
+      int32_t cx = nearest_node (points->x[p], x0, top->width);
+      int32_t cy = nearest_node (points->y[p], y0, top->height);
+
+      if (cx < 0 || cy < 0) continue;
+
+      float *z = level_bin (top, top->z, cy, cx);
+      float *n_z = level_bin (top, top->relax, cy, cx);
+
+      *n_z += 1.0;
+      *z += ((float) points->z[p] - *z) / *n_z;
+    }
+
+
+  //  A warm start only helps if the start surface covers this area.
+
+  warm = (start_grid != NULL && options->warm_residual > 0.0 && x1 <= start_width && y1 <= start_height);
+
+  if (warm)
+    {
+      for (int32_t i = 0 ; i < top->height ; i++)
+        {
+          float *relax = level_bin (top, top->relax, i, 0);
+          float *start = &start_grid[(int64_t) (y0 + i) * start_width + x0];
+
+          for (int32_t j = 0 ; j < top->width ; j++) missing += (relax[j] == 0.0 && std::isnan (start[j]));
+        }
+    }
+
+
+  /*  Average each level into the next one down.  From level MG_WIDE_HOLD down the average (and so the held bins)
+      takes in a ring of one bin around the four.  With just the four, the small free gaps that sparse data leaves
+      between held bins get corrections on the coarse levels that the fine ones can't take and the V-cycles slowly
+      diverge instead of converging.  */
+
+  while (MIN (levels[level_count - 1].width, levels[level_count - 1].height) > MG_COARSEST &&
+         level_count < MG_MAX_LEVELS)
+    {
+      MG_LEVEL *fine = &levels[level_count - 1], *coarse = &levels[level_count];
+      int32_t ring = (level_count >= MG_WIDE_HOLD);
+
+      alloc_level (coarse, level_count, (fine->width + 1) / 2, (fine->height + 1) / 2);
+      level_count++;
+
+      for (int32_t i = 0 ; i < coarse->height ; i++)
+        {
+          for (int32_t j = 0 ; j < coarse->width ; j++)
+            {
+              float sum = 0.0, n_z = 0.0;
+
+              for (int32_t fi = MAX (2 * i - ring, 0) ; fi < MIN (2 * i + 2 + ring, fine->height) ; fi++)
+                {
+                  for (int32_t fj = MAX (2 * j - ring, 0) ; fj < MIN (2 * j + 2 + ring, fine->width) ; fj++)
+                    {
+                      float n = *level_bin (fine, fine->relax, fi, fj);
+
+                      sum += n * *level_bin (fine, fine->z, fi, fj);
+                      n_z += n;
+                    }
+                }
+
+              if (n_z > 0.0) *level_bin (coarse, coarse->z, i, j) = sum / n_z;
+              *level_bin (coarse, coarse->relax, i, j) = n_z;
+            }
+        }
+    }
+
+
+  //  Now the counts can become the relax flags.  Get the range for the tolerance and the mean to start from.
+
+  for (int32_t l = 0 ; l < level_count ; l++)
+    {
+      MG_LEVEL *level = &levels[l];
+
+      for (int32_t i = 0 ; i < level->height ; i++)
+        {
+          float *z = level_bin (level, level->z, i, 0);
+          float *relax = level_bin (level, level->relax, i, 0);
+
+          for (int32_t j = 0 ; j < level->width ; j++)
+            {
+              if (relax[j] == 0.0)
+                {
+                  relax[j] = 1.0;
+                  continue;
+                }
+
+              relax[j] = 0.0;
+
+              if (!l)
+                {
+                  if (!bins || z[j] < min_z) min_z = z[j];
+                  if (!bins || z[j] > max_z) max_z = z[j];
+                  sum_z += z[j];
+                  bins++;
+                }
+            }
+        }
+    }
+
+
+  if (bins)
+    {
+      float tolerance = MG_TOLERANCE * MAX (max_z - min_z, 1.0f);
+
+      mean_z = (float) (sum_z / bins);
+
+
+      //  Take the mean off of the data, the free bins of the coarsest level start at 0 (the mean).
+
+      for (int32_t l = 0 ; l < level_count ; l++)
+        {
+          MG_LEVEL *level = &levels[l];
+
+          for (int32_t i = 0 ; i < level->height ; i++)
+            {
+              float *z = level_bin (level, level->z, i, 0);
+              float *relax = level_bin (level, level->relax, i, 0);
+
+              for (int32_t j = 0 ; j < level->width ; j++) z[j] = (relax[j] == 0.0) ? z[j] - mean_z : 0.0f;
+            }
+        }
+
+
+      /*  A start surface that covers every free bin needs nothing from the coarse levels to start from, the full grid
+          goes straight to the V-cycles.  */
+
+      int32_t first = (warm && !missing) ? 0 : level_count - 1;
+
+      for (int32_t l = first ; l >= 0 && !cancelled ; l--)
+        {
+          if (l < first) prolongate (levels, l, 0, levels[l].height, NVFalse);
+
+
+          //  The start surface goes over the prolongated values on the full grid.
+
+          if (!l && warm)
+            {
+              for (int32_t i = 0 ; i < top->height ; i++)
+                {
+                  float *z = level_bin (top, top->z, i, 0);
+                  float *relax = level_bin (top, top->relax, i, 0);
+                  float *start = &start_grid[(int64_t) (y0 + i) * start_width + x0];
+
+                  for (int32_t j = 0 ; j < top->width ; j++)
+                    {
+                      if (relax[j] != 0.0 && !std::isnan (start[j])) z[j] = start[j] - mean_z;
+                    }
+                }
+
+              tolerance = (float) options->warm_residual;
+            }
+
+          int32_t max_cycles = l ? MG_FMG_CYCLES : MG_CYCLES;
+
+          cancelled = solve_level (levels, l, level_count, tolerance, max_cycles, callbacks, &cycles, &residual);
+        }
+
+
+      //  Not converging isn't an error (the surface is still usable) but it should show up in the run report.
+
+      if (!cancelled && residual > tolerance)
+        {
+          capped_solves++;
+
+          if (callbacks)
+            callbacks->message (QCoreApplication::translate ("pfmMisp", "Multigrid : stopped at the %1 V-cycle limit, "
+                                                             "biggest residual %2 (tolerance %3)").arg (MG_CYCLES).
+                                arg (residual, 0, 'g', 3).arg (tolerance, 0, 'g', 3));
+        }
+
+      if (warm && callbacks && !cancelled)
+        callbacks->message (QCoreApplication::translate ("pfmMisp", "Multigrid warm start : %1 V-cycles, biggest "
+                                                         "residual %2, %3 bins not covered").arg (cycles).
+                            arg (residual, 0, 'g', 3).arg ((qlonglong) missing));
+    }
+
+
+  if (!cancelled)
+    {
+      for (int32_t i = 0 ; i < top->height ; i++)
+        {
+          float *z = level_bin (top, top->z, i, 0);
+
+          for (int32_t j = 0 ; j < top->width ; j++) out[(int64_t) i * top->width + j] = bins ? z[j] + mean_z : NAN;
+        }
+
+      if (bins) clip_reach (top, engine_reach (options), out);
+    }
+
+
+  for (int32_t l = 0 ; l < level_count ; l++)
+    {
+      free_scratch_grid (&levels[l].z_scratch);
+      free_scratch_grid (&levels[l].zn_scratch);
+      if (l) free_scratch_grid (&levels[l].f_scratch);
+      free_scratch_grid (&levels[l].relax_scratch);
+    }
+
+
+  return (cancelled ? RUN_CANCELLED : 0);
+}
+
+
+
+/*  Returns how many full grid solves, in all of the multigrid solves in this process so far, stopped at MG_CYCLES
+    V-cycles before they got down to the tolerance.  misp_surface reports how much it went up over a run (see
+    run_stats).  */
+
+int64_t multigrid_capped ()
+{
+  return (capped_solves);
+}
@@ -0,0 +1,216 @@
+
+/*********************************************************************************************
+
+    This is public domain software that was developed by or for the U.S. Naval Oceanographic
+    Office and/or the U.S. Army Corps of Engineers.
+
+    This is a work of the U.S. Government. In accordance with 17 USC 105, copyright protection
+    is not available for any work of the U.S. Government.
+
+    Neither the United States Government, nor any employees of the United States Government,
+    nor the author, makes any warranty, express or implied, without even the implied warranty
+    of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE, or assumes any liability or
+    responsibility for the accuracy, completeness, or usefulness of any information,
+    apparatus, product, or process disclosed, or represents that its use would not infringe
+    privately-owned rights. Reference herein to any specific commercial products, process,
+    or service by trade name, trademark, manufacturer, or otherwise, does not necessarily
+    constitute or imply its endorsement, recommendation, or favoring by the United States
+    Government. The views and opinions of authors expressed herein do not necessarily state
+    or reflect those of the United States Government, and shall not be used for advertising
+    or product endorsement purposes.
+*********************************************************************************************/
+
+
+/****************************************  IMPORTANT NOTE  **********************************
+
+    Comments in this file that start with / * ! or / / ! are being used by Doxygen to
+    document the software.  Dashes in these comment blocks are used to create bullet lists.
+    The lack of blank lines after a block of dash preceeded comments means that the next
+    block of dash preceeded comments is a new, indented bullet list.  I've tried to keep the
+    Doxygen formatting to a minimum but there are some other items (like <br> and <pre>)
+    that need to be left alone.  If you see a comment that starts with / * ! or / / ! and
+    there is something that looks a bit weird it is probably due to some arcane Doxygen
+    syntax.  Be very careful modifying blocks of Doxygen comments.
+
+*****************************************  IMPORTANT NOTE  **********************************/
+
+
+
+#include "nibble.hpp"
+#include "run_bands.hpp"
+
+
+typedef struct
+{
+  BIN_RASTER          *raster;
+  int32_t             nibble;
+  BAND_STATUS         status;
+} NIBBLE_ARGS;
+
+
+
+/*  Row pass.  Slides a 2 * nibble + 1 wide window along each row keeping a count of the data bins in it, so it costs
+    the same no matter how big the nibble distance is.  */
+
+static void nibble_rows (int32_t band __attribute__ ((unused)), int32_t start_row, int32_t end_row, void *data)
+{
+  NIBBLE_ARGS *args = (NIBBLE_ARGS *) data;
+  BIN_RASTER *raster = args->raster;
+  int32_t width = raster->width, k = args->nibble;
+
+
+  for (int32_t i = start_row ; i < end_row ; i++)
+    {
+      if (args->status.cancel) break;
+
+      uint64_t *in = raster_row (raster, RASTER_DATA, i);
+      uint64_t *out = raster_row (raster, RASTER_ROW, i);
+
+      int32_t count = 0;
+      for (int32_t j = 0 ; j <= MIN (k, width - 1) ; j++) count += (in[j >> 6] >> (j & 63)) & 1;
+
+      uint64_t word = 0;
+
+      for (int32_t j = 0 ; j < width ; j++)
+        {
+          if (count) word |= ((uint64_t) 1 << (j & 63));
+
+          if ((j & 63) == 63 || j == width - 1)
+            {
+              out[j >> 6] = word;
+              word = 0;
+            }
+
+          int32_t add = j + k + 1, sub = j - k;
+
+          if (add < width) count += (in[add >> 6] >> (add & 63)) & 1;
+          if (sub >= 0) count -= (in[sub >> 6] >> (sub & 63)) & 1;
+        }
+
+      args->status.rows_done++;
+    }
+}
+
+
+
+/*  Column pass over a range of 64 bit word columns, so 64 columns at a time.  A sliding OR can't be undone like a
+    sliding count so this uses the van Herk/Gil-Werman trick.  The column (padded with nibble empty rows on each end)
+    is cut into blocks of 2 * nibble + 1 rows.  With a running OR forward (g) and backward (h) within each block any
+    window of 2 * nibble + 1 rows is h at its first row OR g at its last row, no matter how big the nibble distance
+    is.  */
+
+static void nibble_columns (int32_t band __attribute__ ((unused)), int32_t start_word, int32_t end_word, void *data)
+{
+  NIBBLE_ARGS *args = (NIBBLE_ARGS *) data;
+  BIN_RASTER *raster = args->raster;
+  int32_t height = raster->height, k = args->nibble, block = 2 * args->nibble + 1;
+  int64_t length = (int64_t) height + 2 * k;
+  uint64_t *g, *h;
+
+
+  if (end_word <= start_word) return;
+
+  g = (uint64_t *) malloc (length * sizeof (uint64_t));
+  h = (uint64_t *) malloc (length * sizeof (uint64_t));
+
+  if (g == NULL || h == NULL)
+    {
+      perror ("Allocating nibble column buffers");
+      exit (-1);
+    }
+
+
+  for (int32_t w = start_word ; w < end_word ; w++)
+    {
+      if (args->status.cancel) break;
+
+      uint64_t *in = &raster->plane[RASTER_ROW][w];
+      uint64_t *out = &raster->plane[RASTER_NEAR][w];
+
+
+      //  Row v of the padded column is row v - k of the raster.
+
+      for (int64_t v = 0 ; v < length ; v++)
+        {
+          int64_t row = v - k;
+          uint64_t value = (row >= 0 && row < height) ? in[row * raster->words] : 0;
+
+          g[v] = (v % block) ? g[v - 1] | value : value;
+        }
+
+      for (int64_t v = length - 1 ; v >= 0 ; v--)
+        {
+          int64_t row = v - k;
+          uint64_t value = (row >= 0 && row < height) ? in[row * raster->words] : 0;
+
+          h[v] = ((v % block) == block - 1 || v == length - 1) ? value : h[v + 1] | value;
+        }
+
+
+      //  The window for row i is padded rows i through i + 2k.
+
+      for (int32_t i = 0 ; i < height ; i++) out[(int64_t) i * raster->words] = h[i] | g[i + 2 * k];
+
+      args->status.rows_done++;
+    }
+
+  free (g);
+  free (h);
+}
+
+
+
+/***************************************************************************\
+*                                                                           *
+*   Module Name:        nibble_mask                                         *
+*                                                                           *
+*   Purpose:            Fills the RASTER_NEAR plane with every bin that is  *
+*                       within "nibble" bins (chessboard distance) of a     *
+*                       bin in the RASTER_DATA plane.  This is a dilation   *
+*                       by a 2 * nibble + 1 square done as two separable    *
+*                       passes (rows then columns) so it is O(bins) for     *
+*                       any nibble distance.  Both passes run in parallel   *
+*                       bands.  pfmMispBench --verify checks it against a   *
+*                       search of the whole square on random masks.        *
+*                                                                           *
+*   Arguments:          raster          -   bin raster                      *
+*                       nibble          -   nibble distance (bins)          *
+*                       callbacks       -   progress hooks                  *
+*                                                                           *
+*   Returns:            NVTrue if the run was cancelled                     *
+*                                                                           *
+\***************************************************************************/
+
+uint8_t nibble_mask (BIN_RASTER *raster, int32_t nibble, RUN_CALLBACKS *callbacks)
+{
+  NIBBLE_ARGS         args;
+  uint8_t             cancelled;
+
+
+  args.raster = raster;
+  args.nibble = nibble;
+
+  alloc_raster_plane (raster, RASTER_ROW);
+  alloc_raster_plane (raster, RASTER_NEAR);
+
+
+  callbacks->phase (QCoreApplication::translate ("pfmMisp", "Clearing interpolated data (distance to data, rows)"),
+                    raster->height);
+
+  cancelled = run_bands (raster->height, band_count (raster->height), nibble_rows, &args, &args.status, callbacks);
+
+
+  if (!cancelled)
+    {
+      callbacks->phase (QCoreApplication::translate ("pfmMisp", "Clearing interpolated data (distance to data, columns)"),
+                        raster->words);
+
+      cancelled = run_bands (raster->words, band_count (raster->words), nibble_columns, &args, &args.status, callbacks);
+    }
+
+
+  free_raster_plane (raster, RASTER_ROW);
+
+
+  return (cancelled);
+}
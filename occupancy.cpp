@@ -0,0 +1,245 @@
+
+/*********************************************************************************************
+
+    This is public domain software that was developed by or for the U.S. Naval Oceanographic
+    Office and/or the U.S. Army Corps of Engineers.
+
+    This is a work of the U.S. Government. In accordance with 17 USC 105, copyright protection
+    is not available for any work of the U.S. Government.
+
+    Neither the United States Government, nor any employees of the United States Government,
+    nor the author, makes any warranty, express or implied, without even the implied warranty
+    of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE, or assumes any liability or
+    responsibility for the accuracy, completeness, or usefulness of any information,
+    apparatus, product, or process disclosed, or represents that its use would not infringe
+    privately-owned rights. Reference herein to any specific commercial products, process,
+    or service by trade name, trademark, manufacturer, or otherwise, does not necessarily
+    constitute or imply its endorsement, recommendation, or favoring by the United States
+    Government. The views and opinions of authors expressed herein do not necessarily state
+    or reflect those of the United States Government, and shall not be used for advertising
+    or product endorsement purposes.
+*********************************************************************************************/
+
+
+/****************************************  IMPORTANT NOTE  **********************************
+
+    Comments in this file that start with / * ! or / / ! are being used by Doxygen to
+    document the software.  Dashes in these comment blocks are used to create bullet lists.
+    The lack of blank lines after a block of dash preceeded comments means that the next
+    block of dash preceeded comments is a new, indented bullet list.  I've tried to keep the
+    Doxygen formatting to a minimum but there are some other items (like <br> and <pre>)
+    that need to be left alone.  If you see a comment that starts with / * ! or / / ! and
+    there is something that looks a bit weird it is probably due to some arcane Doxygen
+    syntax.  Be very careful modifying blocks of Doxygen comments.
+
+*****************************************  IMPORTANT NOTE  **********************************/
+
+
+
+#include "occupancy.hpp"
+#include "ingest.hpp"
+#include "bin_row.hpp"
+#include "warm_start.hpp"
+
+
+typedef struct
+{
+  PFM_OPEN_ARGS       *open_args;
+  int32_t             surfaces;
+  BIN_RASTER          *raster;
+  OCCUPANCY           *occupancy;
+  BAND_STATUS         status;
+} OCCUPANCY_DATA;
+
+
+
+//  Reads the bin records for rows start_row through end_row - 1 and saves the state of each bin in the raster.
+
+static void occupancy_band (int32_t band __attribute__ ((unused)), int32_t start_row, int32_t end_row, void *data)
+{
+  OCCUPANCY_DATA      *args = (OCCUPANCY_DATA *) data;
+  PFM_OPEN_ARGS       band_args;
+  BIN_ROW             row;
+  int32_t             pfm_handle, count;
+
+
+  BIN_HEADER *head = &args->open_args->head;
+  BIN_RASTER *raster = args->raster;
+  OCCUPANCY *occupancy = args->occupancy;
+
+
+  pfm_handle = open_band_pfm (&band_args, args->open_args->list_path);
+
+  if (pfm_handle < 0) pfm_error_exit (pfm_error);
+
+  open_bin_row (&row, pfm_handle, head->bin_width, 0);
+
+
+  for (int32_t i = start_row ; i < end_row ; i++)
+    {
+      if (args->status.cancel) break;
+
+      BIN_RECORD *bins = read_bin_row_buffer (&row, i);
+
+      count = 0;
+
+      for (int32_t j = 0 ; j < head->bin_width ; j++)
+        {
+          if (bins[j].validity & PFM_DATA) raster_set (raster, RASTER_DATA, j, i);
+          if (bins[j].validity & PFM_INTERPOLATED) raster_set (raster, RASTER_INTERPOLATED, j, i);
+          if (bins[j].validity & PFM_USER_10) raster_set (raster, RASTER_LAND, j, i);
+
+          if (bins[j].num_soundings)
+            {
+              raster_set (raster, RASTER_SOUNDINGS, j, i);
+
+              occupancy->soundings[i] += bins[j].num_soundings;
+              count++;
+            }
+        }
+
+
+      //  The filtered surfaces only use the one sounding that matches the bin's filtered depth.
+
+      for (int32_t s = 0 ; count && s < 2 ; s++)
+        {
+          if (!(args->surfaces & (1 << s))) continue;
+
+          float *filtered = occupancy->filtered[s][i] = (float *) malloc (count * sizeof (float));
+
+          if (filtered == NULL)
+            {
+              perror ("Allocating filtered depths");
+              exit (-1);
+            }
+
+          int32_t k = 0;
+
+          for (int32_t j = 0 ; j < head->bin_width ; j++)
+            {
+              if (bins[j].num_soundings) filtered[k++] = s ? bins[j].max_filtered_depth : bins[j].min_filtered_depth;
+            }
+        }
+
+      if (occupancy->surface)
+        {
+          float *surface = &occupancy->surface[(int64_t) i * head->bin_width];
+
+          for (int32_t j = 0 ; j < head->bin_width ; j++) surface[j] = warm_value (args->open_args, &bins[j]);
+        }
+
+      args->status.rows_done++;
+    }
+
+
+  close_bin_row (&row);
+
+  close_band_pfm (pfm_handle);
+}
+
+
+
+/***************************************************************************\
+*                                                                           *
+*   Module Name:        build_occupancy                                     *
+*                                                                           *
+*   Purpose:            Reads all of the bin records (a row at a time, in   *
+*                       parallel row bands) before any depth records are    *
+*                       read.  The DATA, INTERPOLATED, LAND, and SOUNDINGS  *
+*                       planes of the raster are filled and the number of   *
+*                       soundings in each row is saved so that the ingest   *
+*                       pass can skip empty bins and rows and give each     *
+*                       band the same number of soundings to read.  This is *
+*                       the only read of the bin file before the write back *
+*                       so the warm start surface, if there is one, comes   *
+*                       out of it too.  libpfm only reads whole bin records *
+*                       a row at a time (read_bin_record_validity_index is  *
+*                       a call per bin and doesn't have the counts) so      *
+*                       there's no cheaper read of just the state and the   *
+*                       counts.                                             *
+*                                                                           *
+*   Arguments:          open_args       -   open args of the PFM            *
+*                       surfaces        -   surfaces being ingested         *
+*                                           (1 << surface for each)         *
+*                       callbacks       -   progress hooks                  *
+*                       bands           -   number of row bands             *
+*                       raster          -   zeroed bin raster               *
+*                       surface         -   returned warm start surface     *
+*                                           (see warm_value), NULL if not   *
+*                                           wanted                          *
+*                       occupancy       -   returned occupancy (free with   *
+*                                           free_occupancy)                 *
+*                                                                           *
+*   Returns:            NVTrue if the run was cancelled                     *
+*                                                                           *
+\***************************************************************************/
+
+uint8_t build_occupancy (PFM_OPEN_ARGS *open_args, int32_t surfaces, RUN_CALLBACKS *callbacks, int32_t bands,
+                         BIN_RASTER *raster, float *surface, OCCUPANCY *occupancy)
+{
+  OCCUPANCY_DATA      args;
+
+
+  occupancy->height = open_args->head.bin_height;
+  occupancy->soundings = (int64_t *) calloc (occupancy->height, sizeof (int64_t));
+  occupancy->filtered[0] = (float **) calloc (occupancy->height, sizeof (float *));
+  occupancy->filtered[1] = (float **) calloc (occupancy->height, sizeof (float *));
+  occupancy->surface = surface;
+
+  if (occupancy->soundings == NULL || occupancy->filtered[0] == NULL || occupancy->filtered[1] == NULL)
+    {
+      perror ("Allocating occupancy");
+      exit (-1);
+    }
+
+
+  args.open_args = open_args;
+  args.surfaces = surfaces;
+  args.raster = raster;
+  args.occupancy = occupancy;
+
+  return (run_bands (occupancy->height, bands, occupancy_band, &args, &args.status, callbacks));
+}
+
+
+
+/*  Splits the rows into "bands" bands with about the same number of soundings in each (split[band] is the first row
+    of the band, split[bands] is the number of rows).  In a sparse survey most of the depth records are in a few rows
+    so splitting on rows leaves most of the threads with nothing to do.  */
+
+void balance_bands (OCCUPANCY *occupancy, int32_t bands, int32_t *split)
+{
+  int64_t             total = 0, sum = 0;
+  int32_t             band = 1;
+
+
+  for (int32_t i = 0 ; i < occupancy->height ; i++) total += occupancy->soundings[i];
+
+  split[0] = 0;
+
+  for (int32_t i = 0 ; i < occupancy->height && band < bands ; i++)
+    {
+      sum += occupancy->soundings[i];
+
+      while (band < bands && sum * bands >= total * band) split[band++] = i + 1;
+    }
+
+  while (band <= bands) split[band++] = occupancy->height;
+}
+
+
+
+void free_occupancy (OCCUPANCY *occupancy)
+{
+  for (int32_t s = 0 ; s < 2 ; s++)
+    {
+      for (int32_t i = 0 ; i < occupancy->height ; i++)
+        {
+          if (occupancy->filtered[s][i]) free (occupancy->filtered[s][i]);
+        }
+
+      free (occupancy->filtered[s]);
+    }
+
+  free (occupancy->soundings);
+}
@@ -0,0 +1,69 @@
+
+/*********************************************************************************************
+
+    This is public domain software that was developed by or for the U.S. Naval Oceanographic
+    Office and/or the U.S. Army Corps of Engineers.
+
+    This is a work of the U.S. Government. In accordance with 17 USC 105, copyright protection
+    is not available for any work of the U.S. Government.
+
+    Neither the United States Government, nor any employees of the United States Government,
+    nor the author, makes any warranty, express or implied, without even the implied warranty
+    of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE, or assumes any liability or
+    responsibility for the accuracy, completeness, or usefulness of any information,
+    apparatus, product, or process disclosed, or represents that its use would not infringe
+    privately-owned rights. Reference herein to any specific commercial products, process,
+    or service by trade name, trademark, manufacturer, or otherwise, does not necessarily
+    constitute or imply its endorsement, recommendation, or favoring by the United States
+    Government. The views and opinions of authors expressed herein do not necessarily state
+    or reflect those of the United States Government, and shall not be used for advertising
+    or product endorsement purposes.
+*********************************************************************************************/
+
+
+/****************************************  IMPORTANT NOTE  **********************************
+
+    Comments in this file that start with / * ! or / / ! are being used by Doxygen to
+    document the software.  Dashes in these comment blocks are used to create bullet lists.
+    The lack of blank lines after a block of dash preceeded comments means that the next
+    block of dash preceeded comments is a new, indented bullet list.  I've tried to keep the
+    Doxygen formatting to a minimum but there are some other items (like <br> and <pre>)
+    that need to be left alone.  If you see a comment that starts with / * ! or / / ! and
+    there is something that looks a bit weird it is probably due to some arcane Doxygen
+    syntax.  Be very careful modifying blocks of Doxygen comments.
+
+*****************************************  IMPORTANT NOTE  **********************************/
+
+
+
+#ifndef OCCUPANCY_H
+#define OCCUPANCY_H
+
+#include "pfmMispDef.hpp"
+#include "run_bands.hpp"
+#include "bin_raster.hpp"
+
+
+/*  What the ingest pass needs to know about the bins before it reads any depth records.  The bins that have soundings
+    are the RASTER_SOUNDINGS plane of the bin raster, this adds the number of soundings in each row (for balancing
+    the ingest bands) and, for the filtered surfaces, the filtered depth of each bin with soundings so that ingest
+    doesn't have to read the bin records again (filtered[0] for the minimum and filtered[1] for the maximum filtered
+    surface, only allocated if that surface is being ingested).  If surface isn't NULL the warm start surface is saved
+    in it from the same read (see warm_value).  */
+
+typedef struct
+{
+  int32_t             height;
+  int64_t             *soundings;                 //  Number of soundings in each row
+  float               **filtered[2];              //  Filtered depth of each bin with soundings, in column order
+  float               *surface;                   //  bin_width by bin_height warm start surface or NULL
+} OCCUPANCY;
+
+
+uint8_t build_occupancy (PFM_OPEN_ARGS *open_args, int32_t surfaces, RUN_CALLBACKS *callbacks, int32_t bands,
+                         BIN_RASTER *raster, float *surface, OCCUPANCY *occupancy);
+void balance_bands (OCCUPANCY *occupancy, int32_t bands, int32_t *split);
+void free_occupancy (OCCUPANCY *occupancy);
+
+
+#endif
@@ -38,28 +38,15 @@
 
 #include "pfmMisp.hpp"
 #include "pfmMispHelp.hpp"
+#include "misp_surface.hpp"
+#include "set_defaults.hpp"
+#include "surface_engine.hpp"
 
 
 double settings_version = 1.0;
 
 
 QListWidget      *checkList;
-RUN_PROGRESS     *surfProg;
-
-
-static void misp_progress_callback (char *info)
-{
-  if (strlen (info) >= 2)
-    {
-      QListWidgetItem *cur = new QListWidgetItem (QString (info));
-      checkList->addItem (cur);
-      checkList->setCurrentItem (cur);
-      checkList->scrollToItem (cur);
-    }
-
-  qApp->processEvents ();
-}
-
 
 
 pfmMisp::pfmMisp (int32_t *argc, char **argv, QWidget *parent)
@@ -112,6 +99,10 @@ pfmMisp::pfmMisp (int32_t *argc, char **argv, QWidget *parent)
   connect (this, SIGNAL (customButtonClicked (int)), this, SLOT (slotCustomButtonClicked (int)));
 
 
+  run_thread = NULL;
+  worker = NULL;
+
+
   setStartId (0);
 }
 
@@ -145,8 +136,19 @@ void pfmMisp::initializePage (int id)
       options.nibble = field ("nibble").toInt ();
       options.clear_land = field ("clearLand").toBool ();
       options.replace_all = field ("replaceAll").toBool ();
+      options.hole_fill = field ("holeFill").toBool ();
       options.weight = field ("factor").toInt ();
+      options.engine = field ("engine").toInt ();
+      options.warm_residual = field ("warmResidual").toDouble ();
       options.force_original_value = field ("force").toBool ();
+      options.tile_size = field ("tileSize").toInt ();
+      options.tile_halo = field ("tileHalo").toInt ();
+      options.point_cache = field ("pointCache").toBool ();
+      options.reduce = field ("reduce").toInt ();
+      options.reduce_cap = field ("reduceCap").toInt ();
+      options.memory_budget = field ("memoryBudget").toInt ();
+      options.export_mask = (field ("exportMin").toBool () ? 1 : 0) | (field ("exportMax").toBool () ? 2 : 0) |
+        (field ("exportAll").toBool () ? 4 : 0);
 
 
       //  Use frame geometry to get the absolute x and y.
@@ -199,6 +201,7 @@ void pfmMisp::initializePage (int id)
         case NVFalse:
           string = tr ("Replace only empty bins with interpolated value");
           checkList->addItem (string);
+          if (options.hole_fill) checkList->addItem (tr ("Solve each hole on its own"));
           break;
 
         case NVTrue:
@@ -234,10 +237,56 @@ void pfmMisp::initializePage (int id)
           break;
         }
 
+      string = QString (tr ("Interpolation engine : %1")).
+        arg (QCoreApplication::translate ("pfmMisp", surface_engines[options.engine].title));
+      checkList->addItem (string);
+
+      if (options.warm_residual > 0.0)
+        {
+          string = QString (tr ("Warm start from the PFM surface, residual : %1")).
+            arg (options.warm_residual, 0, 'f', 3);
+          checkList->addItem (string);
+        }
+
       string = QString (tr ("MISP weight factor : %1")).arg (options.weight);
       checkList->addItem (string);
 
 
+      if (options.tile_size)
+        {
+          string = QString (tr ("Tile size (bins) : %1, halo (bins) : %2")).arg (options.tile_size).arg (options.tile_halo);
+          checkList->addItem (string);
+        }
+
+
+      if (options.point_cache)
+        {
+          string = tr ("Use/save the point cache");
+          checkList->addItem (string);
+        }
+
+
+      if (options.memory_budget)
+        {
+          string = QString (tr ("Memory budget (MB) : %1")).arg (options.memory_budget);
+          checkList->addItem (string);
+        }
+
+
+      if (options.surface == 2 && options.reduce)
+        {
+          QString method[5] = {"", tr ("mean"), tr ("median"), tr ("trimmed mean"), tr ("stratified")};
+
+          string = QString (tr ("Reduce bins with more than %1 soundings (%2)")).arg (options.reduce_cap).arg (method[options.reduce]);
+          checkList->addItem (string);
+        }
+
+
+      if (options.export_mask & 1) checkList->addItem (tr ("Export the Minimum Filtered Surface"));
+      if (options.export_mask & 2) checkList->addItem (tr ("Export the Maximum Filtered Surface"));
+      if (options.export_mask & 4) checkList->addItem (tr ("Export the all depths surface"));
+
+
       if (options.clear_int)
         {
           string = QString (tr ("Nibbler value (bins) : %1")).arg (options.nibble);
@@ -274,495 +323,137 @@ void pfmMisp::slotHelpClicked ()
 
 
 
-//  This is where the fun stuff happens.
+//  This is where the fun stuff happens (see misp_surface.cpp).  The processing runs in mispWorker on its own thread so
+//  the GUI stays responsive and the Cancel button works.
 
 void 
 pfmMisp::slotCustomButtonClicked (int id __attribute__ ((unused)))
 {
-  int32_t             recnum, pfm_handle, out_count = 0, dn, up, bw, fw;
-  float               *array;
-  double              lat, lon;
-  NV_F64_XYMBR        mbr;
-  NV_F64_COORD3       xyz;
-  BIN_RECORD          bin;
-  DEPTH_RECORD        *depth;
-  NV_I32_COORD2       coord;
-  PFM_OPEN_ARGS       open_args;
-  uint8_t             found = NVFalse, land_mask_flag = NVFalse;
-  uint32_t            **val_array = NULL;
-
-
-  QApplication::setOverrideCursor (Qt::WaitCursor);
+  QApplication::setOverrideCursor (Qt::BusyCursor);
 
 
   button (QWizard::FinishButton)->setEnabled (false);
   button (QWizard::BackButton)->setEnabled (false);
   button (QWizard::CustomButton1)->setEnabled (false);
+  button (QWizard::CancelButton)->setEnabled (true);
 
 
-  strcpy (open_args.list_path, pfm_file_name.toLatin1 ());
-
-  open_args.checkpoint = 0;
-  pfm_handle = open_existing_pfm_file (&open_args);
-
-  if (pfm_handle < 0) pfm_error_exit (pfm_error);
-
-
-  //  Check for the land mask flag in PFM_USER_10 in any of the PFM layers.
-
-  land_mask_flag = NVFalse;
-  if (!strcmp (open_args.head.user_flag_name[9], "Land masked point")) land_mask_flag = NVTrue;
-
+  run_thread = new QThread (this);
+  worker = new mispWorker (pfm_file_name, &options);
+  worker->moveToThread (run_thread);
 
-  /*  We're going to let MISP handle everything in zero based units of the bin size.  That is, we subtract off the
-      west lon from longitudes then divide by the grid size in the X direction.  We do the same with the latitude using
-      the south latitude.  This will give us values that range from 0.0 to gridcols in longitude and 0.0 to gridrows
-      in latitude.  The assumption here is that the bins are essentially squares (spatially).  */
+  connect (run_thread, SIGNAL (started ()), worker, SLOT (slotRun ()));
+  connect (worker, SIGNAL (phaseStarted (QString, int)), this, SLOT (slotPhaseStarted (QString, int)));
+  connect (worker, SIGNAL (progressValue (int)), this, SLOT (slotProgressValue (int)));
+  connect (worker, SIGNAL (statusMessage (QString)), this, SLOT (slotStatusMessage (QString)));
+  connect (worker, SIGNAL (runFinished (int)), this, SLOT (slotRunFinished (int)));
 
-  mbr.min_x = 0.0;
-  mbr.min_y = 0.0;
-  if (open_args.head.proj_data.projection)
-    {
-      mbr.max_x = (double) NINT ((open_args.head.mbr.max_x - open_args.head.mbr.min_x) / open_args.head.bin_size_xy);
-      mbr.max_y = (double) NINT ((open_args.head.mbr.max_y - open_args.head.mbr.min_y) / open_args.head.bin_size_xy);
-    }
-  else
-    {
-      mbr.max_x = (double) NINT ((open_args.head.mbr.max_x - open_args.head.mbr.min_x) /
-                                     open_args.head.x_bin_size_degrees);
-      mbr.max_y = (double) NINT ((open_args.head.mbr.max_y - open_args.head.mbr.min_y) /
-                                     open_args.head.y_bin_size_degrees);
-    }
-
-
-  //  Register the progress callback with MISP.
-
-  misp_register_progress_callback (misp_progress_callback);
-
-  misp_init (1.0, 1.0, 0.05, 4, 20.0, 20, 999999.0, -999999.0, options.weight, mbr);
-
-
-  progress.gbox->setTitle (tr ("Reading data for surface"));
-
-  progress.gbar->setRange (0, open_args.head.bin_height);
-
-
-  for (int32_t i = 0 ; i < open_args.head.bin_height ; i++)
-    {
-      coord.y = i;
-
-      for (int32_t j = 0 ; j < open_args.head.bin_width ; j++)
-        {
-          coord.x = j;
-
-          read_bin_record_index (pfm_handle, coord, &bin);
-
-          if (bin.num_soundings)
-            {
-              if (!read_depth_array_index (pfm_handle, coord, &depth, &recnum))
-                {
-                  found = NVFalse;
-                  for (int32_t k = 0 ; k < recnum ; k++)
-                    {
-                      switch (options.surface)
-                        {
-                        case 2:
-                          if (!(depth[k].validity & (PFM_INVAL | PFM_DELETED | PFM_REFERENCE)))
-                            {
-                              out_count++;
-    
-                              if (open_args.head.proj_data.projection)
-                                {
-                                  xyz.x = (depth[k].xyz.x - open_args.head.mbr.min_x) / open_args.head.bin_size_xy;
-                                  xyz.y = (depth[k].xyz.y - open_args.head.mbr.min_y) / open_args.head.bin_size_xy;
-                                }
-                              else
-                                {
-                                  xyz.x = (depth[k].xyz.x - open_args.head.mbr.min_x) / open_args.head.x_bin_size_degrees;
-                                  xyz.y = (depth[k].xyz.y - open_args.head.mbr.min_y) / open_args.head.y_bin_size_degrees;
-                                }
-
-                              xyz.z = depth[k].xyz.z;
-
-                              misp_load (xyz);
-                            }
-                          break;
-    
-    
-                        case 0:
-                          if ((!(depth[k].validity & (PFM_INVAL | PFM_DELETED | PFM_REFERENCE))) && 
-                              fabs (depth[k].xyz.z - bin.min_filtered_depth) < MISP_EPS)
-                            {
-                              out_count++;
-
-                              if (open_args.head.proj_data.projection)
-                                {
-                                  xyz.x = (depth[k].xyz.x - open_args.head.mbr.min_x) / open_args.head.bin_size_xy;
-                                  xyz.y = (depth[k].xyz.y - open_args.head.mbr.min_y) / open_args.head.bin_size_xy;
-                                }
-                              else
-                                {
-                                  xyz.x = (depth[k].xyz.x - open_args.head.mbr.min_x) / open_args.head.x_bin_size_degrees;
-                                  xyz.y = (depth[k].xyz.y - open_args.head.mbr.min_y) / open_args.head.y_bin_size_degrees;
-                                }
-    
-                              xyz.z = depth[k].xyz.z;
-
-                              misp_load (xyz);
-
-                              found = NVTrue;
-                            }
-                          break;
-    
-    
-                        case 1:
-                          if ((!(depth[k].validity & (PFM_INVAL | PFM_DELETED | PFM_REFERENCE))) &&
-                              fabs (depth[k].xyz.z - bin.max_filtered_depth) < MISP_EPS)
-                            {
-                              out_count++;
-    
-                              if (open_args.head.proj_data.projection)
-                                {
-                                  xyz.x = (depth[k].xyz.x - open_args.head.mbr.min_x) / open_args.head.bin_size_xy;
-                                  xyz.y = (depth[k].xyz.y - open_args.head.mbr.min_y) / open_args.head.bin_size_xy;
-                                }
-                              else
-                                {
-                                  xyz.x = (depth[k].xyz.x - open_args.head.mbr.min_x) / open_args.head.x_bin_size_degrees;
-                                  xyz.y = (depth[k].xyz.y - open_args.head.mbr.min_y) / open_args.head.y_bin_size_degrees;
-                                }
-    
-                              xyz.z = depth[k].xyz.z;
-
-                              misp_load (xyz);
-
-                              found = NVTrue;
-                            }
-                          break;
-                        }
-                      if (found) break;
-                    }
-                  free (depth);
-                }
-            }
-        }
+  run_thread->start ();
+}
 
 
-      progress.gbar->setValue (i);
 
-      qApp->processEvents ();
-    }
+void pfmMisp::slotPhaseStarted (QString title, int range)
+{
   progress.gbar->reset ();
+  progress.gbox->setTitle (title);
+  progress.gbar->setRange (0, range);
+}
 
 
-  progress.gbox->setTitle (tr ("Generating grid surface"));
-
-
-  //  Setting range to 0, 0 makes the bar just show movement.
-
-  progress.gbar->setRange (0, 0);
-
-  qApp->processEvents ();
 
+void pfmMisp::slotProgressValue (int value)
+{
+  progress.gbar->setValue (value);
+}
 
-  if (misp_proc ()) exit (-1);
 
 
-  if (options.replace_all)
-    {
-      switch (options.surface)
-        {
-        case 2:
-          strcpy (open_args.head.average_filt_name, "AVERAGE MISP SURFACE");
-          write_bin_header (pfm_handle, &open_args.head, 0);
-          break;
-
-        case 0:
-          strcpy (open_args.head.average_filt_name, "MINIMUM MISP SURFACE");
-          write_bin_header (pfm_handle, &open_args.head, 0);
-          break;
+void pfmMisp::slotStatusMessage (QString info)
+{
+  QListWidgetItem *cur = new QListWidgetItem (info);
+  checkList->addItem (cur);
+  checkList->setCurrentItem (cur);
+  checkList->scrollToItem (cur);
+}
 
-        case 1:
-          strcpy (open_args.head.average_filt_name, "MAXIMUM MISP SURFACE");
-          write_bin_header (pfm_handle, &open_args.head, 0);
-          break;
-        }
-    }
 
 
-  progress.gbar->setRange (0, open_args.head.bin_height);
+void pfmMisp::slotRunFinished (int status)
+{
+  run_thread->quit ();
+  run_thread->wait ();
 
-  progress.gbox->setTitle (tr ("Retrieving gridded surface data"));
+  delete worker;
+  delete run_thread;
+  worker = NULL;
+  run_thread = NULL;
 
 
-  /*  Allocating one more column than we need due to chrtr specific changes in misp_rtrv (see misp_funcs.c).  */
+  QApplication::restoreOverrideCursor ();
 
-  array = (float *) malloc ((open_args.head.bin_width + 1) * sizeof (float));
 
-  if (array == NULL)
-    {
-      perror ("Allocating array");
-      exit (-1);
-    }
+  checkList->addItem (" ");
 
+  QListWidgetItem *cur;
 
-  for (int32_t i = 0 ; i < open_args.head.bin_height ; i++)
+  if (status == RUN_CANCELLED)
     {
-      //  Compute the latitude of the bin.
-
-      NV_F64_COORD2 xy;
-      xy.y = open_args.head.mbr.min_y + i * open_args.head.y_bin_size_degrees;
-
-
-      coord.y = i;
-
-      if (!misp_rtrv (array)) break;
-
-      for (int32_t j = 0 ; j < open_args.head.bin_width ; j++)
-        {
-          //  Compute the longitude of the bin.
-
-          xy.x = open_args.head.mbr.min_x + j * open_args.head.x_bin_size_degrees;
-
-
-          //  Don't try to write points that fall outside of the PFM polygon (it might not be a rectangle).
-
-          if (bin_inside_ptr (&open_args.head, xy))
-            {
-              coord.x = j;
-
-
-              read_bin_record_index (pfm_handle, coord, &bin);
-
-
-              //  This is a special case.  We don't want to replace land masked bins unless the land mask point has been
-              //  deleted.
-
-              if (!land_mask_flag || !(bin.validity & PFM_DATA) || !(bin.validity & PFM_USER_10))
-                {
-                  if (options.replace_all || !(bin.validity & PFM_DATA)) 
-                    {
-                      bin.validity |= PFM_INTERPOLATED;
-                      if (array[j] <= open_args.max_depth && array[j] > -open_args.offset)
-                        {
-                          bin.avg_filtered_depth = array[j];
-                        }
-                      else
-                        {
-                          bin.avg_filtered_depth = open_args.head.null_depth;
-                        }
-
-
-                      //  If there was a land mask point in this bin and it has been deleted, unset the 
-                      //  PFM_USER_10 flag.
-
-                      if (bin.validity & PFM_USER_10) bin.validity &= ~PFM_USER_10;
-
-
-                      //  If we set the nibble argument to 0 we don't want to put interpolated values into
-                      //  empty bins.
-
-                      if ((bin.validity & PFM_DATA) || !options.clear_int || (options.clear_int && options.nibble)) write_bin_record_index (pfm_handle, &bin);
-                    }
-                }
-            }
-        }
+      progress.gbar->reset ();
 
-      progress.gbar->setValue (i);
+      button (QWizard::BackButton)->setEnabled (true);
+      button (QWizard::CustomButton1)->setEnabled (true);
 
-      qApp->processEvents ();
+      cur = new QListWidgetItem (tr ("Gridding cancelled.  If it was cancelled after the surface was generated the "
+                                     "PFM has been partially updated, press Run to regenerate it."));
     }
-
-  free (array);
-
-  progress.gbar->setValue (open_args.head.bin_height);
-
-
-  qApp->processEvents ();
-
-
-  /*  Nibble out the cells that aren't within our optional nibbling distance from a cell with valid data.  */
-
-  if (options.clear_int && options.nibble)
+  else if (status == RUN_CHECK_FAILED)
     {
-      /*  This can get into a fair amount of memory but it is the most
-          efficient way to do this since we're doing, basically, sequential
-          I/O on both ends.  If you have a 2000 by 2000 cell bin this will
-          allocate 16MB of memory.  Hopefully your machine can handle that.
-          If not, buy a new machine.  */
-
-      val_array = (uint32_t **) calloc (open_args.head.bin_height, sizeof (uint32_t *));
-
-      if (val_array == NULL)
-        {
-          perror ("Allocating val_array");
-          exit (-1);
-        }
-
-
-
-      for (int32_t i = 0 ; i < open_args.head.bin_height ; i++)
-        {
-          val_array[i] = (uint32_t *) calloc (open_args.head.bin_width, sizeof (uint32_t));
-
-          if (val_array[i] == NULL)
-            {
-              perror ("Allocating memory for nibbler");
-              exit (-1);
-            }
-        }
-
-
       progress.gbar->reset ();
 
-      progress.gbox->setTitle (tr ("Clearing interpolated data (reading validity)"));
-
-      progress.gbar->setRange (0, open_args.head.bin_height);
-
-
-      for (int32_t i = 0 ; i < open_args.head.bin_height ; i++)
-        {
-          coord.y = i;
-
-          for (int32_t j = 0 ; j < open_args.head.bin_width ; j++)
-            {
-              coord.x = j;
-
-              read_bin_record_validity_index (pfm_handle, coord, &val_array[i][j]);
-            }
-
-          progress.gbar->setValue (i);
-
-          qApp->processEvents ();
-        }
-
-      progress.gbar->setValue (open_args.head.bin_height);
-
-      qApp->processEvents ();
-
-
-      progress.gbar->reset ();
-
-      progress.gbox->setTitle (tr ("Clearing interpolated data (nibbling)"));
-
-      progress.gbar->setRange (0, open_args.head.bin_height);
-
-
-      for (int32_t i = 0 ; i < open_args.head.bin_height ; i++)
-        {
-          coord.y = i;
-
-          dn = MAX (i - options.nibble, 0);
-          up = MIN (i + options.nibble, open_args.head.bin_height - 1);
-
-          for (int32_t j = 0 ; j < open_args.head.bin_width ; j++)
-            {
-              coord.x = j;
-
-              if (!(val_array[i][j] & PFM_DATA))
-                {
-                  bw = MAX (j - options.nibble, 0);
-                  fw = MIN (j + options.nibble, open_args.head.bin_width - 1);
-
-                  found = NVFalse;
-                  for (int32_t k = dn ; k <= up ; k++)
-                    {
-                      for (int32_t m = bw ; m <= fw ; m++)
-                        {
-                          if (val_array[k][m] & PFM_DATA)
-                            {
-                              found = NVTrue;
-                              break;
-                            }
-                        }
-                      if (found) break;
-                    }
-
-                  if (!found)
-                    {
-                      bin.coord = coord;
-                      bin.validity = val_array[i][j] & (~PFM_INTERPOLATED);
-                      write_bin_record_validity_index (pfm_handle, &bin, PFM_INTERPOLATED);
-                    }
-                }
-            }
-
-          progress.gbar->setValue (i);
-
-          qApp->processEvents ();
-        }
-
-      progress.gbar->setValue (open_args.head.bin_height);
+      button (QWizard::BackButton)->setEnabled (true);
+      button (QWizard::CustomButton1)->setEnabled (true);
 
-      qApp->processEvents ();
+      cur = new QListWidgetItem (tr ("Gridding failed, the tiled surface didn't match the single grid within the "
+                                     "check tolerance.  The PFM has not been changed."));
     }
-
-
-  /*  Clear landmasked data if requested.  */
-
-  if (options.clear_land)
+  else
     {
-      progress.gbar->reset ();
-
-      progress.gbox->setTitle (tr ("Clearing SRTM land data"));
-
-      progress.gbar->setRange (0, open_args.head.bin_height);
-
-
-      for (int32_t i = 0 ; i < open_args.head.bin_height ; i++)
-        {
-          coord.y = i;
+      progress.gbar->setValue (progress.gbar->maximum ());
 
-          lat = open_args.head.mbr.min_y + ((double) i + 0.5) * open_args.head.y_bin_size_degrees;
+      button (QWizard::FinishButton)->setEnabled (true);
+      button (QWizard::CancelButton)->setEnabled (false);
 
-          for (int32_t j = 0 ; j < open_args.head.bin_width ; j++)
-            {
-              coord.x = j;
-
-              lon = open_args.head.mbr.min_x + ((double) j + 0.5) * open_args.head.x_bin_size_degrees;
+      cur = new QListWidgetItem (tr ("Gridding complete, press Finish to exit."));
+    }
 
-              read_bin_record_index (pfm_handle, coord, &bin);
+  checkList->addItem (cur);
+  checkList->setCurrentItem (cur);
+  checkList->scrollToItem (cur);
+}
 
 
-              /*  If there's real data in the cell don't believe the mask.  */
 
-              if (!(bin.num_soundings))
-                {
-                  if (read_srtm_mask (lat, lon) == 1)
-                    {
-                      bin.validity &= (~PFM_INTERPOLATED);
-                      write_bin_record_index (pfm_handle, &bin);
-                    }
-                }
-            }
+//  While the worker is running the Cancel button (or closing the window) stops the run instead of closing the wizard.
 
-          progress.gbar->setValue (i);
+void pfmMisp::reject ()
+{
+  if (worker)
+    {
+      worker->cancel ();
 
-          qApp->processEvents ();
-        }
+      button (QWizard::CancelButton)->setEnabled (false);
 
-      progress.gbar->setValue (open_args.head.bin_height);
+      QListWidgetItem *cur = new QListWidgetItem (tr ("Cancelling, the run will stop at the end of the current row "
+                                                     "(surface generation itself can't be interrupted)..."));
+      checkList->addItem (cur);
+      checkList->setCurrentItem (cur);
+      checkList->scrollToItem (cur);
 
-      qApp->processEvents ();
+      return;
     }
 
-  close_pfm_file (pfm_handle);
-
-
-  button (QWizard::FinishButton)->setEnabled (true);
-  button (QWizard::CancelButton)->setEnabled (false);
-
-
-  QApplication::restoreOverrideCursor ();
-  qApp->processEvents ();
-
-
-  checkList->addItem (" ");
-  QListWidgetItem *cur = new QListWidgetItem (tr ("Gridding complete, press Finish to exit."));
-
-  checkList->addItem (cur);
-  checkList->setCurrentItem (cur);
-  checkList->scrollToItem (cur);
+  QWizard::reject ();
 }
 
 
@@ -798,18 +489,7 @@ void pfmMisp::envin (OPTIONS *options)
 
   // Set defaults so that if keys don't exist the parameters are defined
 
-  options->clear_land = NVFalse;
-  options->replace_all = NVFalse;
-  options->force_original_value = NVFalse;
-  options->surface = 2;
-  options->clear_int = 0;
-  options->nibble = 0;
-  options->weight = 2;
-  options->input_dir = ".";
-  options->window_x = 0;
-  options->window_y = 0;
-  options->window_width = 800;
-  options->window_height = 400;
+  set_defaults (options);
 
 
   //  Get the INI file name
@@ -834,6 +514,7 @@ void pfmMisp::envin (OPTIONS *options)
   options->clear_land = settings.value (QString ("clear land"), options->clear_land).toBool ();
 
   options->replace_all = settings.value (QString ("replace all"), options->replace_all).toBool ();
+  options->hole_fill = settings.value (QString ("hole fill"), options->hole_fill).toBool ();
 
   options->force_original_value = settings.value (QString ("force original value"), options->force_original_value).toBool ();
 
@@ -843,6 +524,17 @@ void pfmMisp::envin (OPTIONS *options)
   options->nibble = settings.value (QString ("nibble value"), options->nibble).toInt ();
 
   options->weight = settings.value (QString ("weight"), options->weight).toInt ();
+  options->engine = settings.value (QString ("engine"), options->engine).toInt ();
+  if (options->engine < 0 || options->engine >= ENGINE_COUNT) options->engine = ENGINE_MISP;
+  options->warm_residual = settings.value (QString ("warm residual"), options->warm_residual).toDouble ();
+
+  options->tile_size = settings.value (QString ("tile size"), options->tile_size).toInt ();
+  options->tile_halo = settings.value (QString ("tile halo"), options->tile_halo).toInt ();
+  options->point_cache = settings.value (QString ("point cache"), options->point_cache).toBool ();
+  options->reduce = settings.value (QString ("bin reduction"), options->reduce).toInt ();
+  options->reduce_cap = settings.value (QString ("bin reduction limit"), options->reduce_cap).toInt ();
+  options->memory_budget = settings.value (QString ("memory budget"), options->memory_budget).toInt ();
+  options->export_mask = settings.value (QString ("export surfaces"), options->export_mask).toInt ();
 
   options->input_dir = settings.value (QString ("input directory"), options->input_dir).toString ();
 
@@ -877,6 +569,7 @@ void pfmMisp::envout (OPTIONS *options)
   settings.setValue (QString ("clear land"), options->clear_land);
 
   settings.setValue (QString ("replace all"), options->replace_all);
+  settings.setValue (QString ("hole fill"), options->hole_fill);
 
   settings.setValue (QString ("force original value"), options->force_original_value);
 
@@ -886,6 +579,16 @@ void pfmMisp::envout (OPTIONS *options)
   settings.setValue (QString ("nibble value"), options->nibble);
 
   settings.setValue (QString ("weight"), options->weight);
+  settings.setValue (QString ("engine"), options->engine);
+  settings.setValue (QString ("warm residual"), options->warm_residual);
+
+  settings.setValue (QString ("tile size"), options->tile_size);
+  settings.setValue (QString ("tile halo"), options->tile_halo);
+  settings.setValue (QString ("point cache"), options->point_cache);
+  settings.setValue (QString ("bin reduction"), options->reduce);
+  settings.setValue (QString ("bin reduction limit"), options->reduce_cap);
+  settings.setValue (QString ("memory budget"), options->memory_budget);
+  settings.setValue (QString ("export surfaces"), options->export_mask);
 
   settings.setValue (QString ("input directory"), options->input_dir);
 
@@ -43,6 +43,7 @@
 #include "startPage.hpp"
 #include "surfacePage.hpp"
 #include "runPage.hpp"
+#include "mispWorker.hpp"
 
 
 class pfmMisp : public QWizard
@@ -55,6 +56,8 @@ public:
   pfmMisp (int32_t *argc = 0, char **argv = 0, QWidget *parent = 0);
   ~pfmMisp ();
 
+  void reject ();
+
 
 protected:
 
@@ -72,11 +75,19 @@ protected:
 
   QString          pfm_file_name;
 
+  QThread          *run_thread;
+
+  mispWorker       *worker;
+
 
 protected slots:
 
   void slotHelpClicked ();
   void slotCustomButtonClicked (int id);
+  void slotPhaseStarted (QString title, int range);
+  void slotProgressValue (int value);
+  void slotStatusMessage (QString info);
+  void slotRunFinished (int status);
 
 };
 
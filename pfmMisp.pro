@@ -5,7 +5,7 @@ QT +=
 INCLUDEPATH += /c/PFM_ABEv7.0.0_Win64/include
 LIBS += -L /c/PFM_ABEv7.0.0_Win64/lib -lmisp -lnvutility -lpfm -lgdal -lxml2 -lpoppler -liconv
 DEFINES += WIN32 NVWIN3X
-CONFIG += console
+CONFIG += console c++11
 QMAKE_LFLAGS += 
 ######################################################################
 # Automatically generated by qmake (2.01a) Wed Jan 22 14:45:27 2020
@@ -17,14 +17,72 @@ DEPENDPATH += .
 INCLUDEPATH += .
 
 # Input
-HEADERS += pfmMisp.hpp \
+HEADERS += batch_misp.hpp \
+           bin_raster.hpp \
+           bin_row.hpp \
+           export_grid.hpp \
+           ingest.hpp \
+           misp_surface.hpp \
+           nibble.hpp \
+           occupancy.hpp \
+           mispWorker.hpp \
+           pfmMisp.hpp \
            pfmMispDef.hpp \
            pfmMispHelp.hpp \
+           point_buffer.hpp \
+           point_cache.hpp \
+           point_ring.hpp \
+           reduce_bin.hpp \
+           scratch_grid.hpp \
+           hole_fill.hpp \
+           surface_engine.hpp \
+           idw_engine.hpp \
+           tin_engine.hpp \
+           multigrid_engine.hpp \
+           warm_start.hpp \
+           polygon_spans.hpp \
            runPage.hpp \
+           run_bands.hpp \
+           run_stats.hpp \
+           set_defaults.hpp \
+           solve_surface.hpp \
+           srtm_raster.hpp \
            startPage.hpp \
            startPageHelp.hpp \
            surfacePage.hpp \
            surfacePageHelp.hpp \
-           version.hpp
-SOURCES += main.cpp pfmMisp.cpp runPage.cpp startPage.cpp surfacePage.cpp
+           version.hpp \
+           write_surface.hpp
+SOURCES += batch_misp.cpp \
+           bin_raster.cpp \
+           bin_row.cpp \
+           export_grid.cpp \
+           ingest.cpp \
+           main.cpp \
+           misp_surface.cpp \
+           nibble.cpp \
+           occupancy.cpp \
+           mispWorker.cpp \
+           pfmMisp.cpp \
+           point_buffer.cpp \
+           point_cache.cpp \
+           point_ring.cpp \
+           reduce_bin.cpp \
+           scratch_grid.cpp \
+           hole_fill.cpp \
+           surface_engine.cpp \
+           idw_engine.cpp \
+           tin_engine.cpp \
+           multigrid_engine.cpp \
+           warm_start.cpp \
+           polygon_spans.cpp \
+           runPage.cpp \
+           run_bands.cpp \
+           run_stats.cpp \
+           set_defaults.cpp \
+           solve_surface.cpp \
+           srtm_raster.cpp \
+           startPage.cpp \
+           surfacePage.cpp \
+           write_surface.cpp
 RESOURCES += icons.qrc
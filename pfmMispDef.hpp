@@ -59,6 +59,11 @@
 
 #define         MISP_EPS    1.0e-3         /* epsilon criteria for finding winner */
 
+#define         NO_GRID_VALUE   999999.0   /* MISP max value, anything out of range is written as the null depth */
+
+#define         RUN_CANCELLED   1          /* misp_surface return value when the run was cancelled */
+#define         RUN_CHECK_FAILED 2         /* misp_surface return value when the tiled surface failed the check */
+
 
 
 typedef struct
@@ -71,9 +76,20 @@ typedef struct
   int32_t       nibble;
   uint8_t       clear_int;
   int32_t       weight;
+  int32_t       engine;                     //  Interpolator, ENGINE_MISP, ENGINE_IDW, ENGINE_TIN, or ENGINE_MULTIGRID (see surface_engine)
   uint8_t       force_original_value;
   uint8_t       replace_all;
+  uint8_t       hole_fill;                  //  Solve each hole on its own instead of the whole PFM (see hole_fill)
   uint8_t       clear_land;
+  int32_t       tile_size;                  //  Tile size (bins) for the tiled solve, 0 for a single grid
+  int32_t       tile_halo;                  //  Tile overlap on each side (bins)
+  double        tile_check;                 //  If > 0, compare the tiled surface to the single grid (batch only)
+  uint8_t       point_cache;                //  Save/reuse the ingested points in PFM_FILE.misp_cache
+  uint8_t       export_mask;                //  Surfaces (1 << surface) to export as grid files (see export_grid)
+  int32_t       reduce;                     //  Per bin reduction of the all depths points (see reduce_bin)
+  int32_t       reduce_cap;                 //  Bins with more valid soundings than this are reduced
+  int32_t       memory_budget;              //  Memory budget (MB) for the grids and MISP, 0 for no limit
+  double        warm_residual;              //  If > 0, warm start multigrid and stop at this residual (see warm_start)
   QString       input_dir;
   QFont         font;                       //  Font used for all ABE GUI applications
 } OPTIONS;
@@ -87,5 +103,30 @@ typedef struct
 } RUN_PROGRESS;
 
 
+/*  Normalized (bin unit) points for MISP, stored as separate x, y, and z arrays (see point_buffer).  Ingest fills one of
+    these per row band.  */
+
+typedef struct
+{
+  double              *x;                         //  x, y, and z are one block starting at x
+  double              *y;
+  double              *z;
+  int64_t             count;
+  int64_t             size;
+} POINT_BUFFER;
+
+
+/*  Progress hooks for misp_surface.  In the wizard mispWorker turns these into queued signals for the GUI thread,
+    batch mode points them at stdout.  */
+
+typedef struct
+{
+  void                (*phase) (QString title, int32_t range);   //  Start of a new phase (range of 0 just shows movement)
+  void                (*value) (int32_t value);                  //  Progress within the current phase
+  void                (*message) (QString info);                 //  Status message (including MISP progress info)
+  uint8_t             (*cancelled) ();                           //  Returns NVTrue if the run should stop (checked between rows)
+} RUN_CALLBACKS;
+
+
 
 #endif
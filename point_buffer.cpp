@@ -0,0 +1,177 @@
+
+/*********************************************************************************************
+
+    This is public domain software that was developed by or for the U.S. Naval Oceanographic
+    Office and/or the U.S. Army Corps of Engineers.
+
+    This is a work of the U.S. Government. In accordance with 17 USC 105, copyright protection
+    is not available for any work of the U.S. Government.
+
+    Neither the United States Government, nor any employees of the United States Government,
+    nor the author, makes any warranty, express or implied, without even the implied warranty
+    of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE, or assumes any liability or
+    responsibility for the accuracy, completeness, or usefulness of any information,
+    apparatus, product, or process disclosed, or represents that its use would not infringe
+    privately-owned rights. Reference herein to any specific commercial products, process,
+    or service by trade name, trademark, manufacturer, or otherwise, does not necessarily
+    constitute or imply its endorsement, recommendation, or favoring by the United States
+    Government. The views and opinions of authors expressed herein do not necessarily state
+    or reflect those of the United States Government, and shall not be used for advertising
+    or product endorsement purposes.
+*********************************************************************************************/
+
+
+/****************************************  IMPORTANT NOTE  **********************************
+
+    Comments in this file that start with / * ! or / / ! are being used by Doxygen to
+    document the software.  Dashes in these comment blocks are used to create bullet lists.
+    The lack of blank lines after a block of dash preceeded comments means that the next
+    block of dash preceeded comments is a new, indented bullet list.  I've tried to keep the
+    Doxygen formatting to a minimum but there are some other items (like <br> and <pre>)
+    that need to be left alone.  If you see a comment that starts with / * ! or / / ! and
+    there is something that looks a bit weird it is probably due to some arcane Doxygen
+    syntax.  Be very careful modifying blocks of Doxygen comments.
+
+*****************************************  IMPORTANT NOTE  **********************************/
+
+
+
+#include "point_buffer.hpp"
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+
+/*  Points are kept as structure of arrays (x, y, and z in one block of 3 * size doubles) so that the normalization and
+    the tile bucketing (which only need x and y) run straight down contiguous arrays.  The block layout also means a
+    buffer can point into a mapped point cache.  */
+
+
+//  Resizes the block to hold "size" points, keeping the first "count".
+
+void resize_points (POINT_BUFFER *buffer, int64_t size)
+{
+  double *block = (double *) malloc (3 * MAX (size, 1) * sizeof (double));
+
+  if (block == NULL)
+    {
+      perror ("Allocating point buffer");
+      exit (-1);
+    }
+
+  if (buffer->count)
+    {
+      memcpy (block, buffer->x, buffer->count * sizeof (double));
+      memcpy (block + size, buffer->y, buffer->count * sizeof (double));
+      memcpy (block + 2 * size, buffer->z, buffer->count * sizeof (double));
+    }
+
+  free (buffer->x);
+
+  buffer->x = block;
+  buffer->y = block + size;
+  buffer->z = block + 2 * size;
+  buffer->size = size;
+}
+
+
+
+//  Makes sure there's room for "count" more points in the buffer.
+
+void reserve_points (POINT_BUFFER *buffer, int64_t count)
+{
+  if (buffer->count + count > buffer->size)
+    resize_points (buffer, MAX (buffer->size ? buffer->size * 2 : 65536, buffer->count + count));
+}
+
+
+
+/*  Converts points start through count - 1 from PFM coordinates to bin units, two at a time with SSE2 when we have
+    it.  */
+
+void normalize_points (POINT_BUFFER *buffer, int64_t start, double x0, double y0, double x_scale, double y_scale)
+{
+  int64_t k = start;
+
+
+#ifdef __SSE2__
+  __m128d vx0 = _mm_set1_pd (x0), vy0 = _mm_set1_pd (y0);
+  __m128d vxs = _mm_set1_pd (x_scale), vys = _mm_set1_pd (y_scale);
+
+  for ( ; k + 2 <= buffer->count ; k += 2)
+    {
+      _mm_storeu_pd (&buffer->x[k], _mm_mul_pd (_mm_sub_pd (_mm_loadu_pd (&buffer->x[k]), vx0), vxs));
+      _mm_storeu_pd (&buffer->y[k], _mm_mul_pd (_mm_sub_pd (_mm_loadu_pd (&buffer->y[k]), vy0), vys));
+    }
+#endif
+
+  for ( ; k < buffer->count ; k++)
+    {
+      buffer->x[k] = (buffer->x[k] - x0) * x_scale;
+      buffer->y[k] = (buffer->y[k] - y0) * y_scale;
+    }
+}
+
+
+
+//  Adds the points in "chunk" to the end of "buffer".
+
+void append_points (POINT_BUFFER *buffer, POINT_BUFFER *chunk)
+{
+  if (!chunk->count) return;
+
+  reserve_points (buffer, chunk->count);
+
+  memcpy (&buffer->x[buffer->count], chunk->x, chunk->count * sizeof (double));
+  memcpy (&buffer->y[buffer->count], chunk->y, chunk->count * sizeof (double));
+  memcpy (&buffer->z[buffer->count], chunk->z, chunk->count * sizeof (double));
+
+  buffer->count += chunk->count;
+}
+
+
+
+void free_points (POINT_BUFFER *buffer)
+{
+  free (buffer->x);
+
+  buffer->x = buffer->y = buffer->z = NULL;
+  buffer->count = buffer->size = 0;
+}
+
+
+
+/*  Hands points to MISP.  libmisp only takes one point per call so this is the one place we build NV_F64_COORD3s.  If
+    index is NULL the first "count" points are loaded, otherwise the points index[0] through index[count - 1].  */
+
+void load_misp_points (POINT_BUFFER *points, int64_t *index, int64_t count)
+{
+  NV_F64_COORD3       xyz;
+
+
+  if (index == NULL)
+    {
+      for (int64_t k = 0 ; k < count ; k++)
+        {
+          xyz.x = points->x[k];
+          xyz.y = points->y[k];
+          xyz.z = points->z[k];
+
+          misp_load (xyz);
+        }
+    }
+  else
+    {
+      for (int64_t k = 0 ; k < count ; k++)
+        {
+          int64_t p = index[k];
+
+          xyz.x = points->x[p];
+          xyz.y = points->y[p];
+          xyz.z = points->z[p];
+
+          misp_load (xyz);
+        }
+    }
+}
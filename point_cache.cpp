@@ -0,0 +1,313 @@
+
+/*********************************************************************************************
+
+    This is public domain software that was developed by or for the U.S. Naval Oceanographic
+    Office and/or the U.S. Army Corps of Engineers.
+
+    This is a work of the U.S. Government. In accordance with 17 USC 105, copyright protection
+    is not available for any work of the U.S. Government.
+
+    Neither the United States Government, nor any employees of the United States Government,
+    nor the author, makes any warranty, express or implied, without even the implied warranty
+    of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE, or assumes any liability or
+    responsibility for the accuracy, completeness, or usefulness of any information,
+    apparatus, product, or process disclosed, or represents that its use would not infringe
+    privately-owned rights. Reference herein to any specific commercial products, process,
+    or service by trade name, trademark, manufacturer, or otherwise, does not necessarily
+    constitute or imply its endorsement, recommendation, or favoring by the United States
+    Government. The views and opinions of authors expressed herein do not necessarily state
+    or reflect those of the United States Government, and shall not be used for advertising
+    or product endorsement purposes.
+*********************************************************************************************/
+
+
+/****************************************  IMPORTANT NOTE  **********************************
+
+    Comments in this file that start with / * ! or / / ! are being used by Doxygen to
+    document the software.  Dashes in these comment blocks are used to create bullet lists.
+    The lack of blank lines after a block of dash preceeded comments means that the next
+    block of dash preceeded comments is a new, indented bullet list.  I've tried to keep the
+    Doxygen formatting to a minimum but there are some other items (like <br> and <pre>)
+    that need to be left alone.  If you see a comment that starts with / * ! or / / ! and
+    there is something that looks a bit weird it is probably due to some arcane Doxygen
+    syntax.  Be very careful modifying blocks of Doxygen comments.
+
+*****************************************  IMPORTANT NOTE  **********************************/
+
+
+
+#include "point_cache.hpp"
+#include "reduce_bin.hpp"
+
+
+/*  The point cache is a sidecar file next to the PFM list file (PFM_FILE.misp_cache) that holds the normalized points
+    that were loaded into MISP on the last run along with the bin raster planes that ingest builds.  It is only good for
+    the same surface type (and bin reduction for all depths) and only as long as the PFM files haven't been changed by anyone else.  The depth records
+    (index file) can't change without invalidating it.  We change the bin file ourselves when we write the surface so
+    after a successful run the cache is updated with the new bin raster and the new bin file time stamp.
+
+    Layout:  POINT_CACHE_HEADER, header.count x values, header.count y values, header.count z values (doubles), then the
+    four ingest planes of the bin raster.  */
+
+#define         POINT_CACHE_MAGIC       "PFMMISPPOINTS04"
+
+
+typedef struct
+{
+  char                magic[16];
+  int32_t             surface;
+  int32_t             reduce;                     //  Bin reduction method and cap (all depths only)
+  int32_t             reduce_cap;
+  int32_t             width;
+  int32_t             height;
+  int32_t             words;
+  int64_t             count;
+  int64_t             list_time;                  //  Modification times (ms since the epoch) and sizes of the PFM files
+  int64_t             bin_time;
+  int64_t             bin_size;
+  int64_t             index_time;
+  int64_t             index_size;
+  char                spare[40];                  //  Pad to 128 bytes so the points are nicely aligned
+} POINT_CACHE_HEADER;
+
+
+static const int32_t cache_planes[4] = {RASTER_DATA, RASTER_INTERPOLATED, RASTER_LAND, RASTER_SOUNDINGS};
+
+
+
+QString point_cache_name (PFM_OPEN_ARGS *open_args)
+{
+  return (QString (open_args->list_path) + ".misp_cache");
+}
+
+
+
+//  The bin reduction only changes the all depths points.
+
+static int32_t cache_reduce (OPTIONS *options)
+{
+  return ((options->surface == 2) ? options->reduce : REDUCE_NONE);
+}
+
+
+
+static int32_t cache_reduce_cap (OPTIONS *options)
+{
+  return ((options->surface == 2 && options->reduce != REDUCE_NONE) ? options->reduce_cap : 0);
+}
+
+
+
+//  Fills in the header for the current state of the PFM.
+
+static void stamp_header (PFM_OPEN_ARGS *open_args, POINT_CACHE_HEADER *header)
+{
+  QFileInfo list (QString (open_args->list_path));
+  QFileInfo bin (QString (open_args->bin_path));
+  QFileInfo index (QString (open_args->index_path));
+
+
+  memset (header, 0, sizeof (POINT_CACHE_HEADER));
+
+  strcpy (header->magic, POINT_CACHE_MAGIC);
+  header->width = open_args->head.bin_width;
+  header->height = open_args->head.bin_height;
+  header->words = (open_args->head.bin_width + 63) / 64;
+  header->list_time = list.lastModified ().toMSecsSinceEpoch ();
+  header->bin_time = bin.lastModified ().toMSecsSinceEpoch ();
+  header->bin_size = bin.size ();
+  header->index_time = index.lastModified ().toMSecsSinceEpoch ();
+  header->index_size = index.size ();
+}
+
+
+
+/***************************************************************************\
+*                                                                           *
+*   Module Name:        load_point_cache                                    *
+*                                                                           *
+*   Purpose:            Maps the point cache for the PFM and, if it is      *
+*                       still valid for this PFM and surface type, points   *
+*                       "points" at the cached points (in the mapping) and  *
+*                       copies the cached planes into the raster.           *
+*                                                                           *
+*   Arguments:          open_args       -   PFM open args                   *
+*                       options         -   run options                     *
+*                       cache           -   opened cache (close with        *
+*                                           close_point_cache when the      *
+*                                           points are no longer needed)    *
+*                       points          -   cached points                   *
+*                       raster          -   allocated bin raster            *
+*                                                                           *
+*   Returns:            NVTrue if the cache was loaded                      *
+*                                                                           *
+\***************************************************************************/
+
+uint8_t load_point_cache (PFM_OPEN_ARGS *open_args, OPTIONS *options, POINT_CACHE *cache, POINT_BUFFER *points,
+                          BIN_RASTER *raster)
+{
+  POINT_CACHE_HEADER  current, *header;
+
+
+  cache->file = NULL;
+  cache->map = NULL;
+
+
+  QFile *file = new QFile (point_cache_name (open_args));
+
+  if (!file->open (QIODevice::ReadOnly) || file->size () < (qint64) sizeof (POINT_CACHE_HEADER))
+    {
+      delete file;
+      return (NVFalse);
+    }
+
+  uchar *map = file->map (0, file->size ());
+
+  if (map == NULL)
+    {
+      delete file;
+      return (NVFalse);
+    }
+
+
+  header = (POINT_CACHE_HEADER *) map;
+
+  stamp_header (open_args, &current);
+
+  int64_t plane_size = (int64_t) header->words * header->height * sizeof (uint64_t);
+
+  if (strcmp (header->magic, current.magic) || header->surface != options->surface ||
+      header->reduce != cache_reduce (options) || header->reduce_cap != cache_reduce_cap (options) ||
+      header->width != current.width || header->height != current.height || header->words != current.words ||
+      header->list_time != current.list_time || header->bin_time != current.bin_time ||
+      header->bin_size != current.bin_size || header->index_time != current.index_time ||
+      header->index_size != current.index_size || header->count < 0 ||
+      file->size () != (qint64) (sizeof (POINT_CACHE_HEADER) + 3 * header->count * sizeof (double) + 4 * plane_size))
+    {
+      file->unmap (map);
+      delete file;
+      return (NVFalse);
+    }
+
+
+  points->x = (double *) (map + sizeof (POINT_CACHE_HEADER));
+  points->y = points->x + header->count;
+  points->z = points->y + header->count;
+  points->count = header->count;
+  points->size = header->count;
+
+
+  //  The planes get changed by the write back so they're copied out of the mapping.
+
+  uchar *plane = map + sizeof (POINT_CACHE_HEADER) + 3 * header->count * sizeof (double);
+
+  for (int32_t i = 0 ; i < 4 ; i++)
+    {
+      memcpy (raster->plane[cache_planes[i]], plane, plane_size);
+      plane += plane_size;
+    }
+
+
+  cache->file = file;
+  cache->map = map;
+
+  return (NVTrue);
+}
+
+
+
+void close_point_cache (POINT_CACHE *cache)
+{
+  if (cache->file == NULL) return;
+
+  cache->file->unmap (cache->map);
+  delete cache->file;
+
+  cache->file = NULL;
+  cache->map = NULL;
+}
+
+
+
+/*  Saves the points and raster from ingest.  This is done before anything is written to the PFM so, if the run doesn't
+    finish, the bin file time stamp won't match and the cache won't be used.  Failing to write the cache isn't an
+    error, the next run will just have to read the PFM again.  */
+
+void save_point_cache (PFM_OPEN_ARGS *open_args, OPTIONS *options, POINT_BUFFER *points, BIN_RASTER *raster)
+{
+  POINT_CACHE_HEADER  header;
+
+
+  stamp_header (open_args, &header);
+
+  header.surface = options->surface;
+  header.reduce = cache_reduce (options);
+  header.reduce_cap = cache_reduce_cap (options);
+  header.count = points->count;
+
+  int64_t plane_size = (int64_t) raster->words * raster->height * sizeof (uint64_t);
+
+
+  QFile file (point_cache_name (open_args));
+
+  if (!file.open (QIODevice::WriteOnly | QIODevice::Truncate)) return;
+
+  uint8_t ok = (file.write ((char *) &header, sizeof (POINT_CACHE_HEADER)) == (qint64) sizeof (POINT_CACHE_HEADER));
+
+  qint64 array_size = points->count * sizeof (double);
+
+  if (ok && points->count)
+    ok = (file.write ((char *) points->x, array_size) == array_size &&
+          file.write ((char *) points->y, array_size) == array_size &&
+          file.write ((char *) points->z, array_size) == array_size);
+
+  for (int32_t i = 0 ; ok && i < 4 ; i++)
+    ok = (file.write ((char *) raster->plane[cache_planes[i]], plane_size) == plane_size);
+
+  file.close ();
+
+  if (!ok) file.remove ();
+}
+
+
+
+/*  After the surface has been written we bring the cached raster planes and the bin file time stamp up to date so that
+    the next run can use the cache.  The PFM must be closed so that the time stamp is final.  */
+
+void update_point_cache (PFM_OPEN_ARGS *open_args, BIN_RASTER *raster)
+{
+  POINT_CACHE_HEADER  header, current;
+
+
+  QFile file (point_cache_name (open_args));
+
+  if (!file.open (QIODevice::ReadWrite)) return;
+
+  if (file.read ((char *) &header, sizeof (POINT_CACHE_HEADER)) != (qint64) sizeof (POINT_CACHE_HEADER) ||
+      strcmp (header.magic, POINT_CACHE_MAGIC))
+    {
+      file.close ();
+      file.remove ();
+      return;
+    }
+
+  int64_t plane_size = (int64_t) raster->words * raster->height * sizeof (uint64_t);
+
+  uint8_t ok = file.seek (sizeof (POINT_CACHE_HEADER) + 3 * header.count * sizeof (double));
+
+  for (int32_t i = 0 ; ok && i < 4 ; i++)
+    ok = (file.write ((char *) raster->plane[cache_planes[i]], plane_size) == plane_size);
+
+
+  stamp_header (open_args, &current);
+
+  header.bin_time = current.bin_time;
+  header.bin_size = current.bin_size;
+  header.list_time = current.list_time;
+
+  if (ok) ok = (file.seek (0) && file.write ((char *) &header, sizeof (POINT_CACHE_HEADER)) == (qint64) sizeof (POINT_CACHE_HEADER));
+
+  file.close ();
+
+  if (!ok) file.remove ();
+}
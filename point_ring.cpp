@@ -0,0 +1,153 @@
+
+/*********************************************************************************************
+
+    This is public domain software that was developed by or for the U.S. Naval Oceanographic
+    Office and/or the U.S. Army Corps of Engineers.
+
+    This is a work of the U.S. Government. In accordance with 17 USC 105, copyright protection
+    is not available for any work of the U.S. Government.
+
+    Neither the United States Government, nor any employees of the United States Government,
+    nor the author, makes any warranty, express or implied, without even the implied warranty
+    of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE, or assumes any liability or
+    responsibility for the accuracy, completeness, or usefulness of any information,
+    apparatus, product, or process disclosed, or represents that its use would not infringe
+    privately-owned rights. Reference herein to any specific commercial products, process,
+    or service by trade name, trademark, manufacturer, or otherwise, does not necessarily
+    constitute or imply its endorsement, recommendation, or favoring by the United States
+    Government. The views and opinions of authors expressed herein do not necessarily state
+    or reflect those of the United States Government, and shall not be used for advertising
+    or product endorsement purposes.
+*********************************************************************************************/
+
+
+/****************************************  IMPORTANT NOTE  **********************************
+
+    Comments in this file that start with / * ! or / / ! are being used by Doxygen to
+    document the software.  Dashes in these comment blocks are used to create bullet lists.
+    The lack of blank lines after a block of dash preceeded comments means that the next
+    block of dash preceeded comments is a new, indented bullet list.  I've tried to keep the
+    Doxygen formatting to a minimum but there are some other items (like <br> and <pre>)
+    that need to be left alone.  If you see a comment that starts with / * ! or / / ! and
+    there is something that looks a bit weird it is probably due to some arcane Doxygen
+    syntax.  Be very careful modifying blocks of Doxygen comments.
+
+*****************************************  IMPORTANT NOTE  **********************************/
+
+
+
+#include "point_ring.hpp"
+#include "point_buffer.hpp"
+
+
+POINT_RING *alloc_point_rings (int32_t count)
+{
+  POINT_RING *rings = new POINT_RING[count];
+
+  for (int32_t i = 0 ; i < count ; i++)
+    {
+      memset (rings[i].slot, 0, sizeof (rings[i].slot));
+
+      rings[i].head = 0;
+      rings[i].tail = 0;
+      rings[i].done = false;
+    }
+
+  return (rings);
+}
+
+
+
+/*  Producer side.  Returns the (empty) chunk to fill next, waiting for the consumer if all of the slots are in use.
+    Returns NULL if the run is cancelled while we're waiting.  A slot gets room for POINT_CHUNK_SIZE points the first
+    time it's used and keeps it (a chunk only goes over when the row that fills it is long) until the band is done.  */
+
+POINT_BUFFER *fill_point_ring (POINT_RING *ring, BAND_STATUS *status)
+{
+  int64_t head = ring->head;
+
+
+  ring->lock.lock ();
+
+  while (head - ring->tail >= POINT_RING_SLOTS)
+    {
+      if (status->cancel)
+        {
+          ring->lock.unlock ();
+          return (NULL);
+        }
+
+
+      //  The timeout is only there so we notice a cancel.
+
+      ring->released.wait (&ring->lock, 50);
+    }
+
+  ring->lock.unlock ();
+
+
+  POINT_BUFFER *chunk = &ring->slot[head % POINT_RING_SLOTS];
+
+  chunk->count = 0;
+
+  if (!chunk->size) resize_points (chunk, POINT_CHUNK_SIZE);
+
+  return (chunk);
+}
+
+
+
+
+//  Producer side.  Hands the chunk from fill_point_ring to the consumer.
+
+void publish_point_ring (POINT_RING *ring)
+{
+  ring->head++;
+}
+
+
+
+//  Producer side.  No more chunks are coming (set after the last publish so the consumer sees the final head).
+
+void finish_point_ring (POINT_RING *ring)
+{
+  ring->done = true;
+}
+
+
+
+//  Consumer side.  Returns the oldest published chunk or NULL if there isn't one yet.
+
+POINT_BUFFER *front_point_ring (POINT_RING *ring)
+{
+  int64_t tail = ring->tail;
+
+  if (tail >= ring->head) return (NULL);
+
+  return (&ring->slot[tail % POINT_RING_SLOTS]);
+}
+
+
+
+//  Consumer side.  Gives the chunk from front_point_ring back to the producer.
+
+void release_point_ring (POINT_RING *ring)
+{
+  QMutexLocker lock (&ring->lock);
+
+  ring->tail++;
+
+  ring->released.wakeOne ();
+}
+
+
+
+void free_point_rings (POINT_RING *rings, int32_t count)
+{
+  for (int32_t i = 0 ; i < count ; i++)
+    {
+      for (int32_t j = 0 ; j < POINT_RING_SLOTS ; j++) free_points (&rings[i].slot[j]);
+    }
+
+  delete[] rings;
+}
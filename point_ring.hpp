@@ -0,0 +1,79 @@
+
+/*********************************************************************************************
+
+    This is public domain software that was developed by or for the U.S. Naval Oceanographic
+    Office and/or the U.S. Army Corps of Engineers.
+
+    This is a work of the U.S. Government. In accordance with 17 USC 105, copyright protection
+    is not available for any work of the U.S. Government.
+
+    Neither the United States Government, nor any employees of the United States Government,
+    nor the author, makes any warranty, express or implied, without even the implied warranty
+    of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE, or assumes any liability or
+    responsibility for the accuracy, completeness, or usefulness of any information,
+    apparatus, product, or process disclosed, or represents that its use would not infringe
+    privately-owned rights. Reference herein to any specific commercial products, process,
+    or service by trade name, trademark, manufacturer, or otherwise, does not necessarily
+    constitute or imply its endorsement, recommendation, or favoring by the United States
+    Government. The views and opinions of authors expressed herein do not necessarily state
+    or reflect those of the United States Government, and shall not be used for advertising
+    or product endorsement purposes.
+*********************************************************************************************/
+
+
+/****************************************  IMPORTANT NOTE  **********************************
+
+    Comments in this file that start with / * ! or / / ! are being used by Doxygen to
+    document the software.  Dashes in these comment blocks are used to create bullet lists.
+    The lack of blank lines after a block of dash preceeded comments means that the next
+    block of dash preceeded comments is a new, indented bullet list.  I've tried to keep the
+    Doxygen formatting to a minimum but there are some other items (like <br> and <pre>)
+    that need to be left alone.  If you see a comment that starts with / * ! or / / ! and
+    there is something that looks a bit weird it is probably due to some arcane Doxygen
+    syntax.  Be very careful modifying blocks of Doxygen comments.
+
+*****************************************  IMPORTANT NOTE  **********************************/
+
+
+
+#ifndef POINT_RING_H
+#define POINT_RING_H
+
+#include "pfmMispDef.hpp"
+#include "run_bands.hpp"
+
+#include <atomic>
+
+
+/*  A bounded single producer, single consumer queue of point chunks between an ingest band (the producer) and the
+    thread that collects the points and feeds MISP (the consumer).  The chunks are reused so, once the ring is full,
+    the band waits for the consumer to catch up instead of piling up points.  head and tail only ever go up, the
+    producer owns slot[head % POINT_RING_SLOTS] until it publishes it and the consumer owns slot[tail %
+    POINT_RING_SLOTS] until it releases it.  A producer with no free slot sleeps on "released" instead of polling.
+    The rings have C++ members so they come from new[], not calloc.  */
+
+#define         POINT_RING_SLOTS        4
+#define         POINT_CHUNK_SIZE        16384
+
+
+typedef struct
+{
+  POINT_BUFFER          slot[POINT_RING_SLOTS];
+  std::atomic<int64_t>  head;                     //  Chunks published by the producer
+  std::atomic<int64_t>  tail;                     //  Chunks released by the consumer
+  std::atomic<bool>     done;                     //  The producer has published its last chunk
+  QMutex                lock;                     //  Guards the wait on released
+  QWaitCondition        released;                 //  Signalled when the consumer gives a chunk back
+} POINT_RING;
+
+
+POINT_RING *alloc_point_rings (int32_t count);
+POINT_BUFFER *fill_point_ring (POINT_RING *ring, BAND_STATUS *status);
+void publish_point_ring (POINT_RING *ring);
+void finish_point_ring (POINT_RING *ring);
+POINT_BUFFER *front_point_ring (POINT_RING *ring);
+void release_point_ring (POINT_RING *ring);
+void free_point_rings (POINT_RING *rings, int32_t count);
+
+
+#endif
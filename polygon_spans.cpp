@@ -0,0 +1,288 @@
+
+/*********************************************************************************************
+
+    This is public domain software that was developed by or for the U.S. Naval Oceanographic
+    Office and/or the U.S. Army Corps of Engineers.
+
+    This is a work of the U.S. Government. In accordance with 17 USC 105, copyright protection
+    is not available for any work of the U.S. Government.
+
+    Neither the United States Government, nor any employees of the United States Government,
+    nor the author, makes any warranty, express or implied, without even the implied warranty
+    of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE, or assumes any liability or
+    responsibility for the accuracy, completeness, or usefulness of any information,
+    apparatus, product, or process disclosed, or represents that its use would not infringe
+    privately-owned rights. Reference herein to any specific commercial products, process,
+    or service by trade name, trademark, manufacturer, or otherwise, does not necessarily
+    constitute or imply its endorsement, recommendation, or favoring by the United States
+    Government. The views and opinions of authors expressed herein do not necessarily state
+    or reflect those of the United States Government, and shall not be used for advertising
+    or product endorsement purposes.
+*********************************************************************************************/
+
+
+/****************************************  IMPORTANT NOTE  **********************************
+
+    Comments in this file that start with / * ! or / / ! are being used by Doxygen to
+    document the software.  Dashes in these comment blocks are used to create bullet lists.
+    The lack of blank lines after a block of dash preceeded comments means that the next
+    block of dash preceeded comments is a new, indented bullet list.  I've tried to keep the
+    Doxygen formatting to a minimum but there are some other items (like <br> and <pre>)
+    that need to be left alone.  If you see a comment that starts with / * ! or / / ! and
+    there is something that looks a bit weird it is probably due to some arcane Doxygen
+    syntax.  Be very careful modifying blocks of Doxygen comments.
+
+*****************************************  IMPORTANT NOTE  **********************************/
+
+
+
+#include "polygon_spans.hpp"
+
+
+static int compare_doubles (const void *a, const void *b)
+{
+  double da = *((double *) a), db = *((double *) b);
+
+  return ((da > db) - (da < db));
+}
+
+
+
+//  Same test (and same bin corner) that the write back used to make for every bin.
+
+static uint8_t inside (BIN_HEADER *head, int32_t i, int32_t j)
+{
+  NV_F64_COORD2       xy;
+
+
+  xy.x = head->mbr.min_x + j * head->x_bin_size_degrees;
+  xy.y = head->mbr.min_y + i * head->y_bin_size_degrees;
+
+  return (bin_inside_ptr (head, xy));
+}
+
+
+
+static int compare_ints (const void *a, const void *b)
+{
+  int32_t ia = *((int32_t *) a), ib = *((int32_t *) b);
+
+  return ((ia > ib) - (ia < ib));
+}
+
+
+
+//  Adds a span to row "row" (spans have to be added left to right), merging it with the last one if they touch.
+
+static void add_span (POLYGON_SPANS *polygon, int32_t *size, int32_t row, int32_t start, int32_t end)
+{
+  int32_t count = polygon->first[row + 1];
+
+
+  if (start > end) return;
+
+  if (count > polygon->first[row] && start <= polygon->spans[count - 1].end + 1)
+    {
+      polygon->spans[count - 1].end = MAX (end, polygon->spans[count - 1].end);
+      return;
+    }
+
+  if (count == *size)
+    {
+      *size *= 2;
+      polygon->spans = (BIN_SPAN *) realloc (polygon->spans, *size * sizeof (BIN_SPAN));
+
+      if (polygon->spans == NULL)
+        {
+          perror ("Allocating polygon spans");
+          exit (-1);
+        }
+    }
+
+  polygon->spans[count].start = start;
+  polygon->spans[count].end = end;
+  polygon->first[row + 1]++;
+}
+
+
+
+/***************************************************************************\
+*                                                                           *
+*   Module Name:        build_polygon_spans                                 *
+*                                                                           *
+*   Purpose:            Scanline fill of the PFM polygon.  For each row we  *
+*                       find where the polygon edges cross the row, sort    *
+*                       the crossings, and turn each pair into a span of    *
+*                       bins.  The bins at the ends of the spans get a      *
+*                       bin_inside_ptr check, and so does every bin within  *
+*                       one bin of a polygon vertex, since that's where the *
+*                       crossings can't be trusted (edges that meet at a    *
+*                       concave vertex, double back, or run along the row). *
+*                       The result matches the per bin check (edges that go *
+*                       right through a bin corner are up to the library    *
+*                       and the inside of a self intersecting polygon is    *
+*                       even-odd).  pfmMispBench --verify checks this       *
+*                       against bin_inside_ptr on random polygons.          *
+*                                                                           *
+*   Arguments:          head            -   PFM header                      *
+*                       polygon         -   returned spans                  *
+*                                                                           *
+\***************************************************************************/
+
+void build_polygon_spans (BIN_HEADER *head, POLYGON_SPANS *polygon)
+{
+  double              *cross;
+  int32_t             *probe, size, ncross, nprobe, nrow;
+  uint8_t             *mark;
+  BIN_SPAN            *row;
+
+
+  polygon->height = head->bin_height;
+
+  polygon->first = (int32_t *) malloc ((head->bin_height + 1) * sizeof (int32_t));
+  cross = (double *) malloc ((head->polygon_count + 1) * sizeof (double));
+  probe = (int32_t *) malloc ((3 * head->polygon_count + 1) * sizeof (int32_t));
+  row = (BIN_SPAN *) malloc ((head->polygon_count / 2 + 1) * sizeof (BIN_SPAN));
+  mark = (uint8_t *) malloc (head->bin_width);
+
+  size = head->bin_height + 16;
+  polygon->spans = (BIN_SPAN *) malloc (size * sizeof (BIN_SPAN));
+
+  if (polygon->first == NULL || cross == NULL || probe == NULL || row == NULL || mark == NULL ||
+      polygon->spans == NULL)
+    {
+      perror ("Allocating polygon spans");
+      exit (-1);
+    }
+
+
+  polygon->first[0] = 0;
+
+  for (int32_t i = 0 ; i < head->bin_height ; i++)
+    {
+      polygon->first[i + 1] = polygon->first[i];
+
+      double y = head->mbr.min_y + i * head->y_bin_size_degrees;
+
+
+      //  Where do the edges cross this row?
+
+      ncross = 0;
+
+      for (int32_t k = 0 ; k < head->polygon_count ; k++)
+        {
+          NV_F64_COORD2 p = head->polygon[k];
+          NV_F64_COORD2 q = head->polygon[(k + 1) % head->polygon_count];
+
+          if ((p.y <= y) != (q.y <= y)) cross[ncross++] = p.x + (y - p.y) * (q.x - p.x) / (q.y - p.y);
+        }
+
+      qsort (cross, ncross, sizeof (double), compare_doubles);
+
+
+      nrow = 0;
+
+      for (int32_t k = 0 ; k + 1 < ncross ; k += 2)
+        {
+          int32_t start = MAX (0, (int32_t) ceil ((cross[k] - head->mbr.min_x) / head->x_bin_size_degrees));
+          int32_t end = MIN (head->bin_width - 1, (int32_t) floor ((cross[k + 1] - head->mbr.min_x) /
+                                                                     head->x_bin_size_degrees));
+
+
+          //  Fix up the ends with the real test.
+
+          while (start <= end && !inside (head, i, start)) start++;
+          while (start > 0 && inside (head, i, start - 1)) start--;
+
+          while (end >= start && !inside (head, i, end)) end--;
+          while (end >= start && end < head->bin_width - 1 && inside (head, i, end + 1)) end++;
+
+          if (start > end) continue;
+
+          row[nrow].start = start;
+          row[nrow].end = end;
+          nrow++;
+        }
+
+
+      //  The bins within one bin of a vertex.
+
+      nprobe = 0;
+
+      for (int32_t k = 0 ; k < head->polygon_count ; k++)
+        {
+          NV_F64_COORD2 v = head->polygon[k];
+
+          if (fabs (v.y - y) > head->y_bin_size_degrees) continue;
+
+          double column = (v.x - head->mbr.min_x) / head->x_bin_size_degrees;
+
+          for (int32_t j = MAX ((int32_t) ceil (column - 1.0), 0) ;
+               j <= MIN ((int32_t) floor (column + 1.0), head->bin_width - 1) ; j++) probe[nprobe++] = j;
+        }
+
+
+      if (!nprobe)
+        {
+          for (int32_t k = 0 ; k < nrow ; k++) add_span (polygon, &size, i, row[k].start, row[k].end);
+          continue;
+        }
+
+
+      /*  Between the first and last of those bins the spans are redone from a row of inside flags, the spans as
+          they are everywhere else with the vertex bins set by the real test.  */
+
+      qsort (probe, nprobe, sizeof (int32_t), compare_ints);
+
+      int32_t lo = probe[0], hi = probe[nprobe - 1];
+
+      memset (&mark[lo], 0, hi - lo + 1);
+
+      for (int32_t k = 0 ; k < nrow ; k++)
+        {
+          for (int32_t j = MAX (row[k].start, lo) ; j <= MIN (row[k].end, hi) ; j++) mark[j] = 1;
+        }
+
+      for (int32_t k = 0 ; k < nprobe ; k++)
+        {
+          if (k && probe[k] == probe[k - 1]) continue;
+
+          mark[probe[k]] = inside (head, i, probe[k]);
+        }
+
+      for (int32_t k = 0 ; k < nrow ; k++)
+        {
+          if (row[k].start < lo) add_span (polygon, &size, i, row[k].start, MIN (row[k].end, lo - 1));
+        }
+
+      for (int32_t j = lo ; j <= hi ; j++)
+        {
+          if (!mark[j]) continue;
+
+          int32_t start = j;
+
+          while (j < hi && mark[j + 1]) j++;
+
+          add_span (polygon, &size, i, start, j);
+        }
+
+      for (int32_t k = 0 ; k < nrow ; k++)
+        {
+          if (row[k].end > hi) add_span (polygon, &size, i, MAX (row[k].start, hi + 1), row[k].end);
+        }
+    }
+
+
+  free (mark);
+  free (row);
+  free (probe);
+  free (cross);
+}
+
+
+
+void free_polygon_spans (POLYGON_SPANS *polygon)
+{
+  free (polygon->first);
+  free (polygon->spans);
+}
@@ -0,0 +1,176 @@
+
+/*********************************************************************************************
+
+    This is public domain software that was developed by or for the U.S. Naval Oceanographic
+    Office and/or the U.S. Army Corps of Engineers.
+
+    This is a work of the U.S. Government. In accordance with 17 USC 105, copyright protection
+    is not available for any work of the U.S. Government.
+
+    Neither the United States Government, nor any employees of the United States Government,
+    nor the author, makes any warranty, express or implied, without even the implied warranty
+    of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE, or assumes any liability or
+    responsibility for the accuracy, completeness, or usefulness of any information,
+    apparatus, product, or process disclosed, or represents that its use would not infringe
+    privately-owned rights. Reference herein to any specific commercial products, process,
+    or service by trade name, trademark, manufacturer, or otherwise, does not necessarily
+    constitute or imply its endorsement, recommendation, or favoring by the United States
+    Government. The views and opinions of authors expressed herein do not necessarily state
+    or reflect those of the United States Government, and shall not be used for advertising
+    or product endorsement purposes.
+*********************************************************************************************/
+
+
+/****************************************  IMPORTANT NOTE  **********************************
+
+    Comments in this file that start with / * ! or / / ! are being used by Doxygen to
+    document the software.  Dashes in these comment blocks are used to create bullet lists.
+    The lack of blank lines after a block of dash preceeded comments means that the next
+    block of dash preceeded comments is a new, indented bullet list.  I've tried to keep the
+    Doxygen formatting to a minimum but there are some other items (like <br> and <pre>)
+    that need to be left alone.  If you see a comment that starts with / * ! or / / ! and
+    there is something that looks a bit weird it is probably due to some arcane Doxygen
+    syntax.  Be very careful modifying blocks of Doxygen comments.
+
+*****************************************  IMPORTANT NOTE  **********************************/
+
+
+
+#include "reduce_bin.hpp"
+
+#include <algorithm>
+
+
+/***************************************************************************\
+*                                                                           *
+*   Module Name:        reduce_bin                                          *
+*                                                                           *
+*   Purpose:            Collapses the valid soundings of one bin, which     *
+*                       ingest has just added to the end of the buffer      *
+*                       (points start through count - 1, still in PFM      *
+*                       coordinates), to a few representative points.  The  *
+*                       reduced points replace them in place so no scratch  *
+*                       space is needed.                                    *
+*                                                                           *
+*   Arguments:          buffer          -   point buffer                    *
+*                       start           -   first point of the bin          *
+*                       method          -   REDUCE_MEAN, REDUCE_MEDIAN,     *
+*                                           REDUCE_TRIMMED, or              *
+*                                           REDUCE_STRATIFIED               *
+*                       cap             -   bins with this many points or   *
+*                                           fewer are left alone            *
+*                       x0, y0          -   PFM MBR southwest corner        *
+*                       x_scale,        -   reciprocal bin sizes (for the   *
+*                       y_scale             strata)                         *
+*                                                                           *
+*   Returns:            Number of points removed                            *
+*                                                                           *
+\***************************************************************************/
+
+int64_t reduce_bin (POINT_BUFFER *buffer, int64_t start, int32_t method, int32_t cap, double x0, double y0,
+                    double x_scale, double y_scale)
+{
+  double              sum_x = 0.0, sum_y = 0.0, sum_z = 0.0, z;
+  int64_t             n = buffer->count - start;
+
+
+  if (method == REDUCE_NONE || n <= cap) return (0);
+
+
+  double *x = &buffer->x[start];
+  double *y = &buffer->y[start];
+  double *depth = &buffer->z[start];
+
+
+  if (method == REDUCE_STRATIFIED)
+    {
+      double              cell_x[REDUCE_MAX_CAP], cell_y[REDUCE_MAX_CAP], cell_z[REDUCE_MAX_CAP];
+      int32_t             cell_count[REDUCE_MAX_CAP];
+
+
+      int32_t side = MAX (1, (int32_t) sqrt ((double) cap));
+      int32_t cells = side * side;
+
+      for (int32_t c = 0 ; c < cells ; c++)
+        {
+          cell_x[c] = cell_y[c] = cell_z[c] = 0.0;
+          cell_count[c] = 0;
+        }
+
+
+      //  Which cell of the bin each point falls in (the fractional part of its bin unit position).
+
+      for (int64_t k = 0 ; k < n ; k++)
+        {
+          double bx = (x[k] - x0) * x_scale;
+          double by = (y[k] - y0) * y_scale;
+
+          int32_t cx = MIN (MAX ((int32_t) ((bx - floor (bx)) * side), 0), side - 1);
+          int32_t cy = MIN (MAX ((int32_t) ((by - floor (by)) * side), 0), side - 1);
+          int32_t c = cy * side + cx;
+
+          cell_x[c] += x[k];
+          cell_y[c] += y[k];
+          cell_z[c] += depth[k];
+          cell_count[c]++;
+        }
+
+
+      int64_t m = 0;
+
+      for (int32_t c = 0 ; c < cells ; c++)
+        {
+          if (!cell_count[c]) continue;
+
+          x[m] = cell_x[c] / (double) cell_count[c];
+          y[m] = cell_y[c] / (double) cell_count[c];
+          depth[m] = cell_z[c] / (double) cell_count[c];
+          m++;
+        }
+
+      buffer->count = start + m;
+
+      return (n - m);
+    }
+
+
+  for (int64_t k = 0 ; k < n ; k++)
+    {
+      sum_x += x[k];
+      sum_y += y[k];
+      sum_z += depth[k];
+    }
+
+  switch (method)
+    {
+    case REDUCE_MEDIAN:
+      std::nth_element (depth, depth + n / 2, depth + n);
+      z = depth[n / 2];
+      break;
+
+    case REDUCE_TRIMMED:
+      {
+        std::sort (depth, depth + n);
+
+        int64_t trim = (int64_t) (n * REDUCE_TRIM);
+
+        z = 0.0;
+        for (int64_t k = trim ; k < n - trim ; k++) z += depth[k];
+        z /= (double) (n - 2 * trim);
+      }
+      break;
+
+    default:
+      z = sum_z / (double) n;
+      break;
+    }
+
+  x[0] = sum_x / (double) n;
+  y[0] = sum_y / (double) n;
+  depth[0] = z;
+
+  buffer->count = start + 1;
+
+
+  return (n - 1);
+}
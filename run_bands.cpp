@@ -0,0 +1,181 @@
+
+/*********************************************************************************************
+
+    This is public domain software that was developed by or for the U.S. Naval Oceanographic
+    Office and/or the U.S. Army Corps of Engineers.
+
+    This is a work of the U.S. Government. In accordance with 17 USC 105, copyright protection
+    is not available for any work of the U.S. Government.
+
+    Neither the United States Government, nor any employees of the United States Government,
+    nor the author, makes any warranty, express or implied, without even the implied warranty
+    of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE, or assumes any liability or
+    responsibility for the accuracy, completeness, or usefulness of any information,
+    apparatus, product, or process disclosed, or represents that its use would not infringe
+    privately-owned rights. Reference herein to any specific commercial products, process,
+    or service by trade name, trademark, manufacturer, or otherwise, does not necessarily
+    constitute or imply its endorsement, recommendation, or favoring by the United States
+    Government. The views and opinions of authors expressed herein do not necessarily state
+    or reflect those of the United States Government, and shall not be used for advertising
+    or product endorsement purposes.
+*********************************************************************************************/
+
+
+/****************************************  IMPORTANT NOTE  **********************************
+
+    Comments in this file that start with / * ! or / / ! are being used by Doxygen to
+    document the software.  Dashes in these comment blocks are used to create bullet lists.
+    The lack of blank lines after a block of dash preceeded comments means that the next
+    block of dash preceeded comments is a new, indented bullet list.  I've tried to keep the
+    Doxygen formatting to a minimum but there are some other items (like <br> and <pre>)
+    that need to be left alone.  If you see a comment that starts with / * ! or / / ! and
+    there is something that looks a bit weird it is probably due to some arcane Doxygen
+    syntax.  Be very careful modifying blocks of Doxygen comments.
+
+*****************************************  IMPORTANT NOTE  **********************************/
+
+
+
+#include "run_bands.hpp"
+
+
+class bandJob : public QRunnable
+{
+public:
+
+  bandJob (BAND_FUNCTION f, int32_t b, int32_t s, int32_t e, void *d)
+  {
+    func = f;
+    band = b;
+    start_row = s;
+    end_row = e;
+    data = d;
+  }
+
+  void run ()
+  {
+    func (band, start_row, end_row, data);
+  }
+
+
+protected:
+
+  BAND_FUNCTION    func;
+
+  int32_t          band, start_row, end_row;
+
+  void             *data;
+};
+
+
+
+/*  Number of row bands to split "rows" rows into.  We use more bands than threads so that a band full of dense data
+    doesn't leave the rest of the threads sitting idle at the end.  */
+
+int32_t band_count (int32_t rows)
+{
+  int32_t bands = QThread::idealThreadCount () * 4;
+
+  return (MAX (1, MIN (bands, rows)));
+}
+
+
+
+/***************************************************************************\
+*                                                                           *
+*   Module Name:        run_band_split                                      *
+*                                                                           *
+*   Purpose:            Runs func on each of the row bands split[band] to   *
+*                       split[band + 1] - 1 in a thread pool.  The calling  *
+*                       thread reports progress (status->rows_done) and     *
+*                       passes cancel requests on to the bands until        *
+*                       they're all done.  If consume isn't NULL the        *
+*                       calling thread runs it in between (and until it     *
+*                       has nothing left to do after the bands finish) so   *
+*                       the bands can hand their results off as they go.    *
+*                                                                           *
+*   Returns:            NVTrue if the run was cancelled                     *
+*                                                                           *
+\***************************************************************************/
+
+uint8_t run_band_split (int32_t bands, int32_t *split, BAND_FUNCTION func, BAND_CONSUMER consume, void *data,
+                        BAND_STATUS *status, RUN_CALLBACKS *callbacks)
+{
+  QThreadPool         pool;
+  QElapsedTimer       timer;
+
+
+  status->rows_done = 0;
+  status->cancel = false;
+
+  pool.setMaxThreadCount (QThread::idealThreadCount ());
+
+
+  for (int32_t band = 0 ; band < bands ; band++)
+    {
+      bandJob *job = new bandJob (func, band, split[band], split[band + 1], data);
+      job->setAutoDelete (true);
+
+      pool.start (job);
+    }
+
+
+  timer.start ();
+
+  while (NVTrue)
+    {
+      uint8_t busy = consume ? consume (data) : NVFalse;
+
+
+      /*  The consumer polls.  A chunk can sit for up to a millisecond before it's picked up but that's a small part
+          of the time it takes a band to read one, and the bands only stall if all of their slots are full.  */
+
+      if (pool.waitForDone (busy ? 0 : (consume ? 1 : 100))) break;
+
+      if (timer.hasExpired (100))
+        {
+          callbacks->value (status->rows_done);
+
+          if (callbacks->cancelled ()) status->cancel = true;
+
+          timer.restart ();
+        }
+    }
+
+  if (consume) while (consume (data));
+
+  if (callbacks->cancelled ()) status->cancel = true;
+
+  callbacks->value (status->rows_done);
+
+
+  return (status->cancel ? NVTrue : NVFalse);
+}
+
+
+
+//  Splits rows 0 to rows - 1 into "bands" contiguous row bands of (about) the same size and runs them.
+
+uint8_t run_bands (int32_t rows, int32_t bands, BAND_FUNCTION func, void *data, BAND_STATUS *status,
+                   RUN_CALLBACKS *callbacks)
+{
+  int32_t             *split;
+  uint8_t             cancelled;
+
+
+  split = (int32_t *) malloc ((bands + 1) * sizeof (int32_t));
+
+  if (split == NULL)
+    {
+      perror ("Allocating row bands");
+      exit (-1);
+    }
+
+  for (int32_t band = 0 ; band <= bands ; band++) split[band] = (int32_t) (((int64_t) rows * band) / bands);
+
+  cancelled = run_band_split (bands, split, func, NULL, data, status, callbacks);
+
+  free (split);
+
+  return (cancelled);
+}
@@ -0,0 +1,72 @@
+
+/*********************************************************************************************
+
+    This is public domain software that was developed by or for the U.S. Naval Oceanographic
+    Office and/or the U.S. Army Corps of Engineers.
+
+    This is a work of the U.S. Government. In accordance with 17 USC 105, copyright protection
+    is not available for any work of the U.S. Government.
+
+    Neither the United States Government, nor any employees of the United States Government,
+    nor the author, makes any warranty, express or implied, without even the implied warranty
+    of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE, or assumes any liability or
+    responsibility for the accuracy, completeness, or usefulness of any information,
+    apparatus, product, or process disclosed, or represents that its use would not infringe
+    privately-owned rights. Reference herein to any specific commercial products, process,
+    or service by trade name, trademark, manufacturer, or otherwise, does not necessarily
+    constitute or imply its endorsement, recommendation, or favoring by the United States
+    Government. The views and opinions of authors expressed herein do not necessarily state
+    or reflect those of the United States Government, and shall not be used for advertising
+    or product endorsement purposes.
+*********************************************************************************************/
+
+
+/****************************************  IMPORTANT NOTE  **********************************
+
+    Comments in this file that start with / * ! or / / ! are being used by Doxygen to
+    document the software.  Dashes in these comment blocks are used to create bullet lists.
+    The lack of blank lines after a block of dash preceeded comments means that the next
+    block of dash preceeded comments is a new, indented bullet list.  I've tried to keep the
+    Doxygen formatting to a minimum but there are some other items (like <br> and <pre>)
+    that need to be left alone.  If you see a comment that starts with / * ! or / / ! and
+    there is something that looks a bit weird it is probably due to some arcane Doxygen
+    syntax.  Be very careful modifying blocks of Doxygen comments.
+
+*****************************************  IMPORTANT NOTE  **********************************/
+
+
+
+#ifndef RUN_BANDS_H
+#define RUN_BANDS_H
+
+#include "pfmMispDef.hpp"
+
+#include <atomic>
+
+
+/*  Shared state for the row band threads.  Each band adds to rows_done as it finishes a row and checks cancel between
+    rows.  */
+
+typedef struct
+{
+  std::atomic<int32_t>  rows_done;
+  std::atomic<bool>     cancel;
+} BAND_STATUS;
+
+
+typedef void (*BAND_FUNCTION) (int32_t band, int32_t start_row, int32_t end_row, void *data);
+
+
+//  Optional work done by the calling thread while the bands run.  Returns NVTrue if it found something to do.
+
+typedef uint8_t (*BAND_CONSUMER) (void *data);
+
+
+int32_t band_count (int32_t rows);
+uint8_t run_bands (int32_t rows, int32_t bands, BAND_FUNCTION func, void *data, BAND_STATUS *status,
+                   RUN_CALLBACKS *callbacks);
+uint8_t run_band_split (int32_t bands, int32_t *split, BAND_FUNCTION func, BAND_CONSUMER consume, void *data,
+                        BAND_STATUS *status, RUN_CALLBACKS *callbacks);
+
+
+#endif
@@ -0,0 +1,254 @@
+
+/*********************************************************************************************
+
+    This is public domain software that was developed by or for the U.S. Naval Oceanographic
+    Office and/or the U.S. Army Corps of Engineers.
+
+    This is a work of the U.S. Government. In accordance with 17 USC 105, copyright protection
+    is not available for any work of the U.S. Government.
+
+    Neither the United States Government, nor any employees of the United States Government,
+    nor the author, makes any warranty, express or implied, without even the implied warranty
+    of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE, or assumes any liability or
+    responsibility for the accuracy, completeness, or usefulness of any information,
+    apparatus, product, or process disclosed, or represents that its use would not infringe
+    privately-owned rights. Reference herein to any specific commercial products, process,
+    or service by trade name, trademark, manufacturer, or otherwise, does not necessarily
+    constitute or imply its endorsement, recommendation, or favoring by the United States
+    Government. The views and opinions of authors expressed herein do not necessarily state
+    or reflect those of the United States Government, and shall not be used for advertising
+    or product endorsement purposes.
+*********************************************************************************************/
+
+
+/****************************************  IMPORTANT NOTE  **********************************
+
+    Comments in this file that start with / * ! or / / ! are being used by Doxygen to
+    document the software.  Dashes in these comment blocks are used to create bullet lists.
+    The lack of blank lines after a block of dash preceeded comments means that the next
+    block of dash preceeded comments is a new, indented bullet list.  I've tried to keep the
+    Doxygen formatting to a minimum but there are some other items (like <br> and <pre>)
+    that need to be left alone.  If you see a comment that starts with / * ! or / / ! and
+    there is something that looks a bit weird it is probably due to some arcane Doxygen
+    syntax.  Be very careful modifying blocks of Doxygen comments.
+
+*****************************************  IMPORTANT NOTE  **********************************/
+
+
+
+#include "run_stats.hpp"
+#include "version.hpp"
+#include "surface_engine.hpp"
+
+#include <errno.h>
+
+#ifdef NVLinux
+#include <sys/resource.h>
+#endif
+
+
+//  CPU time used so far (seconds), including any forked tile solves that have been waited for.
+
+static double cpu_seconds ()
+{
+#ifdef NVLinux
+  struct rusage       self, children;
+
+  getrusage (RUSAGE_SELF, &self);
+  getrusage (RUSAGE_CHILDREN, &children);
+
+  return ((double) (self.ru_utime.tv_sec + self.ru_stime.tv_sec + children.ru_utime.tv_sec + children.ru_stime.tv_sec) +
+          (double) (self.ru_utime.tv_usec + self.ru_stime.tv_usec + children.ru_utime.tv_usec +
+                    children.ru_stime.tv_usec) / 1000000.0);
+#else
+  return ((double) clock () / (double) CLOCKS_PER_SEC);
+#endif
+}
+
+
+
+//  Peak resident set size (KB).  We don't know how to get it anywhere but Linux so it is 0 elsewhere.
+
+static int64_t peak_rss ()
+{
+#ifdef NVLinux
+  struct rusage       self;
+
+  getrusage (RUSAGE_SELF, &self);
+
+  return ((int64_t) self.ru_maxrss);
+#else
+  return (0);
+#endif
+}
+
+
+
+void init_run_stats (RUN_STATS *stats)
+{
+  stats->count = 0;
+  stats->capped = 0;
+  stats->run_timer.start ();
+}
+
+
+
+/*  Starts timing a new phase (ending the current one if there is one) and returns it so the caller can fill in the
+    counters.  */
+
+PHASE_STATS *start_phase_stats (RUN_STATS *stats, const char *name)
+{
+  PHASE_STATS         *phase;
+
+
+  end_phase_stats (stats);
+
+
+  /*  The last slot is kept for "other".  If we ever run out of slots the rest of the phases are all timed into it so
+      their time still shows up and none of the named phases are overwritten.  */
+
+  if (stats->count >= MAX_RUN_PHASES - 1)
+    {
+      phase = &stats->phase[MAX_RUN_PHASES - 1];
+
+      if (stats->count == MAX_RUN_PHASES - 1)
+        {
+          memset (phase, 0, sizeof (PHASE_STATS));
+          strcpy (phase->name, "other");
+
+          stats->count++;
+        }
+
+      stats->wall_base = phase->wall;
+      stats->cpu_base = phase->cpu;
+    }
+  else
+    {
+      phase = &stats->phase[stats->count];
+
+      memset (phase, 0, sizeof (PHASE_STATS));
+      strncpy (phase->name, name, sizeof (phase->name) - 1);
+
+      stats->wall_base = 0.0;
+      stats->cpu_base = 0.0;
+
+      stats->count++;
+    }
+
+  phase->wall = -1.0;
+
+  stats->cpu_start = cpu_seconds ();
+  stats->timer.start ();
+
+  return (phase);
+}
+
+
+
+void end_phase_stats (RUN_STATS *stats)
+{
+  if (!stats->count) return;
+
+  PHASE_STATS *phase = &stats->phase[stats->count - 1];
+
+  if (phase->wall >= 0.0) return;
+
+  phase->wall = stats->wall_base + (double) stats->timer.elapsed () / 1000.0;
+  phase->cpu = stats->cpu_base + cpu_seconds () - stats->cpu_start;
+  phase->peak_rss = peak_rss ();
+}
+
+
+
+/***************************************************************************\
+*                                                                           *
+*   Module Name:        report_run_stats                                    *
+*                                                                           *
+*   Purpose:            Ends the current phase, writes the run report       *
+*                       (PFM_FILE.misp_report.json) next to the PFM list    *
+*                       file and sends a one line summary of each phase     *
+*                       to the message callback (the run page list in the   *
+*                       wizard).                                            *
+*                                                                           *
+*   Arguments:          stats           -   run statistics                  *
+*                       pfm_file_name   -   PFM list or handle file         *
+*                       options         -   run options                     *
+*                       status          -   misp_surface return status      *
+*                       callbacks       -   progress hooks                  *
+*                                                                           *
+\***************************************************************************/
+
+void report_run_stats (RUN_STATS *stats, QString pfm_file_name, OPTIONS *options, int32_t status,
+                       RUN_CALLBACKS *callbacks)
+{
+  FILE                *fp;
+  char                report_name[1024];
+
+
+  end_phase_stats (stats);
+
+
+  double total = (double) stats->run_timer.elapsed () / 1000.0;
+
+  callbacks->message (QCoreApplication::translate ("pfmMisp", "Run time : %1 seconds").arg (total, 0, 'f', 2));
+
+  for (int32_t i = 0 ; i < stats->count ; i++)
+    {
+      PHASE_STATS *phase = &stats->phase[i];
+
+      callbacks->message (QCoreApplication::translate ("pfmMisp", "  %1 : %2 s wall, %3 s CPU, %4 bins read, %5 bins written").
+                          arg (phase->name).arg (phase->wall, 0, 'f', 2).arg (phase->cpu, 0, 'f', 2).
+                          arg ((qlonglong) phase->bins_visited).arg ((qlonglong) phase->bins_written));
+    }
+
+  if (stats->capped)
+    callbacks->message (QCoreApplication::translate ("pfmMisp", "  %1 multigrid solves stopped at the V-cycle limit "
+                                                     "before converging").arg ((qlonglong) stats->capped));
+
+
+  //  JSON by hand since we still build with Qt 4 in places.
+
+  snprintf (report_name, sizeof (report_name), "%s.misp_report.json", pfm_file_name.toLatin1 ().data ());
+
+  if ((fp = fopen (report_name, "w")) == NULL)
+    {
+      callbacks->message (QCoreApplication::translate ("pfmMisp", "Unable to write run report %1 : %2").
+                          arg (report_name).arg (strerror (errno)));
+      return;
+    }
+
+  fprintf (fp, "{\n");
+  fprintf (fp, "  \"version\": \"%s\",\n", VERSION);
+  fprintf (fp, "  \"date\": \"%s\",\n", QDateTime::currentDateTime ().toString ("yyyy-MM-ddThh:mm:ss").toLatin1 ().data ());
+  fprintf (fp, "  \"status\": %d,\n", status);
+  fprintf (fp, "  \"options\": {\"surface\": %d, \"weight\": %d, \"nibble\": %d, \"clear_interpolated\": %s, ",
+           options->surface, options->weight, options->clear_int ? options->nibble : -1,
+           options->clear_int ? "true" : "false");
+  fprintf (fp, "\"replace_all\": %s, \"clear_land\": %s, \"tile_size\": %d, \"tile_halo\": %d, \"point_cache\": %s, ",
+           options->replace_all ? "true" : "false", options->clear_land ? "true" : "false", options->tile_size,
+           options->tile_halo, options->point_cache ? "true" : "false");
+  fprintf (fp, "\"export_mask\": %d, \"reduce\": %d, \"reduce_cap\": %d, \"memory_budget\": %d, ",
+           options->export_mask, options->reduce, options->reduce_cap, options->memory_budget);
+  fprintf (fp, "\"hole_fill\": %s, \"engine\": \"%s\", \"warm_residual\": %f},\n",
+           options->hole_fill ? "true" : "false", surface_engines[options->engine].name, options->warm_residual);
+  fprintf (fp, "  \"threads\": %d,\n", QThread::idealThreadCount ());
+  fprintf (fp, "  \"wall_seconds\": %.3f,\n", total);
+  fprintf (fp, "  \"capped_solves\": %lld,\n", (long long) stats->capped);
+  fprintf (fp, "  \"phases\": [\n");
+
+  for (int32_t i = 0 ; i < stats->count ; i++)
+    {
+      PHASE_STATS *phase = &stats->phase[i];
+
+      fprintf (fp, "    {\"name\": \"%s\", \"wall_seconds\": %.3f, \"cpu_seconds\": %.3f, \"bins_visited\": %lld, "
+               "\"soundings_read\": %lld, \"points\": %lld, \"bins_written\": %lld, \"peak_rss_kb\": %lld}%s\n",
+               phase->name, phase->wall, phase->cpu, (long long) phase->bins_visited, (long long) phase->soundings_read,
+               (long long) phase->points, (long long) phase->bins_written, (long long) phase->peak_rss,
+               (i < stats->count - 1) ? "," : "");
+    }
+
+  fprintf (fp, "  ]\n");
+  fprintf (fp, "}\n");
+
+  fclose (fp);
+}
@@ -0,0 +1,83 @@
+
+/*********************************************************************************************
+
+    This is public domain software that was developed by or for the U.S. Naval Oceanographic
+    Office and/or the U.S. Army Corps of Engineers.
+
+    This is a work of the U.S. Government. In accordance with 17 USC 105, copyright protection
+    is not available for any work of the U.S. Government.
+
+    Neither the United States Government, nor any employees of the United States Government,
+    nor the author, makes any warranty, express or implied, without even the implied warranty
+    of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE, or assumes any liability or
+    responsibility for the accuracy, completeness, or usefulness of any information,
+    apparatus, product, or process disclosed, or represents that its use would not infringe
+    privately-owned rights. Reference herein to any specific commercial products, process,
+    or service by trade name, trademark, manufacturer, or otherwise, does not necessarily
+    constitute or imply its endorsement, recommendation, or favoring by the United States
+    Government. The views and opinions of authors expressed herein do not necessarily state
+    or reflect those of the United States Government, and shall not be used for advertising
+    or product endorsement purposes.
+*********************************************************************************************/
+
+
+/****************************************  IMPORTANT NOTE  **********************************
+
+    Comments in this file that start with / * ! or / / ! are being used by Doxygen to
+    document the software.  Dashes in these comment blocks are used to create bullet lists.
+    The lack of blank lines after a block of dash preceeded comments means that the next
+    block of dash preceeded comments is a new, indented bullet list.  I've tried to keep the
+    Doxygen formatting to a minimum but there are some other items (like <br> and <pre>)
+    that need to be left alone.  If you see a comment that starts with / * ! or / / ! and
+    there is something that looks a bit weird it is probably due to some arcane Doxygen
+    syntax.  Be very careful modifying blocks of Doxygen comments.
+
+*****************************************  IMPORTANT NOTE  **********************************/
+
+
+
+#ifndef RUN_STATS_H
+#define RUN_STATS_H
+
+#include "pfmMispDef.hpp"
+
+
+/*  More than the number of start_phase_stats calls in misp_surface (9) so every phase gets its own slot.  */
+
+#define         MAX_RUN_PHASES          16
+
+
+typedef struct
+{
+  char                name[32];
+  double              wall;                       //  Seconds
+  double              cpu;                        //  Seconds (user + system, all threads and forked tile solves)
+  int64_t             bins_visited;
+  int64_t             soundings_read;
+  int64_t             points;
+  int64_t             bins_written;
+  int64_t             peak_rss;                   //  Peak resident set size (KB) at the end of the phase
+} PHASE_STATS;
+
+
+typedef struct
+{
+  PHASE_STATS         phase[MAX_RUN_PHASES];
+  int32_t             count;
+  QElapsedTimer       timer;
+  double              cpu_start;
+  double              wall_base;                  //  Time already in the phase when it was reopened as "other"
+  double              cpu_base;
+  QElapsedTimer       run_timer;
+  int64_t             capped;                     //  Multigrid solves that hit the V-cycle limit (see multigrid_capped)
+} RUN_STATS;
+
+
+void init_run_stats (RUN_STATS *stats);
+PHASE_STATS *start_phase_stats (RUN_STATS *stats, const char *name);
+void end_phase_stats (RUN_STATS *stats);
+void report_run_stats (RUN_STATS *stats, QString pfm_file_name, OPTIONS *options, int32_t status,
+                       RUN_CALLBACKS *callbacks);
+
+
+#endif
@@ -0,0 +1,166 @@
+
+/*********************************************************************************************
+
+    This is public domain software that was developed by or for the U.S. Naval Oceanographic
+    Office and/or the U.S. Army Corps of Engineers.
+
+    This is a work of the U.S. Government. In accordance with 17 USC 105, copyright protection
+    is not available for any work of the U.S. Government.
+
+    Neither the United States Government, nor any employees of the United States Government,
+    nor the author, makes any warranty, express or implied, without even the implied warranty
+    of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE, or assumes any liability or
+    responsibility for the accuracy, completeness, or usefulness of any information,
+    apparatus, product, or process disclosed, or represents that its use would not infringe
+    privately-owned rights. Reference herein to any specific commercial products, process,
+    or service by trade name, trademark, manufacturer, or otherwise, does not necessarily
+    constitute or imply its endorsement, recommendation, or favoring by the United States
+    Government. The views and opinions of authors expressed herein do not necessarily state
+    or reflect those of the United States Government, and shall not be used for advertising
+    or product endorsement purposes.
+*********************************************************************************************/
+
+
+/****************************************  IMPORTANT NOTE  **********************************
+
+    Comments in this file that start with / * ! or / / ! are being used by Doxygen to
+    document the software.  Dashes in these comment blocks are used to create bullet lists.
+    The lack of blank lines after a block of dash preceeded comments means that the next
+    block of dash preceeded comments is a new, indented bullet list.  I've tried to keep the
+    Doxygen formatting to a minimum but there are some other items (like <br> and <pre>)
+    that need to be left alone.  If you see a comment that starts with / * ! or / / ! and
+    there is something that looks a bit weird it is probably due to some arcane Doxygen
+    syntax.  Be very careful modifying blocks of Doxygen comments.
+
+*****************************************  IMPORTANT NOTE  **********************************/
+
+
+
+#include "scratch_grid.hpp"
+
+#ifdef NVLinux
+#include <sys/mman.h>
+#endif
+
+
+static QString scratch_prefix;
+static uint8_t scratch_disk = NVFalse;
+
+
+
+/***************************************************************************\
+*                                                                           *
+*   Module Name:        plan_scratch_grids                                  *
+*                                                                           *
+*   Purpose:            Decides whether the whole grid work areas for this  *
+*                       run go in memory or in scratch files.  If there's   *
+*                       a memory budget and "grids" bin_width by            *
+*                       bin_height float grids won't fit in half of it (the *
+*                       other half is left for the MISP tiles, see          *
+*                       solve_surface) every scratch grid allocated after   *
+*                       this is mapped from a temporary file named          *
+*                       PFM_FILE.misp_scratch.XXXXXX.  The files are        *
+*                       removed when the grids are freed.                   *
+*                                                                           *
+*   Arguments:          open_args       -   PFM open arguments              *
+*                       options         -   run options                     *
+*                       grids           -   number of whole grids needed    *
+*                                                                           *
+*   Returns:            NVTrue if the grids are going on disk               *
+*                                                                           *
+\***************************************************************************/
+
+uint8_t plan_scratch_grids (PFM_OPEN_ARGS *open_args, OPTIONS *options, int32_t grids)
+{
+  int64_t grid_bytes = (int64_t) open_args->head.bin_width * open_args->head.bin_height * sizeof (float);
+  int64_t budget = (int64_t) options->memory_budget * 1048576;
+
+  scratch_prefix = QString (open_args->list_path);
+  scratch_disk = (budget > 0 && grid_bytes * grids > budget / 2);
+
+  return (scratch_disk);
+}
+
+
+
+//  Allocates a zero filled scratch grid.  "shared" asks for memory that a forked child process can write into.
+
+void *alloc_scratch_grid (SCRATCH_GRID *scratch, int64_t bytes, uint8_t shared)
+{
+  scratch->bytes = bytes;
+  scratch->file = NULL;
+  scratch->shared = NVFalse;
+
+
+  if (scratch_disk)
+    {
+      //  Resizing a new file doesn't write anything so the unused parts of the grid never touch the disk.
+
+      scratch->file = new QTemporaryFile (scratch_prefix + ".misp_scratch.XXXXXX");
+
+      if (!scratch->file->open () || !scratch->file->resize (bytes) ||
+          (scratch->data = scratch->file->map (0, bytes)) == NULL)
+        {
+          perror ((scratch_prefix + ".misp_scratch").toLatin1 ().data ());
+          exit (-1);
+        }
+
+      return (scratch->data);
+    }
+
+
+#ifdef NVLinux
+  if (shared)
+    {
+      scratch->data = mmap (NULL, bytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+
+      if (scratch->data == MAP_FAILED)
+        {
+          perror ("Mapping scratch grid");
+          exit (-1);
+        }
+
+      scratch->shared = NVTrue;
+
+      return (scratch->data);
+    }
+#endif
+
+
+  scratch->data = calloc (bytes, 1);
+
+  if (scratch->data == NULL)
+    {
+      perror ("Allocating scratch grid");
+      exit (-1);
+    }
+
+  return (scratch->data);
+}
+
+
+
+void free_scratch_grid (SCRATCH_GRID *scratch)
+{
+  if (scratch->data == NULL) return;
+
+  if (scratch->file)
+    {
+      scratch->file->unmap ((uchar *) scratch->data);
+      scratch->file->close ();
+      delete scratch->file;
+      scratch->file = NULL;
+    }
+#ifdef NVLinux
+  else if (scratch->shared)
+    {
+      munmap (scratch->data, scratch->bytes);
+    }
+#endif
+  else
+    {
+      free (scratch->data);
+    }
+
+  scratch->data = NULL;
+}
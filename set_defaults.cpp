@@ -0,0 +1,70 @@
+
+/*********************************************************************************************
+
+    This is public domain software that was developed by or for the U.S. Naval Oceanographic
+    Office and/or the U.S. Army Corps of Engineers.
+
+    This is a work of the U.S. Government. In accordance with 17 USC 105, copyright protection
+    is not available for any work of the U.S. Government.
+
+    Neither the United States Government, nor any employees of the United States Government,
+    nor the author, makes any warranty, express or implied, without even the implied warranty
+    of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE, or assumes any liability or
+    responsibility for the accuracy, completeness, or usefulness of any information,
+    apparatus, product, or process disclosed, or represents that its use would not infringe
+    privately-owned rights. Reference herein to any specific commercial products, process,
+    or service by trade name, trademark, manufacturer, or otherwise, does not necessarily
+    constitute or imply its endorsement, recommendation, or favoring by the United States
+    Government. The views and opinions of authors expressed herein do not necessarily state
+    or reflect those of the United States Government, and shall not be used for advertising
+    or product endorsement purposes.
+*********************************************************************************************/
+
+
+/****************************************  IMPORTANT NOTE  **********************************
+
+    Comments in this file that start with / * ! or / / ! are being used by Doxygen to
+    document the software.  Dashes in these comment blocks are used to create bullet lists.
+    The lack of blank lines after a block of dash preceeded comments means that the next
+    block of dash preceeded comments is a new, indented bullet list.  I've tried to keep the
+    Doxygen formatting to a minimum but there are some other items (like <br> and <pre>)
+    that need to be left alone.  If you see a comment that starts with / * ! or / / ! and
+    there is something that looks a bit weird it is probably due to some arcane Doxygen
+    syntax.  Be very careful modifying blocks of Doxygen comments.
+
+*****************************************  IMPORTANT NOTE  **********************************/
+
+
+
+#include "set_defaults.hpp"
+#include "surface_engine.hpp"
+
+
+//  Set the option defaults.  These are used by the wizard if there is no .ini file and by batch mode.
+
+void set_defaults (OPTIONS *options)
+{
+  options->clear_land = NVFalse;
+  options->replace_all = NVFalse;
+  options->hole_fill = NVFalse;
+  options->engine = ENGINE_MISP;
+  options->force_original_value = NVFalse;
+  options->surface = 2;
+  options->clear_int = 0;
+  options->nibble = 0;
+  options->weight = 2;
+  options->tile_size = 0;
+  options->tile_halo = 32;
+  options->tile_check = 0.0;
+  options->point_cache = NVTrue;
+  options->export_mask = 0;
+  options->reduce = 0;
+  options->reduce_cap = 16;
+  options->memory_budget = 0;
+  options->warm_residual = 0.0;
+  options->input_dir = ".";
+  options->window_x = 0;
+  options->window_y = 0;
+  options->window_width = 800;
+  options->window_height = 400;
+}
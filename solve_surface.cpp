@@ -0,0 +1,810 @@
+
+/*********************************************************************************************
+
+    This is public domain software that was developed by or for the U.S. Naval Oceanographic
+    Office and/or the U.S. Army Corps of Engineers.
+
+    This is a work of the U.S. Government. In accordance with 17 USC 105, copyright protection
+    is not available for any work of the U.S. Government.
+
+    Neither the United States Government, nor any employees of the United States Government,
+    nor the author, makes any warranty, express or implied, without even the implied warranty
+    of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE, or assumes any liability or
+    responsibility for the accuracy, completeness, or usefulness of any information,
+    apparatus, product, or process disclosed, or represents that its use would not infringe
+    privately-owned rights. Reference herein to any specific commercial products, process,
+    or service by trade name, trademark, manufacturer, or otherwise, does not necessarily
+    constitute or imply its endorsement, recommendation, or favoring by the United States
+    Government. The views and opinions of authors expressed herein do not necessarily state
+    or reflect those of the United States Government, and shall not be used for advertising
+    or product endorsement purposes.
+*********************************************************************************************/
+
+
+/****************************************  IMPORTANT NOTE  **********************************
+
+    Comments in this file that start with / * ! or / / ! are being used by Doxygen to
+    document the software.  Dashes in these comment blocks are used to create bullet lists.
+    The lack of blank lines after a block of dash preceeded comments means that the next
+    block of dash preceeded comments is a new, indented bullet list.  I've tried to keep the
+    Doxygen formatting to a minimum but there are some other items (like <br> and <pre>)
+    that need to be left alone.  If you see a comment that starts with / * ! or / / ! and
+    there is something that looks a bit weird it is probably due to some arcane Doxygen
+    syntax.  Be very careful modifying blocks of Doxygen comments.
+
+*****************************************  IMPORTANT NOTE  **********************************/
+
+
+
+#include "solve_surface.hpp"
+#include "point_buffer.hpp"
+#include "scratch_grid.hpp"
+#include "surface_engine.hpp"
+
+#include <cmath>
+
+#ifdef NVLinux
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <signal.h>
+#include <unistd.h>
+#include <errno.h>
+#endif
+
+
+/*  A rough figure for the memory libmisp works in per grid node (its grids, weights, and work arrays).  It's only used
+    to size the tiles when there's a memory budget.  */
+
+#define         MISP_NODE_BYTES         48
+
+#define         MIN_BUDGET_TILE         64         /* Smallest tile (bins) we'd rather run fewer of at once than go below */
+
+
+/*  A tile is the "core" area that it is responsible for plus a halo of overlap on each side (clipped to the grid).  The
+    solve is done over the extended area and the overlaps are feathered together in blend_tile.  */
+
+typedef struct
+{
+  int32_t             x0, y0, x1, y1;             //  Core area (bins, x1/y1 exclusive)
+  int32_t             ex0, ey0, ex1, ey1;         //  Core plus halo
+  int64_t             start;                      //  Start of this tile's points in tile_index
+  int64_t             count;                      //  Number of points in the extended area
+} MISP_TILE;
+
+
+static RUN_CALLBACKS *run_callbacks;
+
+
+static void misp_progress_callback (char *info)
+{
+  if (strlen (info) >= 2) run_callbacks->message (QString (info));
+}
+
+
+
+//  Tiles don't report MISP progress, with a few dozen tiles running at once it would just be noise.
+
+static void quiet_progress_callback (char *info __attribute__ ((unused)))
+{
+}
+
+
+
+static void init_misp (NV_F64_XYMBR mbr, int32_t weight)
+{
+  misp_init (1.0, 1.0, 0.05, 4, 20.0, 20, NO_GRID_VALUE, -NO_GRID_VALUE, weight, mbr);
+}
+
+
+
+//  Half of the memory budget (bytes) is for MISP, the other half is for the whole grids (see plan_scratch_grids).
+
+static int64_t misp_budget (OPTIONS *options)
+{
+  return ((int64_t) options->memory_budget * 1048576 / 2);
+}
+
+
+
+/*  NVTrue if solve_surface is going to do a single grid solve (no tiles).  If MISP won't fit in the memory budget with
+    the whole grid we have to use tiles.  Only MISP is tiled, the other engines are local and run in the row band
+    threads anyway.  */
+
+uint8_t single_grid (int32_t width, int32_t height, OPTIONS *options)
+{
+  if (!surface_engines[options->engine].global_state) return (NVTrue);
+
+  if (options->memory_budget && (int64_t) width * height * MISP_NODE_BYTES > misp_budget (options)) return (NVFalse);
+
+  return (options->tile_size <= 0 || (options->tile_size >= width && options->tile_size >= height));
+}
+
+
+
+/*  Sets MISP up for a single grid solve over the whole PFM MBR.  This is called from ingest when it is going to load
+    the points into MISP as they're read (see ingest_pfm), otherwise from single_solve.  */
+
+void start_single_solve (NV_F64_XYMBR mbr, OPTIONS *options, RUN_CALLBACKS *callbacks)
+{
+  run_callbacks = callbacks;
+
+  misp_register_progress_callback (misp_progress_callback);
+
+  init_misp (mbr, options->weight);
+}
+
+
+
+/*  The original single grid solve over the whole PFM MBR.  If "loaded" is set the points are already in MISP.  The
+    other engines grid the whole thing in one call and anything they couldn't grid gets the out of range value.  Returns
+    the number of rows in the grid or -1 if it was cancelled.  */
+
+static int32_t single_solve (POINT_BUFFER *points, uint8_t loaded, NV_F64_XYMBR mbr, int32_t width, int32_t height,
+                             OPTIONS *options, RUN_CALLBACKS *callbacks, float *grid)
+{
+  float               *array;
+  int32_t             rows = 0;
+
+
+  if (options->engine != ENGINE_MISP)
+    {
+      if (surface_engines[options->engine].solve (points, NULL, points->count, 0, 0, width, height, options, callbacks,
+                                                  grid) == RUN_CANCELLED) return (-1);
+
+      for (int64_t k = 0 ; k < (int64_t) width * height ; k++) if (std::isnan (grid[k])) grid[k] = NO_GRID_VALUE;
+
+      return (height);
+    }
+
+
+  //  Setting range to 0 makes the bar just show movement.
+
+  callbacks->phase (QCoreApplication::translate ("pfmMisp", "Generating grid surface"), 0);
+
+  if (!loaded)
+    {
+      start_single_solve (mbr, options, callbacks);
+
+      load_misp_points (points, NULL, points->count);
+    }
+
+
+  if (misp_proc ()) exit (-1);
+
+
+  /*  Allocating one more column than we need due to chrtr specific changes in misp_rtrv (see misp_funcs.c).  */
+
+  array = (float *) malloc ((width + 1) * sizeof (float));
+
+  if (array == NULL)
+    {
+      perror ("Allocating array");
+      exit (-1);
+    }
+
+
+  for (int32_t i = 0 ; i < height ; i++)
+    {
+      if (!misp_rtrv (array)) break;
+
+      memcpy (&grid[(int64_t) i * width], array, width * sizeof (float));
+
+      rows++;
+    }
+
+  free (array);
+
+
+  return (rows);
+}
+
+
+
+//  The MISP MBR for part of the grid (x1/y1 exclusive).
+
+NV_F64_XYMBR area_mbr (int32_t x0, int32_t y0, int32_t x1, int32_t y1)
+{
+  NV_F64_XYMBR        mbr;
+
+
+  mbr.min_x = (double) x0;
+  mbr.min_y = (double) y0;
+  mbr.max_x = (double) x1;
+  mbr.max_y = (double) y1;
+
+  return (mbr);
+}
+
+
+
+/***************************************************************************\
+*                                                                           *
+*   Module Name:        misp_grid                                           *
+*                                                                           *
+*   Purpose:            Solves MISP from scratch over "mbr" and puts the    *
+*                       first width by height values of the result in       *
+*                       "out".  Anything that MISP didn't give us, and any  *
+*                       node outside the misp_init limits (NO_GRID_VALUE),  *
+*                       is NaN so the tile blend and the holes skip it.     *
+*                       This doesn't allocate anything (other than          *
+*                       what libmisp does) or call back into Qt so it is    *
+*                       all that the child processes forked by tiled_solve, *
+*                       fill_holes, and start_export_solves run.  They're   *
+*                       forked from a multithreaded process so they can't   *
+*                       safely do much more than that (libmisp's own        *
+*                       allocations are safe because glibc resets the       *
+*                       malloc locks in the child on fork).                 *
+*                                                                           *
+*   Arguments:          points          -   normalized (bin unit) points    *
+*                       index           -   points to use, NULL for all     *
+*                       count           -   number of points                *
+*                       mbr             -   area (bin units)                *
+*                       width           -   columns in out                  *
+*                       height          -   rows in out                     *
+*                       weight          -   MISP weight factor              *
+*                       out             -   width * height values           *
+*                       row             -   width + 1 floats of space for   *
+*                                           misp_rtrv                       *
+*                                                                           *
+*   Returns:            Number of rows MISP gave us, or -1 if it failed     *
+*                                                                           *
+\***************************************************************************/
+
+int32_t misp_grid (POINT_BUFFER *points, int64_t *index, int64_t count, NV_F64_XYMBR mbr, int32_t width,
+                   int32_t height, int32_t weight, float *out, float *row)
+{
+  int32_t             rows = 0;
+
+
+  for (int64_t k = 0 ; k < (int64_t) width * height ; k++) out[k] = NAN;
+
+  if (!count) return (0);
+
+
+  init_misp (mbr, weight);
+
+  load_misp_points (points, index, count);
+
+  if (misp_proc ()) return (-1);
+
+
+  for (int32_t i = 0 ; i < height ; i++)
+    {
+      if (!misp_rtrv (row)) break;
+
+      float *out_row = &out[(int64_t) i * width];
+
+      for (int32_t j = 0 ; j < width ; j++) out_row[j] = (fabsf (row[j]) < NO_GRID_VALUE) ? row[j] : NAN;
+
+      rows++;
+    }
+
+
+  return (rows);
+}
+
+
+
+/*  The MISP engine (see surface_engine).  This is misp_grid over a tile or a hole in the calling process (the forked
+    tiles and holes call misp_grid themselves).  The whole grid solve (and loading the points during ingest) is done by
+    single_solve, not this.  Returns 0, or -1 if MISP failed.  */
+
+int32_t misp_solve (POINT_BUFFER *points, int64_t *index, int64_t count, int32_t x0, int32_t y0, int32_t x1, int32_t y1,
+                    OPTIONS *options, RUN_CALLBACKS *callbacks __attribute__ ((unused)), float *out)
+{
+  //  One more column than we need due to chrtr specific changes in misp_rtrv (see single_solve).
+
+  float *row = (float *) malloc ((x1 - x0 + 1) * sizeof (float));
+
+  if (row == NULL) return (-1);
+
+  int32_t rows = misp_grid (points, index, count, area_mbr (x0, y0, x1, y1), x1 - x0, y1 - y0, options->weight, out,
+                            row);
+
+  free (row);
+
+
+  return (rows < 0 ? -1 : 0);
+}
+
+
+
+//  Solves part of the grid (a tile or a hole) with the selected engine, in the calling thread.
+
+int32_t solve_local (POINT_BUFFER *points, int64_t *index, int64_t count, int32_t x0, int32_t y0, int32_t x1,
+                     int32_t y1, OPTIONS *options, float *out)
+{
+  return (surface_engines[options->engine].solve (points, index, count, x0, y0, x1, y1, options, NULL, out));
+}
+
+
+
+/*  Size (floats) of a tile's buffer, the extended area followed by the row that misp_rtrv needs (see misp_grid) so
+    the tile processes don't have to allocate it.  */
+
+static int64_t tile_floats (MISP_TILE *tile)
+{
+  return ((int64_t) (tile->ex1 - tile->ex0) * (tile->ey1 - tile->ey0) + tile->ex1 - tile->ex0 + 1);
+}
+
+
+
+//  Solves one tile over its extended area into "out" (tile_floats floats).  Only MISP is ever tiled (see single_grid).
+
+static int32_t solve_tile (POINT_BUFFER *points, int64_t *tile_index, MISP_TILE *tile, OPTIONS *options, float *out)
+{
+  float *row = &out[(int64_t) (tile->ex1 - tile->ex0) * (tile->ey1 - tile->ey0)];
+
+  return (misp_grid (points, &tile_index[tile->start], tile->count, area_mbr (tile->ex0, tile->ey0, tile->ex1, tile->ey1),
+                     tile->ex1 - tile->ex0, tile->ey1 - tile->ey0, options->weight, out, row) < 0 ? -1 : 0);
+}
+
+
+
+//  Linear feather weight for a bin "d" bins in from the edge of the extended area.  Over the 2 * halo wide overlap the
+//  weights of the two neighboring tiles add up to 1.
+
+static float ramp (int32_t d, int32_t halo)
+{
+  return (MIN (1.0, ((double) d + 0.5) / (double) (2 * halo)));
+}
+
+
+
+static void blend_tile (MISP_TILE *tile, float *out, int32_t width, int32_t height, int32_t halo, float *grid,
+                        float *wsum)
+{
+  int32_t ew = tile->ex1 - tile->ex0;
+
+  for (int32_t y = tile->ey0 ; y < tile->ey1 ; y++)
+    {
+      float wy = 1.0;
+
+      if (halo)
+        {
+          if (tile->ey0 > 0) wy = MIN (wy, ramp (y - tile->ey0, halo));
+          if (tile->ey1 < height) wy = MIN (wy, ramp (tile->ey1 - 1 - y, halo));
+        }
+
+      float *row = &out[(int64_t) (y - tile->ey0) * ew];
+
+      for (int32_t x = tile->ex0 ; x < tile->ex1 ; x++)
+        {
+          float value = row[x - tile->ex0];
+
+          if (std::isnan (value)) continue;
+
+          float wx = 1.0;
+
+          if (halo)
+            {
+              if (tile->ex0 > 0) wx = MIN (wx, ramp (x - tile->ex0, halo));
+              if (tile->ex1 < width) wx = MIN (wx, ramp (tile->ex1 - 1 - x, halo));
+            }
+
+          int64_t k = (int64_t) y * width + x;
+
+          grid[k] += wx * wy * value;
+          wsum[k] += wx * wy;
+        }
+    }
+}
+
+
+
+/*  Works out the tile size and how many tiles to solve at once.  With a memory budget the tiles that are running at the
+    same time (MISP plus the output buffer over the extended area) have to fit in half of the budget so the tiles are
+    shrunk and, if they'd get smaller than MIN_BUDGET_TILE, fewer of them are run at once.  */
+
+static void plan_tiles (int32_t width, int32_t height, OPTIONS *options, RUN_CALLBACKS *callbacks, int32_t *size,
+                        int32_t *procs)
+{
+  *size = options->tile_size > 0 ? options->tile_size : MAX (width, height);
+  *procs = QThread::idealThreadCount ();
+
+  if (!options->memory_budget) return;
+
+
+  int64_t nodes = misp_budget (options) / (MISP_NODE_BYTES + sizeof (float));
+  int32_t min_size = MAX (MIN_BUDGET_TILE, 2 * options->tile_halo);
+  int64_t min_nodes = (int64_t) (min_size + 2 * options->tile_halo) * (min_size + 2 * options->tile_halo);
+
+  if (nodes / *procs < min_nodes) *procs = MAX (1, MIN (*procs, nodes / min_nodes));
+
+
+  //  A budget that won't even hold one MIN_BUDGET_TILE tile still gets 16 bin tiles, one at a time.
+
+  int32_t side = MAX ((int32_t) sqrt ((double) nodes / (double) *procs) - 2 * options->tile_halo, 16);
+
+  *size = MIN (*size, side);
+
+  callbacks->message (QCoreApplication::translate ("pfmMisp", "Memory budget %1 MB : %2 bin tiles, %3 at a time").
+                      arg (options->memory_budget).arg (*size).arg (*procs));
+}
+
+
+
+/*  Splits the grid into tiles and solves them in parallel.  libmisp keeps all of its state in static memory so on
+    Linux each tile is solved in a forked child process (one per core) that writes its result to a shared anonymous
+    mapping.  The children only run solve_tile (see misp_grid), everything else (the messages, progress, and blending)
+    is done here.  Everywhere else the tiles are solved one at a time.  Returns NVTrue if the run was cancelled.  */
+
+static uint8_t tiled_solve (POINT_BUFFER *points, int32_t width, int32_t height, OPTIONS *options,
+                            RUN_CALLBACKS *callbacks, float *grid)
+{
+  MISP_TILE           *tiles;
+  int64_t             *tile_index, *cursor;
+  float               *wsum;
+  SCRATCH_GRID        wsum_scratch;
+  int32_t             size, max_procs;
+  uint8_t             cancelled = NVFalse;
+
+
+  plan_tiles (width, height, options, callbacks, &size, &max_procs);
+
+  int32_t halo = MIN (options->tile_halo, size / 2);
+  int32_t ntx = (width + size - 1) / size;
+  int32_t nty = (height + size - 1) / size;
+  int32_t ntiles = ntx * nty;
+
+
+  tiles = (MISP_TILE *) calloc (ntiles, sizeof (MISP_TILE));
+
+  if (tiles == NULL)
+    {
+      perror ("Allocating tiles");
+      exit (-1);
+    }
+
+  for (int32_t ty = 0 ; ty < nty ; ty++)
+    {
+      for (int32_t tx = 0 ; tx < ntx ; tx++)
+        {
+          MISP_TILE *tile = &tiles[ty * ntx + tx];
+
+          tile->x0 = tx * size;
+          tile->y0 = ty * size;
+          tile->x1 = MIN (tile->x0 + size, width);
+          tile->y1 = MIN (tile->y0 + size, height);
+          tile->ex0 = MAX (tile->x0 - halo, 0);
+          tile->ey0 = MAX (tile->y0 - halo, 0);
+          tile->ex1 = MIN (tile->x1 + halo, width);
+          tile->ey1 = MIN (tile->y1 + halo, height);
+        }
+    }
+
+
+  /*  Bucket the points by tile.  A point near a tile corner can fall in the extended area of up to four tiles.  The
+      first pass counts, the second pass fills.  Tile t's points are tile_index[start] through
+      tile_index[start + count - 1], in the original (band) order.  */
+
+  for (int32_t pass = 0 ; pass < 2 ; pass++)
+    {
+      for (int64_t k = 0 ; k < points->count ; k++)
+        {
+          double x = points->x[k], y = points->y[k];
+
+          int32_t cmin = MAX ((int32_t) floor ((x - halo) / size), 0);
+          int32_t cmax = MIN ((int32_t) floor ((x + halo) / size), ntx - 1);
+          int32_t rmin = MAX ((int32_t) floor ((y - halo) / size), 0);
+          int32_t rmax = MIN ((int32_t) floor ((y + halo) / size), nty - 1);
+
+          for (int32_t r = rmin ; r <= rmax ; r++)
+            {
+              for (int32_t c = cmin ; c <= cmax ; c++)
+                {
+                  int32_t t = r * ntx + c;
+
+                  if (pass)
+                    {
+                      tile_index[cursor[t]++] = k;
+                    }
+                  else
+                    {
+                      tiles[t].count++;
+                    }
+                }
+            }
+        }
+
+
+      if (!pass)
+        {
+          int64_t total = 0;
+
+          cursor = (int64_t *) malloc (ntiles * sizeof (int64_t));
+
+          for (int32_t t = 0 ; t < ntiles ; t++)
+            {
+              tiles[t].start = cursor[t] = total;
+              total += tiles[t].count;
+            }
+
+          tile_index = (int64_t *) malloc (MAX (total, 1) * sizeof (int64_t));
+
+          if (cursor == NULL || tile_index == NULL)
+            {
+              perror ("Allocating tile index");
+              exit (-1);
+            }
+        }
+    }
+
+  free (cursor);
+
+
+  //  The grid accumulates the weighted sums and wsum the weights.
+
+  memset (grid, 0, (int64_t) width * height * sizeof (float));
+
+  wsum = (float *) alloc_scratch_grid (&wsum_scratch, (int64_t) width * height * sizeof (float), NVFalse);
+
+
+  callbacks->phase (QCoreApplication::translate ("pfmMisp", "Generating grid surface (%1 tiles)").arg (ntiles), ntiles);
+
+  misp_register_progress_callback (quiet_progress_callback);
+
+
+#ifdef NVLinux
+
+  pid_t *pids = (pid_t *) calloc (ntiles, sizeof (pid_t));
+  float **outs = (float **) calloc (ntiles, sizeof (float *));
+
+  if (pids == NULL || outs == NULL)
+    {
+      perror ("Allocating tile processes");
+      exit (-1);
+    }
+
+  int32_t next = 0, running = 0, done = 0;
+
+  while (running || (!cancelled && next < ntiles))
+    {
+      //  Start as many tiles as we have cores.
+
+      while (!cancelled && running < max_procs && next < ntiles)
+        {
+          MISP_TILE *tile = &tiles[next];
+
+          outs[next] = (float *) mmap (NULL, tile_floats (tile) * sizeof (float), PROT_READ | PROT_WRITE,
+                                       MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+
+          if (outs[next] == MAP_FAILED)
+            {
+              perror ("Mapping tile buffer");
+              exit (-1);
+            }
+
+          pid_t pid = fork ();
+
+          if (pid < 0)
+            {
+              perror ("Starting tile process");
+              exit (-1);
+            }
+
+          if (pid == 0)
+            {
+              //  A cancelled run kills the tiles with SIGTERM so drop the handler batch mode may have installed.
+
+              signal (SIGTERM, SIG_DFL);
+
+              _exit (solve_tile (points, tile_index, tile, options, outs[next]) ? 1 : 0);
+            }
+
+          pids[next++] = pid;
+          running++;
+        }
+
+
+      //  Collect any tiles that have finished.
+
+      uint8_t reaped = NVFalse;
+
+      for (int32_t t = 0 ; t < next ; t++)
+        {
+          if (!pids[t]) continue;
+
+          int status;
+          pid_t pid = waitpid (pids[t], &status, WNOHANG);
+
+          if (pid == 0) continue;
+
+          if (pid < 0 && errno == EINTR) continue;
+
+          pids[t] = 0;
+          running--;
+          reaped = NVTrue;
+
+          if (!cancelled)
+            {
+              if (pid > 0 && WIFEXITED (status) && !WEXITSTATUS (status))
+                {
+                  blend_tile (&tiles[t], outs[t], width, height, halo, grid, wsum);
+                }
+              else
+                {
+                  callbacks->message (QCoreApplication::translate ("pfmMisp", "Unable to grid tile %1, it will be left empty").arg (t));
+                }
+
+              callbacks->value (++done);
+            }
+
+          munmap (outs[t], tile_floats (&tiles[t]) * sizeof (float));
+        }
+
+
+      if (!reaped)
+        {
+          usleep (50000);
+
+          if (!cancelled && callbacks->cancelled ())
+            {
+              cancelled = NVTrue;
+
+              for (int32_t t = 0 ; t < next ; t++) if (pids[t]) kill (pids[t], SIGTERM);
+            }
+        }
+    }
+
+  free (pids);
+  free (outs);
+
+#else
+
+  for (int32_t t = 0 ; t < ntiles ; t++)
+    {
+      float *out = (float *) malloc (tile_floats (&tiles[t]) * sizeof (float));
+
+      if (out == NULL)
+        {
+          perror ("Allocating tile buffer");
+          exit (-1);
+        }
+
+      if (!solve_tile (points, tile_index, &tiles[t], options, out))
+        {
+          blend_tile (&tiles[t], out, width, height, halo, grid, wsum);
+        }
+      else
+        {
+          callbacks->message (QCoreApplication::translate ("pfmMisp", "Unable to grid tile %1, it will be left empty").arg (t));
+        }
+
+      free (out);
+
+      callbacks->value (t + 1);
+
+      if (callbacks->cancelled ())
+        {
+          cancelled = NVTrue;
+          break;
+        }
+    }
+
+#endif
+
+
+  //  Normalize by the weights.  Bins that no tile could grid get the out of range value so they'll be nulled.
+
+  for (int64_t k = 0 ; k < (int64_t) width * height ; k++)
+    {
+      if (wsum[k] > 0.0)
+        {
+          grid[k] /= wsum[k];
+        }
+      else
+        {
+          grid[k] = NO_GRID_VALUE;
+        }
+    }
+
+
+  free_scratch_grid (&wsum_scratch);
+  free (tile_index);
+  free (tiles);
+
+
+  return (cancelled);
+}
+
+
+
+/***************************************************************************\
+*                                                                           *
+*   Module Name:        solve_surface                                       *
+*                                                                           *
+*   Purpose:            Computes the surface from the normalized points     *
+*                       with the selected engine (see surface_engine),      *
+*                       either as one grid over the whole MBR or, for MISP, *
+*                       in overlapping tiles (options->tile_size > 0) that  *
+*                       are solved in parallel and feathered together.      *
+*                       If options->tile_check is set the single grid is    *
+*                       computed as well and the difference is reported.    *
+*                                                                           *
+*   Arguments:          points          -   normalized (bin unit) points    *
+*                       loaded          -   NVTrue if the points were       *
+*                                           loaded into MISP during ingest  *
+*                                           (only for a single grid, see    *
+*                                           start_single_solve)             *
+*                       mbr             -   MISP MBR (bin units)            *
+*                       width           -   grid width (bins)               *
+*                       height          -   grid height (bins)              *
+*                       options         -   run options                     *
+*                       callbacks       -   progress hooks                  *
+*                       grid            -   width * height output grid      *
+*                       rows            -   number of grid rows retrieved   *
+*                                                                           *
+*   Returns:            0, RUN_CANCELLED, or RUN_CHECK_FAILED (the tiled    *
+*                       surface differs from the single grid by more than   *
+*                       options->tile_check)                                *
+*                                                                           *
+\***************************************************************************/
+
+int32_t solve_surface (POINT_BUFFER *points, uint8_t loaded, NV_F64_XYMBR mbr, int32_t width, int32_t height,
+                       OPTIONS *options, RUN_CALLBACKS *callbacks, float *grid, int32_t *rows)
+{
+  run_callbacks = callbacks;
+
+
+  if (single_grid (width, height, options))
+    {
+      *rows = single_solve (points, loaded, mbr, width, height, options, callbacks, grid);
+
+      return (*rows < 0 ? RUN_CANCELLED : 0);
+    }
+
+
+  if (tiled_solve (points, width, height, options, callbacks, grid)) return (RUN_CANCELLED);
+
+  *rows = height;
+
+
+  //  There's no point in the comparison if the single grid is what wouldn't fit in the memory budget.
+
+  if (options->tile_check > 0.0 && options->memory_budget && options->tile_size <= 0)
+    {
+      callbacks->message (QCoreApplication::translate ("pfmMisp", "The single grid won't fit in the memory budget, "
+                                                       "skipping the tile check"));
+    }
+  else if (options->tile_check > 0.0)
+    {
+      SCRATCH_GRID check_scratch;
+
+      float *check = (float *) alloc_scratch_grid (&check_scratch, (int64_t) width * height * sizeof (float), NVFalse);
+
+
+      callbacks->phase (QCoreApplication::translate ("pfmMisp", "Generating single grid surface for comparison"), 0);
+
+      int32_t check_rows = single_solve (points, NVFalse, mbr, width, height, options, callbacks, check);
+
+
+      double max_diff = 0.0, sum_sq = 0.0;
+      int64_t n = 0;
+
+      for (int64_t k = 0 ; k < (int64_t) width * check_rows ; k++)
+        {
+          if (grid[k] == NO_GRID_VALUE || check[k] == NO_GRID_VALUE) continue;
+
+          double diff = fabs ((double) grid[k] - (double) check[k]);
+
+          max_diff = MAX (max_diff, diff);
+          sum_sq += diff * diff;
+          n++;
+        }
+
+      free_scratch_grid (&check_scratch);
+
+
+      double rms = n ? sqrt (sum_sq / (double) n) : 0.0;
+
+      QString string = QCoreApplication::translate ("pfmMisp", "Tiled vs single grid : max difference %1, RMS difference %2, "
+                                                    "tolerance %3");
+      callbacks->message (string.arg (max_diff, 0, 'f', 4).arg (rms, 0, 'f', 4).arg (options->tile_check, 0, 'f', 4));
+
+      if (max_diff > options->tile_check) return (RUN_CHECK_FAILED);
+    }
+
+
+  return (0);
+}
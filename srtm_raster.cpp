@@ -0,0 +1,231 @@
+
+/*********************************************************************************************
+
+    This is public domain software that was developed by or for the U.S. Naval Oceanographic
+    Office and/or the U.S. Army Corps of Engineers.
+
+    This is a work of the U.S. Government. In accordance with 17 USC 105, copyright protection
+    is not available for any work of the U.S. Government.
+
+    Neither the United States Government, nor any employees of the United States Government,
+    nor the author, makes any warranty, express or implied, without even the implied warranty
+    of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE, or assumes any liability or
+    responsibility for the accuracy, completeness, or usefulness of any information,
+    apparatus, product, or process disclosed, or represents that its use would not infringe
+    privately-owned rights. Reference herein to any specific commercial products, process,
+    or service by trade name, trademark, manufacturer, or otherwise, does not necessarily
+    constitute or imply its endorsement, recommendation, or favoring by the United States
+    Government. The views and opinions of authors expressed herein do not necessarily state
+    or reflect those of the United States Government, and shall not be used for advertising
+    or product endorsement purposes.
+*********************************************************************************************/
+
+
+/****************************************  IMPORTANT NOTE  **********************************
+
+    Comments in this file that start with / * ! or / / ! are being used by Doxygen to
+    document the software.  Dashes in these comment blocks are used to create bullet lists.
+    The lack of blank lines after a block of dash preceeded comments means that the next
+    block of dash preceeded comments is a new, indented bullet list.  I've tried to keep the
+    Doxygen formatting to a minimum but there are some other items (like <br> and <pre>)
+    that need to be left alone.  If you see a comment that starts with / * ! or / / ! and
+    there is something that looks a bit weird it is probably due to some arcane Doxygen
+    syntax.  Be very careful modifying blocks of Doxygen comments.
+
+*****************************************  IMPORTANT NOTE  **********************************/
+
+
+
+#include "srtm_raster.hpp"
+
+
+/*  The SRTM land mask for a PFM never changes so, once it has been built at the PFM's bin resolution, it is saved next
+    to the PFM list file (PFM_FILE.srtm_mask) and reused.  The cache is keyed on the bin geometry so it is rebuilt if
+    the PFM is rebuilt with a different area or bin size.
+
+    The mask is only ever looked at for bins without soundings (real data beats the mask) so those are the only bins
+    we look up.  The cache has a second plane with the bins that were looked up and, if soundings have been removed
+    from a bin since, the next run looks up just those bins and saves the cache again.
+
+    Layout:  SRTM_RASTER_HEADER followed by the RASTER_SRTM plane and the looked up plane.  */
+
+#define         SRTM_RASTER_MAGIC       "PFMMISPSRTM02"
+
+
+typedef struct
+{
+  char                magic[16];
+  int32_t             width;
+  int32_t             height;
+  int32_t             words;
+  int32_t             spare;
+  NV_F64_XYMBR        mbr;
+  double              x_bin_size_degrees;
+  double              y_bin_size_degrees;
+} SRTM_RASTER_HEADER;
+
+
+
+static void stamp_header (PFM_OPEN_ARGS *open_args, BIN_RASTER *raster, SRTM_RASTER_HEADER *header)
+{
+  memset (header, 0, sizeof (SRTM_RASTER_HEADER));
+
+  strcpy (header->magic, SRTM_RASTER_MAGIC);
+  header->width = raster->width;
+  header->height = raster->height;
+  header->words = raster->words;
+  header->mbr = open_args->head.mbr;
+  header->x_bin_size_degrees = open_args->head.x_bin_size_degrees;
+  header->y_bin_size_degrees = open_args->head.y_bin_size_degrees;
+}
+
+
+
+/***************************************************************************\
+*                                                                           *
+*   Module Name:        load_srtm_raster                                    *
+*                                                                           *
+*   Purpose:            Fills the RASTER_SRTM plane with the SRTM land      *
+*                       mask at the center of each bin without soundings    *
+*                       (RASTER_SOUNDINGS has to be filled already).  It    *
+*                       comes from the PFM_FILE.srtm_mask cache if there is *
+*                       one for this bin geometry, any bins the cache       *
+*                       didn't look up are looked up (the SRTM library      *
+*                       loads each one degree cell once) and the cache is   *
+*                       saved for the next run.                             *
+*                                                                           *
+*   Arguments:          open_args       -   PFM open args                   *
+*                       raster          -   bin raster                      *
+*                       callbacks       -   progress hooks                  *
+*                                                                           *
+*   Returns:            NVTrue if the run was cancelled                     *
+*                                                                           *
+\***************************************************************************/
+
+uint8_t load_srtm_raster (PFM_OPEN_ARGS *open_args, BIN_RASTER *raster, RUN_CALLBACKS *callbacks)
+{
+  SRTM_RASTER_HEADER  header, current;
+  uint64_t            *checked, tail;
+  int64_t             lookups = 0;
+  uint8_t             loaded = NVFalse;
+  double              lat, lon;
+
+
+  alloc_raster_plane (raster, RASTER_SRTM);
+
+  stamp_header (open_args, raster, &current);
+
+  int64_t plane_size = (int64_t) raster->words * raster->height * sizeof (uint64_t);
+
+  checked = (uint64_t *) calloc (plane_size, 1);
+
+  if (checked == NULL)
+    {
+      perror ("Allocating SRTM lookup plane");
+      exit (-1);
+    }
+
+
+  QFile file (QString (open_args->list_path) + ".srtm_mask");
+
+  if (file.open (QIODevice::ReadOnly))
+    {
+      loaded = (file.read ((char *) &header, sizeof (SRTM_RASTER_HEADER)) == (qint64) sizeof (SRTM_RASTER_HEADER) &&
+                !memcmp (&header, &current, sizeof (SRTM_RASTER_HEADER)) &&
+                file.read ((char *) raster->plane[RASTER_SRTM], plane_size) == plane_size &&
+                file.read ((char *) checked, plane_size) == plane_size);
+
+      if (!loaded)
+        {
+          memset (raster->plane[RASTER_SRTM], 0, plane_size);
+          memset (checked, 0, plane_size);
+        }
+
+      file.close ();
+    }
+
+
+  //  Bits past the end of a row are marked as looked up so we never go after them.
+
+  tail = (raster->width & 63) ? ~(((uint64_t) 1 << (raster->width & 63)) - 1) : 0;
+
+  for (int32_t i = 0 ; i < raster->height ; i++)
+    {
+      uint64_t *occupied = raster_row (raster, RASTER_SOUNDINGS, i);
+      uint64_t *done = &checked[(int64_t) i * raster->words];
+
+      done[raster->words - 1] |= tail;
+
+      for (int32_t w = 0 ; w < raster->words ; w++) lookups += __builtin_popcountll (~(occupied[w] | done[w]));
+    }
+
+
+  if (!lookups)
+    {
+      free (checked);
+
+      if (loaded)
+        callbacks->message (QCoreApplication::translate ("pfmMisp", "SRTM land mask loaded from %1").arg (file.fileName ()));
+
+      return (NVFalse);
+    }
+
+
+  callbacks->phase (QCoreApplication::translate ("pfmMisp", "Building SRTM land mask"), raster->height);
+
+
+  //  read_srtm_mask keeps its tiles in static memory so this has to be done in one thread.
+
+  for (int32_t i = 0 ; i < raster->height ; i++)
+    {
+      uint64_t *occupied = raster_row (raster, RASTER_SOUNDINGS, i);
+      uint64_t *done = &checked[(int64_t) i * raster->words];
+
+      lat = open_args->head.mbr.min_y + ((double) i + 0.5) * open_args->head.y_bin_size_degrees;
+
+      for (int32_t w = 0 ; w < raster->words ; w++)
+        {
+          for (uint64_t bits = ~(occupied[w] | done[w]) ; bits ; bits &= bits - 1)
+            {
+              int32_t j = (w << 6) + __builtin_ctzll (bits);
+
+              lon = open_args->head.mbr.min_x + ((double) j + 0.5) * open_args->head.x_bin_size_degrees;
+
+              if (read_srtm_mask (lat, lon) == 1) raster_set (raster, RASTER_SRTM, j, i);
+            }
+
+          done[w] |= ~occupied[w];
+        }
+
+      callbacks->value (i);
+
+      if (callbacks->cancelled ())
+        {
+          free (checked);
+          return (NVTrue);
+        }
+    }
+
+  callbacks->value (raster->height);
+
+  callbacks->message (QCoreApplication::translate ("pfmMisp", "SRTM land mask : looked up %L1 bins without soundings").arg (lookups));
+
+
+  //  Not being able to save the cache isn't an error, we'll just build it again next time.
+
+  if (file.open (QIODevice::WriteOnly | QIODevice::Truncate))
+    {
+      uint8_t ok = (file.write ((char *) &current, sizeof (SRTM_RASTER_HEADER)) == (qint64) sizeof (SRTM_RASTER_HEADER) &&
+                    file.write ((char *) raster->plane[RASTER_SRTM], plane_size) == plane_size &&
+                    file.write ((char *) checked, plane_size) == plane_size);
+
+      file.close ();
+
+      if (!ok) file.remove ();
+    }
+
+
+  free (checked);
+
+  return (NVFalse);
+}
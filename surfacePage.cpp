@@ -38,6 +38,8 @@
 
 #include "surfacePage.hpp"
 #include "surfacePageHelp.hpp"
+#include "reduce_bin.hpp"
+#include "surface_engine.hpp"
 
 surfacePage::surfacePage (QWidget *parent, OPTIONS *op):
   QWizardPage (parent)
@@ -105,6 +107,22 @@ surfacePage::surfacePage (QWidget *parent, OPTIONS *op):
   oBoxLayout->addWidget (aBox);
 
 
+  QGroupBox *hBox = new QGroupBox (tr ("Fill holes locally"), this);
+  QHBoxLayout *hBoxLayout = new QHBoxLayout;
+  hBox->setLayout (hBoxLayout);
+
+  holeFill = new QCheckBox (this);
+  holeFill->setToolTip (tr ("Solve each hole on its own instead of the whole PFM"));
+  holeFill->setWhatsThis (holeFillText);
+  holeFill->setChecked (options->hole_fill);
+  holeFill->setEnabled (!options->replace_all);
+  connect (replaceAll, SIGNAL (toggled (bool)), holeFill, SLOT (setDisabled (bool)));
+  hBoxLayout->addWidget (holeFill);
+
+
+  oBoxLayout->addWidget (hBox);
+
+
   QGroupBox *cBox = new QGroupBox (tr ("Clear land"), this);
   QHBoxLayout *cBoxLayout = new QHBoxLayout;
   cBox->setLayout (cBoxLayout);
@@ -132,7 +150,7 @@ surfacePage::surfacePage (QWidget *parent, OPTIONS *op):
 
 
   nibble = new QSpinBox (this);
-  nibble->setRange (0, 20);
+  nibble->setRange (0, 1000);
   nibble->setSingleStep (1);
   nibble->setValue (options->nibble);
   nibble->setWrapping (false);
@@ -152,6 +170,44 @@ surfacePage::surfacePage (QWidget *parent, OPTIONS *op):
   mBox->setLayout (mBoxLayout);
 
 
+  QGroupBox *gBox = new QGroupBox (tr ("Engine"), this);
+  QHBoxLayout *gBoxLayout = new QHBoxLayout;
+  gBox->setLayout (gBoxLayout);
+  gBoxLayout->setSpacing (10);
+
+  engine = new QComboBox (this);
+  engine->setEditable (false);
+  for (int32_t e = 0 ; e < ENGINE_COUNT ; e++)
+    engine->addItem (QCoreApplication::translate ("pfmMisp", surface_engines[e].title));
+  engine->setCurrentIndex (options->engine);
+  engine->setToolTip (tr ("Set the interpolator used to compute the surface"));
+  engine->setWhatsThis (engineText);
+  gBoxLayout->addWidget (engine);
+
+
+  mBoxLayout->addWidget (gBox);
+
+
+  QGroupBox *wBox = new QGroupBox (tr ("Warm start"), this);
+  QHBoxLayout *wBoxLayout = new QHBoxLayout;
+  wBox->setLayout (wBoxLayout);
+  wBoxLayout->setSpacing (10);
+
+  warmResidual = new QDoubleSpinBox (this);
+  warmResidual->setDecimals (3);
+  warmResidual->setRange (0.0, 10.0);
+  warmResidual->setSingleStep (0.005);
+  warmResidual->setSpecialValueText (tr ("Off"));
+  warmResidual->setValue (options->warm_residual);
+  warmResidual->setWrapping (false);
+  warmResidual->setToolTip (tr ("Set the residual to stop at when starting from the PFM surface (multigrid only)"));
+  warmResidual->setWhatsThis (warmResidualText);
+  wBoxLayout->addWidget (warmResidual);
+
+
+  mBoxLayout->addWidget (wBox);
+
+
   QGroupBox *fBox = new QGroupBox (tr ("Weight factor"), this);
   QHBoxLayout *fBoxLayout = new QHBoxLayout;
   fBox->setLayout (fBoxLayout);
@@ -184,15 +240,145 @@ surfacePage::surfacePage (QWidget *parent, OPTIONS *op):
   mBoxLayout->addWidget (forceBox);
 
 
+  QGroupBox *tBox = new QGroupBox (tr ("Tiles"), this);
+  QHBoxLayout *tBoxLayout = new QHBoxLayout;
+  tBox->setLayout (tBoxLayout);
+  tBoxLayout->setSpacing (10);
+
+  tileSize = new QSpinBox (this);
+  tileSize->setRange (0, 100000);
+  tileSize->setSingleStep (100);
+  tileSize->setSpecialValueText (tr ("Off"));
+  tileSize->setValue (options->tile_size);
+  tileSize->setWrapping (false);
+  tileSize->setToolTip (tr ("Set the tile size (bins) for the parallel tiled solve"));
+  tileSize->setWhatsThis (tileSizeText);
+  tBoxLayout->addWidget (tileSize);
+
+  tileHalo = new QSpinBox (this);
+  tileHalo->setRange (0, 1000);
+  tileHalo->setSingleStep (4);
+  tileHalo->setValue (options->tile_halo);
+  tileHalo->setWrapping (false);
+  tileHalo->setToolTip (tr ("Set the tile overlap (bins)"));
+  tileHalo->setWhatsThis (tileHaloText);
+  tBoxLayout->addWidget (tileHalo);
+
+  mBoxLayout->addWidget (tBox);
+
+
+  QGroupBox *pBox = new QGroupBox (tr ("Point cache"), this);
+  QHBoxLayout *pBoxLayout = new QHBoxLayout;
+  pBox->setLayout (pBoxLayout);
+  pBoxLayout->setSpacing (10);
+
+  pointCache = new QCheckBox (this);
+  pointCache->setChecked (options->point_cache);
+  pointCache->setToolTip (tr ("Reuse the points read on the last run if the PFM hasn't changed"));
+  pointCache->setWhatsThis (pointCacheText);
+  pBoxLayout->addWidget (pointCache);
+
+  mBoxLayout->addWidget (pBox);
+
+
+  QGroupBox *bBox = new QGroupBox (tr ("Memory budget"), this);
+  QHBoxLayout *bBoxLayout = new QHBoxLayout;
+  bBox->setLayout (bBoxLayout);
+  bBoxLayout->setSpacing (10);
+
+  memoryBudget = new QSpinBox (this);
+  memoryBudget->setRange (0, 1048576);
+  memoryBudget->setSingleStep (1024);
+  memoryBudget->setSpecialValueText (tr ("No limit"));
+  memoryBudget->setSuffix (tr (" MB"));
+  memoryBudget->setValue (options->memory_budget);
+  memoryBudget->setWrapping (false);
+  memoryBudget->setToolTip (tr ("Set the memory budget (MB) for the grids and MISP"));
+  memoryBudget->setWhatsThis (memoryBudgetText);
+  bBoxLayout->addWidget (memoryBudget);
+
+  mBoxLayout->addWidget (bBox);
+
+
   vbox->addWidget (mBox);
 
 
+  QGroupBox *rBox = new QGroupBox (tr ("Bin reduction (all depths)"), this);
+  QHBoxLayout *rBoxLayout = new QHBoxLayout;
+  rBox->setLayout (rBoxLayout);
+  rBoxLayout->setSpacing (10);
+
+  reduce = new QComboBox (this);
+  reduce->setEditable (false);
+  reduce->addItem (tr ("None"));
+  reduce->addItem (tr ("Mean"));
+  reduce->addItem (tr ("Median"));
+  reduce->addItem (tr ("Trimmed mean"));
+  reduce->addItem (tr ("Stratified"));
+  reduce->setCurrentIndex (options->reduce);
+  reduce->setToolTip (tr ("Set the method used to reduce bins with a lot of soundings"));
+  reduce->setWhatsThis (reduceText);
+  rBoxLayout->addWidget (reduce);
+
+  reduceCap = new QSpinBox (this);
+  reduceCap->setRange (1, REDUCE_MAX_CAP);
+  reduceCap->setSingleStep (1);
+  reduceCap->setValue (options->reduce_cap);
+  reduceCap->setWrapping (false);
+  reduceCap->setToolTip (tr ("Set the number of soundings a bin can have before it is reduced"));
+  reduceCap->setWhatsThis (reduceCapText);
+  rBoxLayout->addWidget (reduceCap);
+
+
+  vbox->addWidget (rBox);
+
+
+  QGroupBox *eBox = new QGroupBox (tr ("Export grids"), this);
+  QHBoxLayout *eBoxLayout = new QHBoxLayout;
+  eBox->setLayout (eBoxLayout);
+  eBox->setWhatsThis (exportText);
+  eBoxLayout->setSpacing (10);
+
+  exportMin = new QCheckBox (tr ("Minimum Filtered Surface"), this);
+  exportMin->setChecked (options->export_mask & 1);
+  exportMin->setToolTip (tr ("Also write the minimum filtered MISP surface to PFM_FILE.misp_min.bil"));
+  exportMin->setWhatsThis (exportText);
+  eBoxLayout->addWidget (exportMin);
+
+  exportMax = new QCheckBox (tr ("Maximum Filtered Surface"), this);
+  exportMax->setChecked (options->export_mask & 2);
+  exportMax->setToolTip (tr ("Also write the maximum filtered MISP surface to PFM_FILE.misp_max.bil"));
+  exportMax->setWhatsThis (exportText);
+  eBoxLayout->addWidget (exportMax);
+
+  exportAll = new QCheckBox (tr ("All depths"), this);
+  exportAll->setChecked (options->export_mask & 4);
+  exportAll->setToolTip (tr ("Also write the all depths MISP surface to PFM_FILE.misp_all.bil"));
+  exportAll->setWhatsThis (exportText);
+  eBoxLayout->addWidget (exportAll);
+
+
+  vbox->addWidget (eBox);
+
+
   registerField ("nFlag", nFlag);
   registerField ("nibble", nibble);
   registerField ("replaceAll", replaceAll);
+  registerField ("holeFill", holeFill);
   registerField ("clearLand", clearLand);
+  registerField ("engine", engine, "currentIndex", "currentIndexChanged(int)");
+  registerField ("warmResidual", warmResidual, "value", "valueChanged(double)");
   registerField ("factor", factor);
   registerField ("force", force);
+  registerField ("tileSize", tileSize);
+  registerField ("tileHalo", tileHalo);
+  registerField ("pointCache", pointCache);
+  registerField ("memoryBudget", memoryBudget);
+  registerField ("reduce", reduce, "currentIndex", "currentIndexChanged(int)");
+  registerField ("reduceCap", reduceCap);
+  registerField ("exportMin", exportMin);
+  registerField ("exportMax", exportMax);
+  registerField ("exportAll", exportAll);
 }
 
 
@@ -60,9 +60,13 @@ protected:
 
   OPTIONS          *options;
 
-  QCheckBox        *replaceAll, *clearLand, *force, *nFlag;
+  QCheckBox        *replaceAll, *holeFill, *clearLand, *force, *nFlag, *pointCache, *exportMin, *exportMax, *exportAll;
 
-  QSpinBox         *nibble, *factor;
+  QSpinBox         *nibble, *factor, *tileSize, *tileHalo, *reduceCap, *memoryBudget;
+
+  QDoubleSpinBox   *warmResidual;
+
+  QComboBox        *reduce, *engine;
 
 
 protected slots:
@@ -76,7 +76,7 @@ QString nFlagText =
 
 QString nibbleText = 
   surfacePage::tr ("Set the cell distance for clearing interpolated data.  If you set the clear interpolated data flag "
-                   "you can set this value to a number between 0 and 20.  The value will be used to clear interpolated "
+                   "you can set this value to a number between 0 and 1000.  The value will be used to clear interpolated "
                    "bins that are a set distance from bins that contain data.  For example, if you set the value to 4 then any cell "
                    "that is not within 4 bins of a cell that contains data will be cleared after the surface has been "
                    "generated.  If the clear land flag is set and you set this value to 0, no empty bins will be interpolated.  ");
@@ -91,3 +91,102 @@ QString replaceAllText =
   surfacePage::tr ("Select this if you wish to replace all of the <b>Average Filtered/Edited Surface</b> bins with "
                    "MISP Surface data.  If this is not checked then only those bins that do not contain data will be "
                    "replaced.");
+
+QString holeFillText = 
+  surfacePage::tr ("Select this to solve each hole (each connected group of empty bins that is going to get an "
+                   "interpolated value) on its own small grid that includes a ring of the surrounding real data, "
+                   "instead of computing the MISP surface for the whole PFM.  The holes are solved in parallel.  For "
+                   "well covered surveys with scattered gaps this is much faster.  It only applies when "
+                   "<b>Replace all bins</b> is not checked and no other surfaces are being exported.  If the holes "
+                   "(and their rings) cover most of the PFM the whole surface is computed anyway.");
+
+QString engineText = 
+  surfacePage::tr ("Select the interpolator that is used to compute the surface:<br><br>"
+                   "<ul>"
+                   "<li><b>MISP</b> - the minimum curvature spline surface (the default).  This gives the smoothest "
+                   "surface and fills every gap but it is the slowest, especially on dense data.</li>"
+                   "<li><b>IDW</b> - inverse distance squared weighting of the nearest soundings to each bin (at "
+                   "least eight if there are that many in reach).  This uses all of the cores and is much faster than "
+                   "MISP on dense data.</li>"
+                   "<li><b>TIN</b> - linear interpolation in a Delaunay triangulation of the soundings.  This is also "
+                   "fast and honors the data exactly but the surface has creases along the triangle edges.</li>"
+                   "<li><b>Multigrid</b> - a minimum curvature surface (with a little tension) that is solved on a "
+                   "coarse grid first and then refined.  The surface is close to MISP's but the time grows about "
+                   "linearly with the size of the PFM and it uses all of the cores, so it is much faster than MISP on "
+                   "large PFMs.</li>"
+                   "</ul><br>"
+                   "IDW, TIN, and Multigrid don't reach more than the nibbling distance (or 64 bins) from the data, bins further "
+                   "away than that are set to the null depth.  The weight factor, force original value, and tiles "
+                   "options only apply to MISP.");
+
+QString warmResidualText = 
+  surfacePage::tr ("Set this to start the <b>Multigrid</b> engine from the surface that is already in the PFM (the "
+                   "average of each bin with data and the interpolated value of each bin from the last run) instead "
+                   "of solving from scratch.  The surface is then relaxed until no bin is further than this (in the "
+                   "depth units of the PFM) from what the minimum curvature surface through its neighbors says it "
+                   "should be.  After a small edit this only takes a handful of sweeps.  0.01 is a good place to "
+                   "start, smaller values take longer.  When this is <b>Off</b> the surface is solved from scratch.  "
+                   "It doesn't apply to the other engines.");
+
+QString tileSizeText = 
+  surfacePage::tr ("Set the tile size (in bins) for the tiled solve.  When this is <b>Off</b> the MISP surface is "
+                   "computed as a single grid over the entire PFM (on one core).  When it is set the PFM is split into "
+                   "tiles of this size that are gridded in parallel (one tile per core) and then feathered together "
+                   "over the tile overlap (see the halo).  Large PFMs should use a tile size of a few hundred to a few "
+                   "thousand bins.<br><br>"
+                   "<b>IMPORTANT NOTE: MISP can only solve one grid at a time in a process so the tiles are only "
+                   "gridded in parallel on Linux, where each one is solved in its own child process.  On other "
+                   "systems they're gridded one at a time.</b>");
+
+QString tileHaloText = 
+  surfacePage::tr ("Set the number of bins that each tile is extended on each side when it is gridded.  The "
+                   "overlapping areas of neighboring tiles are blended together so that there are no seams between "
+                   "tiles.  Larger values give a result closer to the single grid at the cost of more work per tile.  "
+                   "The halo can't be more than half of the tile size.");
+
+QString pointCacheText = 
+  surfacePage::tr ("Select this to save the points that are read from the PFM in a cache file next to the PFM list "
+                   "file (<b>PFM_FILE.misp_cache</b>).  If you run pfmMisp on the same PFM again with the same surface "
+                   "type the points will be loaded from the cache instead of being read from the PFM.  Only the weight "
+                   "factor, nibble, and other options can change, if the PFM has been modified by anything other than "
+                   "pfmMisp the cache is ignored and rebuilt.");
+
+QString memoryBudgetText = 
+  surfacePage::tr ("Set the most memory (in megabytes) that the grids and MISP should use.  When this is "
+                   "<b>No limit</b> everything is done in memory.  When it is set, the whole PFM sized grids that won't "
+                   "fit in half of the budget are kept in scratch files next to the PFM list file "
+                   "(<b>PFM_FILE.misp_scratch.XXXXXX</b>, removed when the run finishes) and the MISP surface is computed "
+                   "in tiles that fit in the other half, running fewer tiles at once if need be.  Use this for PFMs "
+                   "that are too large to grid in memory.  The tile size is only ever made smaller to fit the "
+                   "budget.");
+
+QString exportText = 
+  surfacePage::tr ("Select any surfaces that you would like written to grid files next to the PFM list file "
+                   "(<b>PFM_FILE.misp_min.bil</b>, <b>PFM_FILE.misp_max.bil</b>, and <b>PFM_FILE.misp_all.bil</b>) as "
+                   "well as the surface selected above (which is the one that goes into the PFM's "
+                   "<b>Average Filtered/Edited Surface</b>).  The depth records are only read once for all of the "
+                   "surfaces and the surfaces are gridded at the same time.  The grids are 32 bit float ESRI BIL files "
+                   "(with .hdr and .prj files) that can be converted to GeoTIFF with gdal_translate.  The same "
+                   "nibbling and land clearing is applied to the grid files as to the PFM.  The point cache is not "
+                   "used when exporting other surfaces.");
+
+QString reduceText = 
+  surfacePage::tr ("Select how bins with a lot of soundings are reduced before they are gridded when the surface type "
+                   "is <b>All depths</b>.  Bins with no more valid soundings than the reduction limit are loaded as "
+                   "they are.  Larger bins are reduced to:<br><br>"
+                   "<ul>"
+                   "<li><b>Mean</b> - one point, the mean depth at the mean position of the soundings</li>"
+                   "<li><b>Median</b> - one point, the median depth at the mean position</li>"
+                   "<li><b>Trimmed mean</b> - one point, the mean depth after dropping the shoalest and deepest 10 "
+                   "percent of the soundings, at the mean position</li>"
+                   "<li><b>Stratified</b> - the bin is split into a square grid of at most <b>limit</b> cells and "
+                   "each cell that has soundings gets one point at the mean position and depth of its soundings</li>"
+                   "</ul><br>"
+                   "Dense multibeam or lidar bins can hold thousands of soundings that don't add anything to a "
+                   "surface at the bin size but use a lot of memory and time in MISP.  The number of points removed "
+                   "is shown when the data has been read.");
+
+QString reduceCapText = 
+  surfacePage::tr ("Set the reduction limit.  Bins with more valid soundings than this are reduced (see the bin "
+                   "reduction method).  For the <b>Stratified</b> method this is also the largest number of points a "
+                   "bin is reduced to.");
@@ -0,0 +1,73 @@
+
+/*********************************************************************************************
+
+    This is public domain software that was developed by or for the U.S. Naval Oceanographic
+    Office and/or the U.S. Army Corps of Engineers.
+
+    This is a work of the U.S. Government. In accordance with 17 USC 105, copyright protection
+    is not available for any work of the U.S. Government.
+
+    Neither the United States Government, nor any employees of the United States Government,
+    nor the author, makes any warranty, express or implied, without even the implied warranty
+    of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE, or assumes any liability or
+    responsibility for the accuracy, completeness, or usefulness of any information,
+    apparatus, product, or process disclosed, or represents that its use would not infringe
+    privately-owned rights. Reference herein to any specific commercial products, process,
+    or service by trade name, trademark, manufacturer, or otherwise, does not necessarily
+    constitute or imply its endorsement, recommendation, or favoring by the United States
+    Government. The views and opinions of authors expressed herein do not necessarily state
+    or reflect those of the United States Government, and shall not be used for advertising
+    or product endorsement purposes.
+*********************************************************************************************/
+
+
+/****************************************  IMPORTANT NOTE  **********************************
+
+    Comments in this file that start with / * ! or / / ! are being used by Doxygen to
+    document the software.  Dashes in these comment blocks are used to create bullet lists.
+    The lack of blank lines after a block of dash preceeded comments means that the next
+    block of dash preceeded comments is a new, indented bullet list.  I've tried to keep the
+    Doxygen formatting to a minimum but there are some other items (like <br> and <pre>)
+    that need to be left alone.  If you see a comment that starts with / * ! or / / ! and
+    there is something that looks a bit weird it is probably due to some arcane Doxygen
+    syntax.  Be very careful modifying blocks of Doxygen comments.
+
+*****************************************  IMPORTANT NOTE  **********************************/
+
+
+
+#include "surface_engine.hpp"
+#include "solve_surface.hpp"
+#include "idw_engine.hpp"
+#include "tin_engine.hpp"
+#include "multigrid_engine.hpp"
+
+
+SURFACE_ENGINE surface_engines[ENGINE_COUNT] = {{"misp", QT_TRANSLATE_NOOP ("pfmMisp", "MISP"), NVTrue, misp_solve},
+                                                {"idw", QT_TRANSLATE_NOOP ("pfmMisp", "IDW"), NVFalse, idw_solve},
+                                                {"tin", QT_TRANSLATE_NOOP ("pfmMisp", "TIN"), NVFalse, tin_solve},
+                                                {"multigrid", QT_TRANSLATE_NOOP ("pfmMisp", "Multigrid"), NVFalse,
+                                                 multigrid_solve}};
+
+
+
+//  Returns the engine with the command line name "name" or -1 if there isn't one.
+
+int32_t find_surface_engine (const char *name)
+{
+  for (int32_t e = 0 ; e < ENGINE_COUNT ; e++) if (!strcmp (name, surface_engines[e].name)) return (e);
+
+  return (-1);
+}
+
+
+
+/*  How far (in bins) IDW, TIN, and multigrid will reach from the data.  Bins further than the nibbling distance from
+    data are going to be cleared anyway so there's no point in looking past it.  */
+
+int32_t engine_reach (OPTIONS *options)
+{
+  if (options->clear_int && options->nibble) return (MIN (options->nibble + 1, ENGINE_MAX_REACH));
+
+  return (ENGINE_MAX_REACH);
+}
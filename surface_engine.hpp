@@ -0,0 +1,97 @@
+
+/*********************************************************************************************
+
+    This is public domain software that was developed by or for the U.S. Naval Oceanographic
+    Office and/or the U.S. Army Corps of Engineers.
+
+    This is a work of the U.S. Government. In accordance with 17 USC 105, copyright protection
+    is not available for any work of the U.S. Government.
+
+    Neither the United States Government, nor any employees of the United States Government,
+    nor the author, makes any warranty, express or implied, without even the implied warranty
+    of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE, or assumes any liability or
+    responsibility for the accuracy, completeness, or usefulness of any information,
+    apparatus, product, or process disclosed, or represents that its use would not infringe
+    privately-owned rights. Reference herein to any specific commercial products, process,
+    or service by trade name, trademark, manufacturer, or otherwise, does not necessarily
+    constitute or imply its endorsement, recommendation, or favoring by the United States
+    Government. The views and opinions of authors expressed herein do not necessarily state
+    or reflect those of the United States Government, and shall not be used for advertising
+    or product endorsement purposes.
+*********************************************************************************************/
+
+
+/****************************************  IMPORTANT NOTE  **********************************
+
+    Comments in this file that start with / * ! or / / ! are being used by Doxygen to
+    document the software.  Dashes in these comment blocks are used to create bullet lists.
+    The lack of blank lines after a block of dash preceeded comments means that the next
+    block of dash preceeded comments is a new, indented bullet list.  I've tried to keep the
+    Doxygen formatting to a minimum but there are some other items (like <br> and <pre>)
+    that need to be left alone.  If you see a comment that starts with / * ! or / / ! and
+    there is something that looks a bit weird it is probably due to some arcane Doxygen
+    syntax.  Be very careful modifying blocks of Doxygen comments.
+
+*****************************************  IMPORTANT NOTE  **********************************/
+
+
+
+#ifndef SURFACE_ENGINE_H
+#define SURFACE_ENGINE_H
+
+#include "pfmMispDef.hpp"
+
+#include <cmath>
+
+
+/*  The interpolators that can be used to grid the surface.  MISP is the original (and default) one.  The others are
+    much faster on dense data but don't give MISP's smooth surface.  options->engine is an index into
+    surface_engines.  */
+
+#define         ENGINE_MISP             0          /* Minimum curvature spline (libmisp) */
+#define         ENGINE_IDW              1          /* Inverse distance weighting (see idw_engine) */
+#define         ENGINE_TIN              2          /* Linear interpolation in a Delaunay TIN (see tin_engine) */
+#define         ENGINE_MULTIGRID        3          /* Coarse to fine minimum curvature (see multigrid_engine) */
+
+#define         ENGINE_COUNT            4
+
+#define         ENGINE_MAX_REACH        64         /* Furthest (bins) IDW, TIN, and multigrid reach without nibbling */
+
+
+/*  solve grids the (x1 - x0) by (y1 - y0) part of the grid starting at bin x0, y0 from the points in index (all of the
+    points if index is NULL) and puts it in "out".  Anything it couldn't grid is left as NaN.  If callbacks is NULL it
+    runs in the calling thread without reporting progress (tiles and holes), otherwise it can use the row band threads.
+    It returns 0, -1 if it failed, or RUN_CANCELLED.  If global_state is set the engine keeps its state in static
+    memory so only one solve can run in a process at a time (see solve_surface).  */
+
+typedef struct
+{
+  const char          *name;                      //  Command line and report name
+  const char          *title;                     //  Name shown in the GUI (translated in the "pfmMisp" context)
+  uint8_t             global_state;
+  int32_t             (*solve) (POINT_BUFFER *points, int64_t *index, int64_t count, int32_t x0, int32_t y0,
+                                int32_t x1, int32_t y1, OPTIONS *options, RUN_CALLBACKS *callbacks, float *out);
+} SURFACE_ENGINE;
+
+
+extern SURFACE_ENGINE surface_engines[ENGINE_COUNT];
+
+
+/*  Node j, i of an engine's grid is at x0 + j, y0 + i in bin units, the lower left corner of the bin, because that's
+    where MISP puts it (misp_init is given the area's corner as the MBR and a grid interval of one bin).  Every engine
+    uses this so switching engines doesn't shift the surface by half a bin.  A point goes to its nearest node (the
+    last node for points in the far half of the last bin), -1 if it isn't in the origin to origin + size bins.  */
+
+static inline int32_t nearest_node (double v, int32_t origin, int32_t size)
+{
+  if (v < (double) origin || v >= (double) (origin + size)) return (-1);
+
+  return (MIN ((int32_t) floor (v + 0.5) - origin, size - 1));
+}
+
+
+int32_t find_surface_engine (const char *name);
+int32_t engine_reach (OPTIONS *options);
+
+
+#endif
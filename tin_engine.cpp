@@ -0,0 +1,672 @@
+
+/*********************************************************************************************
+
+    This is public domain software that was developed by or for the U.S. Naval Oceanographic
+    Office and/or the U.S. Army Corps of Engineers.
+
+    This is a work of the U.S. Government. In accordance with 17 USC 105, copyright protection
+    is not available for any work of the U.S. Government.
+
+    Neither the United States Government, nor any employees of the United States Government,
+    nor the author, makes any warranty, express or implied, without even the implied warranty
+    of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE, or assumes any liability or
+    responsibility for the accuracy, completeness, or usefulness of any information,
+    apparatus, product, or process disclosed, or represents that its use would not infringe
+    privately-owned rights. Reference herein to any specific commercial products, process,
+    or service by trade name, trademark, manufacturer, or otherwise, does not necessarily
+    constitute or imply its endorsement, recommendation, or favoring by the United States
+    Government. The views and opinions of authors expressed herein do not necessarily state
+    or reflect those of the United States Government, and shall not be used for advertising
+    or product endorsement purposes.
+*********************************************************************************************/
+
+
+/****************************************  IMPORTANT NOTE  **********************************
+
+    Comments in this file that start with / * ! or / / ! are being used by Doxygen to
+    document the software.  Dashes in these comment blocks are used to create bullet lists.
+    The lack of blank lines after a block of dash preceeded comments means that the next
+    block of dash preceeded comments is a new, indented bullet list.  I've tried to keep the
+    Doxygen formatting to a minimum but there are some other items (like <br> and <pre>)
+    that need to be left alone.  If you see a comment that starts with / * ! or / / ! and
+    there is something that looks a bit weird it is probably due to some arcane Doxygen
+    syntax.  Be very careful modifying blocks of Doxygen comments.
+
+*****************************************  IMPORTANT NOTE  **********************************/
+
+
+
+#include "tin_engine.hpp"
+#include "surface_engine.hpp"
+#include "run_bands.hpp"
+
+#include <cmath>
+#include <algorithm>
+
+
+#define         TIN_EDGE_STACK          512        /* Edges waiting to be checked by legalize */
+
+
+/*  Delaunay triangulation by sweeping a convex hull out from a seed triangle (the delaunator algorithm).  The points
+    are added in order of distance from the seed's circumcenter, each one is joined to the hull edges it can see, and
+    the new triangles are flipped until they're Delaunay.  Triangle t is vertices triangle[3 * t] through
+    triangle[3 * t + 2] (counter-clockwise), halfedge[e] is the matching edge in the neighboring triangle or -1 on the
+    hull.  The hull hash finds a hull edge near a new point by pseudo angle around the center.  */
+
+typedef struct
+{
+  double              *x, *y;                     //  Point coordinates (bin units)
+  int32_t             count;
+  int32_t             *triangle;
+  int32_t             *halfedge;
+  int64_t             edges;                      //  3 * number of triangles
+  int32_t             *hull_prev, *hull_next, *hull_tri, *hull_hash;
+  int32_t             hull_start, hash_size;
+  double              cx, cy;
+} TIN;
+
+
+
+static double dist2 (double ax, double ay, double bx, double by)
+{
+  double dx = ax - bx;
+  double dy = ay - by;
+
+  return (dx * dx + dy * dy);
+}
+
+
+
+//  NVTrue if r is to the right of p->q (so p, q, r is clockwise).
+
+static uint8_t orient (double px, double py, double qx, double qy, double rx, double ry)
+{
+  return ((qy - py) * (rx - qx) - (qx - px) * (ry - qy) < 0.0);
+}
+
+
+
+static uint8_t in_circle (double ax, double ay, double bx, double by, double cx, double cy, double px, double py)
+{
+  double dx = ax - px, dy = ay - py;
+  double ex = bx - px, ey = by - py;
+  double fx = cx - px, fy = cy - py;
+
+  double ap = dx * dx + dy * dy;
+  double bp = ex * ex + ey * ey;
+  double cp = fx * fx + fy * fy;
+
+  return (dx * (ey * cp - bp * fy) - dy * (ex * cp - bp * fx) + ap * (ex * fy - ey * fx) < 0.0);
+}
+
+
+
+//  Circumcenter of a, b, c relative to a.  Returns NVFalse if they're collinear.
+
+static uint8_t circum_offset (double ax, double ay, double bx, double by, double cx, double cy, double *x, double *y)
+{
+  double dx = bx - ax, dy = by - ay;
+  double ex = cx - ax, ey = cy - ay;
+
+  double bl = dx * dx + dy * dy;
+  double cl = ex * ex + ey * ey;
+  double det = dx * ey - dy * ex;
+
+  if (det == 0.0) return (NVFalse);
+
+  double d = 0.5 / det;
+
+  *x = (ey * bl - dy * cl) * d;
+  *y = (dx * cl - ex * bl) * d;
+
+  return (NVTrue);
+}
+
+
+
+//  Increases with the angle of (dx, dy) but doesn't need any trig, 0 to 1.
+
+static double pseudo_angle (double dx, double dy)
+{
+  if (dx == 0.0 && dy == 0.0) return (0.0);
+
+  double p = dx / (fabs (dx) + fabs (dy));
+
+  return ((dy > 0.0 ? 3.0 - p : 1.0 + p) / 4.0);
+}
+
+
+
+static int32_t hash_key (TIN *tin, double x, double y)
+{
+  return ((int32_t) floor (pseudo_angle (x - tin->cx, y - tin->cy) * tin->hash_size) % tin->hash_size);
+}
+
+
+
+static void link_edges (TIN *tin, int64_t a, int64_t b)
+{
+  tin->halfedge[a] = (int32_t) b;
+  if (b != -1) tin->halfedge[b] = (int32_t) a;
+}
+
+
+
+static int64_t add_triangle (TIN *tin, int32_t i0, int32_t i1, int32_t i2, int64_t a, int64_t b, int64_t c)
+{
+  int64_t t = tin->edges;
+
+  tin->triangle[t] = i0;
+  tin->triangle[t + 1] = i1;
+  tin->triangle[t + 2] = i2;
+
+  link_edges (tin, t, a);
+  link_edges (tin, t + 1, b);
+  link_edges (tin, t + 2, c);
+
+  tin->edges += 3;
+
+  return (t);
+}
+
+
+
+//  Flips edge a (and the edges that flipping it affects) until they're all Delaunay.  Returns the edge that ends up
+//  across from the new point.
+
+static int64_t legalize (TIN *tin, int64_t a)
+{
+  int64_t             stack[TIN_EDGE_STACK], ar;
+  int32_t             i = 0;
+
+
+  while (NVTrue)
+    {
+      int64_t b = tin->halfedge[a];
+      int64_t a0 = a - a % 3;
+
+      ar = a0 + (a + 2) % 3;
+
+      if (b == -1)
+        {
+          if (!i) break;
+          a = stack[--i];
+          continue;
+        }
+
+      int64_t b0 = b - b % 3;
+      int64_t al = a0 + (a + 1) % 3;
+      int64_t bl = b0 + (b + 2) % 3;
+
+      int32_t p0 = tin->triangle[ar];
+      int32_t pr = tin->triangle[a];
+      int32_t pl = tin->triangle[al];
+      int32_t p1 = tin->triangle[bl];
+
+      if (in_circle (tin->x[p0], tin->y[p0], tin->x[pr], tin->y[pr], tin->x[pl], tin->y[pl], tin->x[p1], tin->y[p1]))
+        {
+          tin->triangle[a] = p1;
+          tin->triangle[b] = p0;
+
+          int64_t hbl = tin->halfedge[bl];
+
+
+          //  The edge was swapped on the other side of the hull (rare), fix the hull's triangle reference.
+
+          if (hbl == -1)
+            {
+              int32_t e = tin->hull_start;
+
+              do
+                {
+                  if (tin->hull_tri[e] == bl)
+                    {
+                      tin->hull_tri[e] = (int32_t) a;
+                      break;
+                    }
+
+                  e = tin->hull_prev[e];
+                } while (e != tin->hull_start);
+            }
+
+          link_edges (tin, a, hbl);
+          link_edges (tin, b, tin->halfedge[ar]);
+          link_edges (tin, ar, bl);
+
+
+          //  Only extremely degenerate input could fill the stack.
+
+          if (i < TIN_EDGE_STACK) stack[i++] = b0 + (b + 1) % 3;
+        }
+      else
+        {
+          if (!i) break;
+          a = stack[--i];
+        }
+    }
+
+  return (ar);
+}
+
+
+
+//  Triangulates tin->count points.  Returns NVFalse if there aren't three points that aren't in a line.
+
+static uint8_t triangulate (TIN *tin)
+{
+  int32_t             i0 = -1, i1 = -1, i2 = -1, *ids;
+  double              min_x = 1.0e300, min_y = 1.0e300, max_x = -1.0e300, max_y = -1.0e300, *dists;
+
+
+  int32_t n = tin->count;
+
+  if (n < 3) return (NVFalse);
+
+  for (int32_t i = 0 ; i < n ; i++)
+    {
+      min_x = MIN (min_x, tin->x[i]);
+      min_y = MIN (min_y, tin->y[i]);
+      max_x = MAX (max_x, tin->x[i]);
+      max_y = MAX (max_y, tin->y[i]);
+    }
+
+  double center_x = (min_x + max_x) * 0.5;
+  double center_y = (min_y + max_y) * 0.5;
+
+
+  //  The seed triangle is the point closest to the center, the point closest to that, and the point that makes the
+  //  smallest circumcircle with them.
+
+  double min_dist = 1.0e300;
+
+  for (int32_t i = 0 ; i < n ; i++)
+    {
+      double d = dist2 (center_x, center_y, tin->x[i], tin->y[i]);
+      if (d < min_dist)
+        {
+          i0 = i;
+          min_dist = d;
+        }
+    }
+
+  min_dist = 1.0e300;
+
+  for (int32_t i = 0 ; i < n ; i++)
+    {
+      if (i == i0) continue;
+
+      double d = dist2 (tin->x[i0], tin->y[i0], tin->x[i], tin->y[i]);
+      if (d < min_dist && d > 0.0)
+        {
+          i1 = i;
+          min_dist = d;
+        }
+    }
+
+  if (i1 < 0) return (NVFalse);
+
+  double min_radius = 1.0e300;
+
+  for (int32_t i = 0 ; i < n ; i++)
+    {
+      double x, y;
+
+      if (i == i0 || i == i1) continue;
+
+      if (!circum_offset (tin->x[i0], tin->y[i0], tin->x[i1], tin->y[i1], tin->x[i], tin->y[i], &x, &y)) continue;
+
+      double r = x * x + y * y;
+      if (r < min_radius)
+        {
+          i2 = i;
+          min_radius = r;
+        }
+    }
+
+  if (i2 < 0) return (NVFalse);
+
+
+  //  Counter-clockwise.
+
+  if (orient (tin->x[i0], tin->y[i0], tin->x[i1], tin->y[i1], tin->x[i2], tin->y[i2]))
+    {
+      int32_t i = i1;
+      i1 = i2;
+      i2 = i;
+    }
+
+  double ox, oy;
+
+  circum_offset (tin->x[i0], tin->y[i0], tin->x[i1], tin->y[i1], tin->x[i2], tin->y[i2], &ox, &oy);
+
+  tin->cx = tin->x[i0] + ox;
+  tin->cy = tin->y[i0] + oy;
+
+
+  //  Add the points in order of distance from the seed circumcenter.
+
+  ids = (int32_t *) malloc (n * sizeof (int32_t));
+  dists = (double *) malloc (n * sizeof (double));
+
+  tin->hash_size = MAX ((int32_t) ceil (sqrt ((double) n)), 1);
+
+  tin->hull_prev = (int32_t *) malloc (n * sizeof (int32_t));
+  tin->hull_next = (int32_t *) malloc (n * sizeof (int32_t));
+  tin->hull_tri = (int32_t *) malloc (n * sizeof (int32_t));
+  tin->hull_hash = (int32_t *) malloc (tin->hash_size * sizeof (int32_t));
+
+  int64_t max_edges = (int64_t) MAX (2 * n - 5, 1) * 3;
+
+  tin->triangle = (int32_t *) malloc (max_edges * sizeof (int32_t));
+  tin->halfedge = (int32_t *) malloc (max_edges * sizeof (int32_t));
+
+  if (ids == NULL || dists == NULL || tin->hull_prev == NULL || tin->hull_next == NULL || tin->hull_tri == NULL ||
+      tin->hull_hash == NULL || tin->triangle == NULL || tin->halfedge == NULL)
+    {
+      perror ("Allocating TIN");
+      exit (-1);
+    }
+
+  for (int32_t i = 0 ; i < n ; i++)
+    {
+      ids[i] = i;
+      dists[i] = dist2 (tin->x[i], tin->y[i], tin->cx, tin->cy);
+    }
+
+  std::sort (ids, ids + n, [dists] (int32_t a, int32_t b) {return (dists[a] < dists[b]);});
+
+  free (dists);
+
+
+  //  The seed triangle is the starting hull.
+
+  tin->hull_start = i0;
+
+  tin->hull_next[i0] = tin->hull_prev[i2] = i1;
+  tin->hull_next[i1] = tin->hull_prev[i0] = i2;
+  tin->hull_next[i2] = tin->hull_prev[i1] = i0;
+
+  tin->hull_tri[i0] = 0;
+  tin->hull_tri[i1] = 1;
+  tin->hull_tri[i2] = 2;
+
+  for (int32_t h = 0 ; h < tin->hash_size ; h++) tin->hull_hash[h] = -1;
+
+  tin->hull_hash[hash_key (tin, tin->x[i0], tin->y[i0])] = i0;
+  tin->hull_hash[hash_key (tin, tin->x[i1], tin->y[i1])] = i1;
+  tin->hull_hash[hash_key (tin, tin->x[i2], tin->y[i2])] = i2;
+
+  tin->edges = 0;
+  add_triangle (tin, i0, i1, i2, -1, -1, -1);
+
+
+  double xp = 0.0, yp = 0.0;
+
+  for (int32_t k = 0 ; k < n ; k++)
+    {
+      int32_t i = ids[k];
+      double x = tin->x[i], y = tin->y[i];
+
+
+      //  Skip (near) duplicates and the seed points.
+
+      if (k > 0 && fabs (x - xp) <= 1.0e-12 && fabs (y - yp) <= 1.0e-12) continue;
+
+      xp = x;
+      yp = y;
+
+      if (i == i0 || i == i1 || i == i2) continue;
+
+
+      //  Find an edge of the hull that the point can see.
+
+      int32_t start = 0, key = hash_key (tin, x, y);
+
+      for (int32_t j = 0 ; j < tin->hash_size ; j++)
+        {
+          start = tin->hull_hash[(key + j) % tin->hash_size];
+          if (start != -1 && start != tin->hull_next[start]) break;
+        }
+
+      start = tin->hull_prev[start];
+
+      int32_t e = start, q;
+
+      while (q = tin->hull_next[e], !orient (x, y, tin->x[e], tin->y[e], tin->x[q], tin->y[q]))
+        {
+          e = q;
+          if (e == start)
+            {
+              e = -1;
+              break;
+            }
+        }
+
+      if (e == -1) continue;
+
+
+      //  The first triangle from the point, then walk forward and backward along the hull adding triangles.
+
+      int64_t t = add_triangle (tin, e, i, tin->hull_next[e], -1, -1, tin->hull_tri[e]);
+
+      tin->hull_tri[i] = (int32_t) legalize (tin, t + 2);
+      tin->hull_tri[e] = (int32_t) t;
+
+      int32_t next = tin->hull_next[e];
+
+      while (q = tin->hull_next[next], orient (x, y, tin->x[next], tin->y[next], tin->x[q], tin->y[q]))
+        {
+          t = add_triangle (tin, next, i, q, tin->hull_tri[i], -1, tin->hull_tri[next]);
+          tin->hull_tri[i] = (int32_t) legalize (tin, t + 2);
+          tin->hull_next[next] = next;
+          next = q;
+        }
+
+      if (e == start)
+        {
+          while (q = tin->hull_prev[e], orient (x, y, tin->x[q], tin->y[q], tin->x[e], tin->y[e]))
+            {
+              t = add_triangle (tin, q, i, e, -1, tin->hull_tri[e], tin->hull_tri[q]);
+              legalize (tin, t + 2);
+              tin->hull_tri[q] = (int32_t) t;
+              tin->hull_next[e] = e;
+              e = q;
+            }
+        }
+
+      tin->hull_start = tin->hull_prev[i] = e;
+      tin->hull_next[e] = tin->hull_prev[next] = i;
+      tin->hull_next[i] = next;
+
+      tin->hull_hash[hash_key (tin, x, y)] = i;
+      tin->hull_hash[hash_key (tin, tin->x[e], tin->y[e])] = e;
+    }
+
+
+  free (ids);
+  free (tin->hull_prev);
+  free (tin->hull_next);
+  free (tin->hull_tri);
+  free (tin->hull_hash);
+
+
+  return (NVTrue);
+}
+
+
+
+typedef struct
+{
+  TIN                 *tin;
+  double              *z;
+  int32_t             x0, y0, width, height;
+  double              max_edge2;                  //  Triangles with a longer edge (squared) are left out
+  float               *out;
+  BAND_STATUS         status;
+} TIN_ARGS;
+
+
+
+/*  Interpolates the triangles in band "band" (triangles start_tri to end_tri - 1) at the grid nodes inside them.  The
+    neighboring triangles agree on the shared edges so it doesn't matter which one writes a node on the edge.  */
+
+static void tin_triangles (int32_t band __attribute__ ((unused)), int32_t start_tri, int32_t end_tri, void *data)
+{
+  TIN_ARGS *args = (TIN_ARGS *) data;
+  TIN *tin = args->tin;
+
+
+  for (int32_t t = start_tri ; t < end_tri ; t++)
+    {
+      if (args->status.cancel) break;
+
+      int32_t a = tin->triangle[3 * (int64_t) t];
+      int32_t b = tin->triangle[3 * (int64_t) t + 1];
+      int32_t c = tin->triangle[3 * (int64_t) t + 2];
+
+      double ax = tin->x[a], ay = tin->y[a];
+      double bx = tin->x[b], by = tin->y[b];
+      double cx = tin->x[c], cy = tin->y[c];
+
+      args->status.rows_done++;
+
+      if (dist2 (ax, ay, bx, by) > args->max_edge2 || dist2 (bx, by, cx, cy) > args->max_edge2 ||
+          dist2 (cx, cy, ax, ay) > args->max_edge2) continue;
+
+      double det = (by - cy) * (ax - cx) + (cx - bx) * (ay - cy);
+
+      if (det == 0.0) continue;
+
+
+      //  Grid nodes (x0 + j, y0 + i, see nearest_node) inside the triangle's bounding box.
+
+      int32_t j0 = MAX ((int32_t) ceil (MIN (ax, MIN (bx, cx))) - args->x0, 0);
+      int32_t j1 = MIN ((int32_t) floor (MAX (ax, MAX (bx, cx))) - args->x0, args->width - 1);
+      int32_t i0 = MAX ((int32_t) ceil (MIN (ay, MIN (by, cy))) - args->y0, 0);
+      int32_t i1 = MIN ((int32_t) floor (MAX (ay, MAX (by, cy))) - args->y0, args->height - 1);
+
+      for (int32_t i = i0 ; i <= i1 ; i++)
+        {
+          double py = (double) (args->y0 + i);
+
+          for (int32_t j = j0 ; j <= j1 ; j++)
+            {
+              double px = (double) (args->x0 + j);
+
+              double wa = ((by - cy) * (px - cx) + (cx - bx) * (py - cy)) / det;
+              double wb = ((cy - ay) * (px - cx) + (ax - cx) * (py - cy)) / det;
+              double wc = 1.0 - wa - wb;
+
+              if (wa < -1.0e-9 || wb < -1.0e-9 || wc < -1.0e-9) continue;
+
+              args->out[(int64_t) i * args->width + j] = (float) (wa * args->z[a] + wb * args->z[b] + wc * args->z[c]);
+            }
+        }
+    }
+}
+
+
+
+/***************************************************************************\
+*                                                                           *
+*   Module Name:        tin_solve                                           *
+*                                                                           *
+*   Purpose:            Delaunay TIN engine (see surface_engine).  The      *
+*                       points are triangulated and each grid node gets     *
+*                       the linear interpolation of the triangle it's in.   *
+*                       Triangles with an edge longer than twice            *
+*                       engine_reach are left out so the TIN doesn't        *
+*                       bridge big gaps in the data.  For duplicate         *
+*                       positions only one of the depths is used.  For the  *
+*                       whole grid the triangles are interpolated in the    *
+*                       row band threads.                                   *
+*                                                                           *
+*   Arguments:          See SURFACE_ENGINE in surface_engine.hpp            *
+*                                                                           *
+*   Returns:            0 or RUN_CANCELLED                                  *
+*                                                                           *
+\***************************************************************************/
+
+int32_t tin_solve (POINT_BUFFER *points, int64_t *index, int64_t count, int32_t x0, int32_t y0, int32_t x1, int32_t y1,
+                   OPTIONS *options, RUN_CALLBACKS *callbacks, float *out)
+{
+  TIN                 tin;
+  TIN_ARGS            args;
+  uint8_t             cancelled = NVFalse;
+
+
+  args.width = x1 - x0;
+  args.height = y1 - y0;
+
+  for (int64_t k = 0 ; k < (int64_t) args.width * args.height ; k++) out[k] = NAN;
+
+  if (count > INT32_MAX / 2)
+    {
+      if (callbacks) callbacks->message (QCoreApplication::translate ("pfmMisp", "Too many points for a TIN"));
+      return (-1);
+    }
+
+
+  //  The triangulation wants its own packed copy of the points.
+
+  tin.count = (int32_t) count;
+  tin.x = (double *) malloc (MAX (count, 1) * 3 * sizeof (double));
+
+  if (tin.x == NULL)
+    {
+      perror ("Allocating TIN points");
+      exit (-1);
+    }
+
+  tin.y = tin.x + count;
+  args.z = tin.y + count;
+
+  for (int64_t n = 0 ; n < count ; n++)
+    {
+      int64_t p = index ? index[n] : n;
+
+      tin.x[n] = points->x[p];
+      tin.y[n] = points->y[p];
+      args.z[n] = points->z[p];
+    }
+
+
+  if (callbacks) callbacks->phase (QCoreApplication::translate ("pfmMisp", "Triangulating %1 points").arg ((qlonglong) count), 0);
+
+  if (!triangulate (&tin))
+    {
+      free (tin.x);
+      return (0);
+    }
+
+
+  int32_t triangles = (int32_t) (tin.edges / 3);
+  double reach = 2.0 * engine_reach (options);
+
+  args.tin = &tin;
+  args.x0 = x0;
+  args.y0 = y0;
+  args.max_edge2 = reach * reach;
+  args.out = out;
+
+  if (callbacks)
+    {
+      callbacks->phase (QCoreApplication::translate ("pfmMisp", "Generating TIN surface"), triangles);
+
+      cancelled = run_bands (triangles, band_count (triangles), tin_triangles, &args, &args.status, callbacks);
+    }
+  else
+    {
+      args.status.cancel = false;
+
+      tin_triangles (0, 0, triangles, &args);
+    }
+
+
+  free (tin.triangle);
+  free (tin.halfedge);
+  free (tin.x);
+
+
+  return (cancelled ? RUN_CANCELLED : 0);
+}
@@ -39,7 +39,7 @@
 
 #ifndef VERSION
 
-#define     VERSION     "PFM Software - pfmMisp V4.14 - 05/24/19"
+#define     VERSION     "PFM Software - pfmMisp V4.56 - 10/17/26"
 
 #endif
 
@@ -326,4 +326,385 @@
 
     - Now uses PFM_USER_10 (PFMv7) instead of PFM_USER_05 (as if anybody is using this program ;-)
 
+
+    Version 4.15
+    PFM Software
+    10/16/26
+
+    - Moved the processing out of the wizard into misp_surface so that it doesn't touch any widgets.
+    - Added a headless batch mode (pfmMisp --batch PFM_FILE ...) that writes machine readable progress to stdout.
+
+
+    Version 4.16
+    PFM Software
+    10/16/26
+
+    - The processing now runs in a worker thread (mispWorker) and reports progress through queued signals instead
+      of calling processEvents for every row.  The Cancel button now stops the run between rows.
+
+
+    Version 4.17
+    PFM Software
+    10/16/26
+
+    - Depth records are now read in parallel row bands (one PFM handle and point buffer per band).  The bands are
+      loaded into MISP in row order so the surface is the same as the serial read.
+
+
+    Version 4.18
+    PFM Software
+    10/16/26
+
+    - Added an optional tiled solve.  The grid is split into tiles with an overlapping halo that are gridded in
+      parallel (forked MISP processes on Linux since libmisp isn't reentrant) and feathered together over the
+      overlap.  Batch mode --check-tiles compares the result to the single grid.
+
+
+    Version 4.19
+    PFM Software
+    10/16/26
+
+    - Replaced the nibbler's (2n + 1) squared window search with two separable sliding window passes (rows, then
+      columns) run in parallel bands.  The cost no longer depends on the nibble distance so the limit on the nibble
+      value has been raised from 20 to 1000.  The nibbler also uses one byte per bin instead of a full validity word.
+
+
+    Version 4.20
+    PFM Software
+    10/16/26
+
+    - Ingest now saves the state of every bin (data, interpolated, land masked, has soundings) in a bit packed raster
+      (bin_raster) that the write back passes share.  The retrieval pass only reads the bin records that it is going
+      to change, the nibbler no longer re-reads the validity of every bin and works on 64 bins at a time, and the
+      nibble and land clearing passes only write validity to bins that are actually interpolated.
+
+
+    Version 4.21
+    PFM Software
+    10/16/26
+
+    - The retrieval, nibbling, and SRTM land clearing passes have been fused into one sweep of the bin file
+      (write_surface).  The final state of each bin is worked out from the bin raster so each bin is read and
+      written at most once.  The nibble distance is now computed before anything is written so a cancel during
+      nibbling leaves the PFM untouched.
+
+
+    Version 4.22
+    PFM Software
+    10/16/26
+
+    - Bin records are now read a row at a time (read_bin_row) during ingest and the surface write.  Writes are
+      queued in a reusable row buffer (bin_row) and flushed once per row.
+
+
+    Version 4.23
+    PFM Software
+    10/16/26
+
+    - Added a point cache (PFM_FILE.misp_cache).  The normalized points and the bin raster from ingest are saved
+      and, if the PFM hasn't been changed by anything else and the surface type is the same, the next run maps them
+      instead of reading the PFM.  This can be turned off on the surface page or with --no-cache in batch mode.
+
+
+    Version 4.24
+    PFM Software
+    10/16/26
+
+    - Each phase of the run (open, ingest or cache, solve, nibble, write, close) is timed.  Wall and CPU time, bins
+      visited, soundings read, points loaded, bins written, and peak RSS are written to PFM_FILE.misp_report.json and
+      a summary is shown in the run page status list (MESSAGE records in batch mode).
+
+
+    Version 4.25
+    PFM Software
+    10/16/26
+
+    - Added the bench directory.  pfmMispBench builds synthetic PFMs (size, sounding density, holes, polygon shape,
+      and land masked area are all configurable) and runs misp_surface on them at several scales, collecting the run
+      reports in bench_results.json.  mk now runs qmake -project with -norecursive so the bench sources stay out
+      of pfmMisp.
+
+
+    Version 4.26
+    PFM Software
+    10/16/26
+
+    - The PFM polygon is scanline filled once per run into spans of inside bins (polygon_spans).  The surface write
+      only looks at bins inside the spans instead of calling bin_inside_ptr for every bin.
+
+
+    Version 4.27
+    PFM Software
+    10/16/26
+
+    - The SRTM land mask is built once at the PFM's bin resolution and saved next to the PFM (PFM_FILE.srtm_mask).
+      Later runs over the same area load it instead of calling read_srtm_mask for each bin.
+
+
+    Version 4.28
+    PFM Software
+    10/16/26
+
+    - The ingest kernel is now a template compiled for each surface type so there's no switch per sounding, and the
+      coordinate normalization uses reciprocal bin sizes worked out once per band.  The "all depths" loop has no
+      branches inside the bin.  Normalized coordinates can differ from the old divide in the last bit so the point
+      cache format version has been bumped.
+
+
+    Version 4.29
+    PFM Software
+    10/16/26
+
+    - Points are now kept as separate x, y, and z arrays (point_buffer).  Ingest stores the raw positions and
+      normalizes each band in one (SSE2) pass, the tile bucketing only touches x and y, and the points are handed to
+      MISP from one place (load_misp_points).  The point cache holds the arrays as they are.
+
+
+    Version 4.30
+    PFM Software
+    10/16/26
+
+    - Ingest now reads the bin records first (occupancy) to find the bins with soundings and how many soundings are in
+      each row.  The depth pass only visits bins with soundings (64 at a time from the bin raster), skips empty rows,
+      and splits the rows into bands with about the same number of soundings instead of the same number of rows.
+
+
+    Version 4.31
+    PFM Software
+    10/16/26
+
+    - Ingest is now a pipeline.  The bands pass their points on in chunks (through a small fixed ring per band) to the
+      main thread, which collects them in band order and, for a single grid, loads them into MISP while the bands are
+      still reading.  The MISP load is now part of the ingest phase in the run report and the bands are no longer
+      merged (copied) at the end.
+
+
+    Version 4.32
+    PFM Software
+    10/17/26
+
+    - Added export grids.  Any of the minimum filtered, maximum filtered, and all depths surfaces can also be written to
+      PFM_FILE.misp_min.bil, PFM_FILE.misp_max.bil, and PFM_FILE.misp_all.bil (ESRI BIL with .hdr and .prj, readable
+      by GDAL).  The depth records are read once for all of the surfaces, the extra surfaces are gridded in their own
+      processes (on Linux) while the PFM surface is gridded, and the grid files are written in the same sweep as the
+      PFM.  Export grids on the surface page or --export min,max,all in batch mode.
+
+
+    Version 4.33
+    PFM Software
+    10/17/26
+
+    - Added bin reduction for the all depths surface.  Bins with more than the cap valid soundings are reduced to one
+      point (mean, median, or 10% trimmed mean) or to at most the cap points (stratified, the means of a sqrt (cap) by
+      sqrt (cap) grid of cells in the bin) before they go to MISP.  Bin reduction on the surface page or --reduce and
+      --reduce-cap in batch mode.  The point cache format changed so old caches will be rebuilt.
+
+
+    Version 4.34
+    PFM Software
+    10/17/26
+
+    - Added a memory budget for PFMs that are too large to grid in memory.  The PFM sized grids (surface, tile weights,
+      and export grids) that won't fit in half of the budget are mapped from scratch files next to the PFM
+      (PFM_FILE.misp_scratch.XXXXXX) and the solve is tiled so the MISP tiles running at once fit in the other half.
+      Memory budget on the surface page or --memory-budget MB in batch mode.
+
+
+    Version 4.35
+    PFM Software
+    10/17/26
+
+    - Added local hole filling.  When only empty bins are being replaced, the connected groups of empty bins inside
+      the PFM polygon that will be interpolated are each solved on a small grid with a ring of the surrounding data,
+      in parallel, instead of solving the whole PFM.  Nibbling and SRTM land clearing are now worked out before the
+      solve so those bins are left out of the holes.  Fill holes locally on the surface page or --holes in batch mode.
+
+
+    Version 4.36
+    PFM Software
+    10/17/26
+
+    - Added selectable interpolation engines.  MISP is still the default, IDW (inverse distance squared weighting of
+      the nearest points, found through a per bin index, in the row band threads) and TIN (linear interpolation in a
+      Delaunay triangulation) are much faster on dense data.  Engine on the surface page or --engine misp|idw|tin in
+      batch mode.
+
+
+    Version 4.37
+    PFM Software
+    10/17/26
+
+    - Added the multigrid engine, an in-tree minimum curvature (with tension) solver.  The data is averaged onto a
+      pyramid of halved grids, the coarsest is relaxed first, and each finer level starts from the prolongated level
+      below it, so the time grows about linearly with the grid size.  The relaxation is a damped Jacobi sweep of the
+      13 point stencil, four bins at a time with SSE2, in row bands.  Multigrid on the surface page or --engine
+      multigrid in batch mode.  pfmMispBench --engines misp,multigrid times it against libmisp.
+
+
+    Version 4.38
+    PFM Software
+    10/17/26
+
+    - Added a warm start for the multigrid engine.  The surface that's already in the PFM (bin averages and the last
+      run's interpolated bins) is read in parallel row bands and the full grid starts from it, relaxing only until the
+      biggest residual is under the given tolerance.  The coarse levels are skipped unless there are bins it doesn't
+      cover.  After a small edit this takes a handful of sweeps.  Warm start on the surface page or --warm-start
+      RESIDUAL in batch mode.
+
+
+    Version 4.39
+    PFM Software
+    10/17/26
+
+    - Fixed a tiled surface that failed the --check-tiles comparison being written to the PFM anyway.  Nothing is
+      written back now (the run report still goes out) and the GUI reports it as a failure instead of complete.
+
+
+    Version 4.40
+    PFM Software
+    10/17/26
+
+    - The tile, hole, and export surface child processes only run libmisp now (see misp_grid in solve_surface.cpp),
+      their buffers are allocated before the fork and all of the messages and progress are handled by the parent.
+      Holes solved with the other engines use the row band threads instead of child processes, tiled MISP export
+      surfaces are solved one at a time in the parent (each one is already a process per tile).  The tile help and the
+      batch usage say that the tiles are only solved in parallel on Linux.
+
+
+    Version 4.41
+    PFM Software
+    10/17/26
+
+    - The warm start surface comes out of the ingest's bin record pass (build_occupancy) now instead of a second read
+      of the whole bin file.  It's only read on its own when the points come from the point cache.
+
+
+    Version 4.42
+    PFM Software
+    10/17/26
+
+    - With the bin reduction the all depths points are reserved for at most reduce_cap points per bin instead of every
+      sounding.  Fixed the count of points removed by the reduction missing the bands that were cancelled part way
+      through.
+
+
+    Version 4.43
+    PFM Software
+    10/17/26
+
+    - The polygon spans also check every bin within one bin of a polygon vertex with bin_inside_ptr, not just the ends
+      of the spans, so bins at concave vertices and along edges that run with a row aren't dropped.
+
+
+    Version 4.44
+    PFM Software
+    10/17/26
+
+    - Added --verify to pfmMispBench.  It checks the nibbler against a search of the whole nibble square on random
+      masks and the polygon spans against bin_inside_ptr on random polygons, and exits -1 if anything differs.
+
+
+    Version 4.45
+    PFM Software
+    10/17/26
+
+    - The SRTM land mask is only looked up for bins without soundings, the mask is never used for the others.  The
+      PFM_FILE.srtm_mask cache now also saves which bins were looked up so bins that lose their soundings later are
+      looked up on the next run (old caches are rebuilt).
+
+
+    Version 4.46
+    PFM Software
+    10/17/26
+
+    - Batch mode cancels the run on SIGTERM or SIGINT (exit status 1) instead of being killed mid write, --help prints
+      the usage and exits 0, and --check-tiles and --warm-start reject values that aren't numbers of 0 or more.  The
+      forked tile, hole, and export solves put SIGTERM back to the default so they can still be stopped.
+
+
+    Version 4.47
+    PFM Software
+    10/17/26
+
+    - The engine names shown in the GUI come from the engine table (surface_engines) and an out of range engine in the
+      settings goes back to MISP instead of indexing past the end of the table.
+
+
+    Version 4.48
+    PFM Software
+    10/17/26
+
+    - The ingest point rings are allocated with new[] (they have atomic, mutex, and wait condition members), each
+      chunk starts with room for POINT_CHUNK_SIZE points instead of the general 65536 point minimum, and a band
+      waiting for a free chunk sleeps on a wait condition instead of polling every 200 microseconds.
+
+
+    Version 4.49
+    PFM Software
+    10/17/26
+
+    - IDW, TIN, and multigrid put their grid nodes on the bin corners, same as MISP, instead of the bin centers.
+      Points go to their nearest node (nearest_node in surface_engine.hpp) so switching engines no longer shifts the
+      surface by half a bin.
+
+
+    Version 4.50
+    PFM Software
+    10/17/26
+
+    - Multigrid levels that stop at their sweep limit before getting down to the tolerance are reported in a message
+      (whole grid) and counted in the run report (capped_relaxations).
+
+
+    Version 4.51
+    PFM Software
+    10/17/26
+
+    - The run report has room for 16 phases, more than misp_surface can start, so a warm start run with everything
+      turned on no longer loses the write phase.  If it ever does run out, the extra phases are timed into an "other"
+      phase instead of overwriting the last one.
+
+
+    Version 4.52
+    PFM Software
+    10/17/26
+
+    - Nodes that MISP returns outside its misp_init limits (NO_GRID_VALUE) are now NaN so the tile blend and hole fill
+      skip them.  Say when --tile is ignored because the engine isn't MISP.
+
+
+    Version 4.53
+    PFM Software
+    10/17/26
+
+    - Batch integer options (--weight, --nibble, --tile, --halo, --reduce-cap, --memory-budget) are now read with
+      strtol and rejected unless the whole argument is a number in range.
+
+
+    Version 4.54
+    PFM Software
+    10/17/26
+
+    - pfmMispBench rebuilds the synthetic PFM before every run (each run writes its surface into it), prints a table
+      of the phase times at the end, and --help exits 0.
+
+
+    Version 4.55
+    PFM Software
+    10/17/26
+
+    - The multigrid engine solves with V-cycles (damped Jacobi smoothing, full weighting restriction of the residual
+      of the free bins, bilinear correction) from a full multigrid start until no residual is over the tolerance,
+      instead of relaxing each level once from the one below it.  Solves that hit the V-cycle limit are counted in the
+      run report as capped_solves.
+
+
+    Version 4.56
+    PFM Software
+    10/17/26
+
+    - A multigrid warm start runs V-cycles on the start surface until the biggest residual (the stencil applied to the
+      surface rather than how far a sweep moved it) is under warm_residual.  A warm solve that hits the V-cycle limit
+      is counted and reported like a cold one and the warm start message gives the cycles and the final residual.
+
 </pre>*/
@@ -0,0 +1,148 @@
+
+/*********************************************************************************************
+
+    This is public domain software that was developed by or for the U.S. Naval Oceanographic
+    Office and/or the U.S. Army Corps of Engineers.
+
+    This is a work of the U.S. Government. In accordance with 17 USC 105, copyright protection
+    is not available for any work of the U.S. Government.
+
+    Neither the United States Government, nor any employees of the United States Government,
+    nor the author, makes any warranty, express or implied, without even the implied warranty
+    of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE, or assumes any liability or
+    responsibility for the accuracy, completeness, or usefulness of any information,
+    apparatus, product, or process disclosed, or represents that its use would not infringe
+    privately-owned rights. Reference herein to any specific commercial products, process,
+    or service by trade name, trademark, manufacturer, or otherwise, does not necessarily
+    constitute or imply its endorsement, recommendation, or favoring by the United States
+    Government. The views and opinions of authors expressed herein do not necessarily state
+    or reflect those of the United States Government, and shall not be used for advertising
+    or product endorsement purposes.
+*********************************************************************************************/
+
+
+/****************************************  IMPORTANT NOTE  **********************************
+
+    Comments in this file that start with / * ! or / / ! are being used by Doxygen to
+    document the software.  Dashes in these comment blocks are used to create bullet lists.
+    The lack of blank lines after a block of dash preceeded comments means that the next
+    block of dash preceeded comments is a new, indented bullet list.  I've tried to keep the
+    Doxygen formatting to a minimum but there are some other items (like <br> and <pre>)
+    that need to be left alone.  If you see a comment that starts with / * ! or / / ! and
+    there is something that looks a bit weird it is probably due to some arcane Doxygen
+    syntax.  Be very careful modifying blocks of Doxygen comments.
+
+*****************************************  IMPORTANT NOTE  **********************************/
+
+
+
+#include "warm_start.hpp"
+#include "ingest.hpp"
+#include "bin_row.hpp"
+#include "run_bands.hpp"
+
+#include <cmath>
+
+
+typedef struct
+{
+  PFM_OPEN_ARGS       *open_args;
+  float               *grid;
+  BAND_STATUS         status;
+} WARM_DATA;
+
+
+
+//  The surface value of a bin for the warm start, NaN if it doesn't have one.
+
+float warm_value (PFM_OPEN_ARGS *open_args, BIN_RECORD *bin)
+{
+  float value = bin->avg_filtered_depth;
+
+  if ((bin->validity & (PFM_DATA | PFM_INTERPOLATED)) && value <= open_args->max_depth && value > -open_args->offset)
+    return (value);
+
+  return (NAN);
+}
+
+
+
+//  Reads the bin records for rows start_row through end_row - 1 and saves the surface value of each bin that has one.
+
+static void warm_band (int32_t band __attribute__ ((unused)), int32_t start_row, int32_t end_row, void *data)
+{
+  WARM_DATA           *args = (WARM_DATA *) data;
+  PFM_OPEN_ARGS       band_args;
+  BIN_ROW             row;
+  int32_t             pfm_handle;
+
+
+  BIN_HEADER *head = &args->open_args->head;
+
+
+  pfm_handle = open_band_pfm (&band_args, args->open_args->list_path);
+
+  if (pfm_handle < 0) pfm_error_exit (pfm_error);
+
+  open_bin_row (&row, pfm_handle, head->bin_width, 0);
+
+
+  for (int32_t i = start_row ; i < end_row ; i++)
+    {
+      if (args->status.cancel) break;
+
+      BIN_RECORD *bins = read_bin_row_buffer (&row, i);
+      float *surface = &args->grid[(int64_t) i * head->bin_width];
+
+      for (int32_t j = 0 ; j < head->bin_width ; j++) surface[j] = warm_value (args->open_args, &bins[j]);
+
+      args->status.rows_done++;
+    }
+
+
+  close_bin_row (&row);
+
+  close_band_pfm (pfm_handle);
+}
+
+
+
+/***************************************************************************\
+*                                                                           *
+*   Module Name:        read_warm_surface                                   *
+*                                                                           *
+*   Purpose:            Reads the surface that's already in the PFM (the    *
+*                       Average Filtered/Edited depth of every bin with     *
+*                       data or an interpolated value, so the surface from  *
+*                       the last pfmMisp run plus any edits since) in       *
+*                       parallel row bands.  The multigrid engine starts    *
+*                       from it instead of from scratch (see                *
+*                       set_multigrid_start) so after a small edit it only  *
+*                       has to relax out the change.  When the points are   *
+*                       read from the PFM this comes out of the ingest's    *
+*                       bin record pass instead (see build_occupancy), this *
+*                       is only for a run that uses the point cache.        *
+*                                                                           *
+*   Arguments:          open_args       -   open args of the PFM            *
+*                       callbacks       -   progress hooks                  *
+*                       grid            -   returned surface, bin_width by  *
+*                                           bin_height, NaN for bins        *
+*                                           without a value                 *
+*                                                                           *
+*   Returns:            NVTrue if the run was cancelled                     *
+*                                                                           *
+\***************************************************************************/
+
+uint8_t read_warm_surface (PFM_OPEN_ARGS *open_args, RUN_CALLBACKS *callbacks, float *grid)
+{
+  WARM_DATA           args;
+
+
+  args.open_args = open_args;
+  args.grid = grid;
+
+  callbacks->phase (QCoreApplication::translate ("pfmMisp", "Reading the PFM surface"), open_args->head.bin_height);
+
+  return (run_bands (open_args->head.bin_height, band_count (open_args->head.bin_height), warm_band, &args,
+                     &args.status, callbacks));
+}
@@ -0,0 +1,302 @@
+
+/*********************************************************************************************
+
+    This is public domain software that was developed by or for the U.S. Naval Oceanographic
+    Office and/or the U.S. Army Corps of Engineers.
+
+    This is a work of the U.S. Government. In accordance with 17 USC 105, copyright protection
+    is not available for any work of the U.S. Government.
+
+    Neither the United States Government, nor any employees of the United States Government,
+    nor the author, makes any warranty, express or implied, without even the implied warranty
+    of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE, or assumes any liability or
+    responsibility for the accuracy, completeness, or usefulness of any information,
+    apparatus, product, or process disclosed, or represents that its use would not infringe
+    privately-owned rights. Reference herein to any specific commercial products, process,
+    or service by trade name, trademark, manufacturer, or otherwise, does not necessarily
+    constitute or imply its endorsement, recommendation, or favoring by the United States
+    Government. The views and opinions of authors expressed herein do not necessarily state
+    or reflect those of the United States Government, and shall not be used for advertising
+    or product endorsement purposes.
+*********************************************************************************************/
+
+
+/****************************************  IMPORTANT NOTE  **********************************
+
+    Comments in this file that start with / * ! or / / ! are being used by Doxygen to
+    document the software.  Dashes in these comment blocks are used to create bullet lists.
+    The lack of blank lines after a block of dash preceeded comments means that the next
+    block of dash preceeded comments is a new, indented bullet list.  I've tried to keep the
+    Doxygen formatting to a minimum but there are some other items (like <br> and <pre>)
+    that need to be left alone.  If you see a comment that starts with / * ! or / / ! and
+    there is something that looks a bit weird it is probably due to some arcane Doxygen
+    syntax.  Be very careful modifying blocks of Doxygen comments.
+
+*****************************************  IMPORTANT NOTE  **********************************/
+
+
+
+#include "write_surface.hpp"
+#include "bin_row.hpp"
+#include "polygon_spans.hpp"
+
+
+/***************************************************************************\
+*                                                                           *
+*   Module Name:        write_surface                                       *
+*                                                                           *
+*   Purpose:            Writes the gridded surface back to the PFM in a     *
+*                       single sweep of the bin file.  This used to be      *
+*                       three passes (retrieval, nibbling, and SRTM land    *
+*                       clearing) but everything they need to know is in    *
+*                       the bin raster (and the RASTER_NEAR plane from      *
+*                       nibble_mask) so we can work out the final state of  *
+*                       each bin up front and touch it at most once.  Rows  *
+*                       with bins that get a new surface value are read     *
+*                       with one call, bins that only lose their            *
+*                       interpolated flag get a validity write, and the     *
+*                       rest aren't touched.  Writes are queued per row     *
+*                       (see bin_row).  The export grids are written in     *
+*                       the same sweep with the same nibbling and land      *
+*                       clearing.                                           *
+*                                                                           *
+*   Arguments:          pfm_handle      -   PFM handle                      *
+*                       open_args       -   PFM open args                   *
+*                       options         -   run options                     *
+*                       callbacks       -   progress hooks                  *
+*                       grid            -   surface (bin_width by           *
+*                                           grid_rows)                      *
+*                       grid_rows       -   rows retrieved from MISP        *
+*                       raster          -   bin raster (RASTER_NEAR is      *
+*                                           required if nibbling,           *
+*                                           RASTER_SRTM if clearing land)   *
+*                       land_mask_flag  -   PFM_USER_10 is the land mask    *
+*                       exports         -   opened export grids             *
+*                       export_count    -   number of export grids          *
+*                       written         -   returned number of bins         *
+*                                           written                         *
+*                                                                           *
+*   Returns:            NVTrue if the run was cancelled (between rows, so   *
+*                       the PFM will be partially updated)                  *
+*                                                                           *
+\***************************************************************************/
+
+uint8_t write_surface (int32_t pfm_handle, PFM_OPEN_ARGS *open_args, OPTIONS *options, RUN_CALLBACKS *callbacks,
+                       float *grid, int32_t grid_rows, BIN_RASTER *raster, uint8_t land_mask_flag,
+                       EXPORT_GRID *exports, int32_t export_count, int64_t *written)
+{
+  BIN_ROW             row;
+  POLYGON_SPANS       polygon;
+  uint8_t             nibble_flag, data, interp, *write, *keep = NULL, read_row;
+  float               *values = NULL;
+
+
+  BIN_HEADER *head = &open_args->head;
+
+  nibble_flag = (options->clear_int && options->nibble);
+
+  *written = 0;
+
+
+  open_bin_row (&row, pfm_handle, head->bin_width, PFM_INTERPOLATED);
+
+
+  //  Don't try to write points that fall outside of the PFM polygon (it might not be a rectangle).
+
+  build_polygon_spans (head, &polygon);
+
+  write = (uint8_t *) malloc (head->bin_width * sizeof (uint8_t));
+
+  if (write == NULL)
+    {
+      perror ("Allocating surface write flags");
+      exit (-1);
+    }
+
+  if (export_count)
+    {
+      keep = (uint8_t *) malloc (head->bin_width * sizeof (uint8_t));
+      values = (float *) malloc (head->bin_width * sizeof (float));
+
+      if (keep == NULL || values == NULL)
+        {
+          perror ("Allocating export row");
+          exit (-1);
+        }
+    }
+
+
+  callbacks->phase (QCoreApplication::translate ("pfmMisp", "Writing surface data"), head->bin_height);
+
+
+  for (int32_t i = 0 ; i < head->bin_height ; i++)
+    {
+      float *array = (i < grid_rows) ? &grid[(int64_t) i * head->bin_width] : NULL;
+
+
+      /*  Work out which bins in the row get a surface value so that we know whether we have to read the row at all.
+          Only the bins inside the polygon are candidates.  */
+
+      read_row = NVFalse;
+
+      memset (write, 0, head->bin_width);
+
+      for (int32_t k = polygon.first[i] ; array != NULL && k < polygon.first[i + 1] ; k++)
+        {
+          for (int32_t j = polygon.spans[k].start ; j <= polygon.spans[k].end ; j++)
+            {
+              data = raster_get (raster, RASTER_DATA, j, i);
+
+
+              /*  We don't want to replace land masked bins unless the land mask point has been deleted.
+
+                  If we set the nibble argument to 0 we don't want to put interpolated values into empty bins.  */
+
+              write[j] = ((!land_mask_flag || !data || !raster_get (raster, RASTER_LAND, j, i)) &&
+                          (options->replace_all || !data) &&
+                          (data || !options->clear_int || options->nibble));
+
+              read_row |= write[j];
+            }
+        }
+
+      BIN_RECORD *bins = read_row ? read_bin_row_buffer (&row, i) : row.bins;
+
+
+      for (int32_t j = 0 ; j < head->bin_width ; j++)
+        {
+          data = raster_get (raster, RASTER_DATA, j, i);
+
+          interp = write[j] || raster_get (raster, RASTER_INTERPOLATED, j, i);
+
+
+          //  Nibble out the bins that aren't within the nibbling distance of a bin with valid data.
+
+          if (interp && nibble_flag && !data && !raster_get (raster, RASTER_NEAR, j, i)) interp = NVFalse;
+
+
+          //  Clear SRTM land.  If there's real data in the bin don't believe the mask.
+
+          if (interp && options->clear_land && !raster_get (raster, RASTER_SOUNDINGS, j, i) &&
+              raster_get (raster, RASTER_SRTM, j, i)) interp = NVFalse;
+
+
+          if (write[j])
+            {
+              if (array[j] <= open_args->max_depth && array[j] > -open_args->offset)
+                {
+                  bins[j].avg_filtered_depth = array[j];
+                }
+              else
+                {
+                  bins[j].avg_filtered_depth = head->null_depth;
+                }
+
+
+              //  If there was a land mask point in this bin and it has been deleted, unset the PFM_USER_10 flag.
+
+              bins[j].validity &= ~PFM_USER_10;
+              raster_clear (raster, RASTER_LAND, j, i);
+
+              if (interp)
+                {
+                  bins[j].validity |= PFM_INTERPOLATED;
+                }
+              else
+                {
+                  bins[j].validity &= ~PFM_INTERPOLATED;
+                }
+
+              mark_bin_row (&row, j, i, BIN_ROW_RECORD);
+            }
+          else if (!interp && raster_get (raster, RASTER_INTERPOLATED, j, i))
+            {
+              /*  We only need the validity for this one.  If the row wasn't read the record in the buffer is junk
+                  but nobody is going to look at anything else.  */
+
+              bins[j].validity = 0;
+              mark_bin_row (&row, j, i, BIN_ROW_VALIDITY);
+            }
+
+
+          if (interp)
+            {
+              raster_set (raster, RASTER_INTERPOLATED, j, i);
+            }
+          else
+            {
+              raster_clear (raster, RASTER_INTERPOLATED, j, i);
+            }
+        }
+
+      *written += row.dirty_count;
+
+      flush_bin_row (&row);
+
+
+      /*  The export grids get their surface in every bin inside the polygon that has data or that the nibbling and
+          land clearing would let have an interpolated value (replace_all and the land mask flag only apply to the
+          PFM).  */
+
+      if (export_count)
+        {
+          memset (keep, 0, head->bin_width);
+
+          for (int32_t k = polygon.first[i] ; k < polygon.first[i + 1] ; k++)
+            {
+              for (int32_t j = polygon.spans[k].start ; j <= polygon.spans[k].end ; j++)
+                {
+                  keep[j] = raster_get (raster, RASTER_DATA, j, i) ||
+                    ((!options->clear_int || options->nibble) &&
+                     !(nibble_flag && !raster_get (raster, RASTER_NEAR, j, i)) &&
+                     !(options->clear_land && !raster_get (raster, RASTER_SOUNDINGS, j, i) &&
+                       raster_get (raster, RASTER_SRTM, j, i)));
+                }
+            }
+
+          for (int32_t e = 0 ; e < export_count ; e++)
+            {
+              float *surface = (i < exports[e].grid_rows) ? &exports[e].grid[(int64_t) i * head->bin_width] : NULL;
+
+              for (int32_t j = 0 ; j < head->bin_width ; j++)
+                {
+                  if (keep[j] && surface != NULL && surface[j] <= open_args->max_depth &&
+                      surface[j] > -open_args->offset)
+                    {
+                      values[j] = surface[j];
+                    }
+                  else
+                    {
+                      values[j] = head->null_depth;
+                    }
+                }
+
+              write_export_row (head, &exports[e], i, values);
+            }
+        }
+
+      callbacks->value (i);
+
+      if (callbacks->cancelled ())
+        {
+          free (keep);
+          free (values);
+          free (write);
+          free_polygon_spans (&polygon);
+          close_bin_row (&row);
+          return (NVTrue);
+        }
+    }
+
+  callbacks->value (head->bin_height);
+
+
+  free (keep);
+  free (values);
+  free (write);
+  free_polygon_spans (&polygon);
+  close_bin_row (&row);
+
+
+  return (NVFalse);
+}